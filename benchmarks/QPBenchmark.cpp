@@ -0,0 +1,513 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+/**
+	* Measure the latency of each QPSolver::solve phase on synthetic robots.
+	*
+	* Usage: QPBenchmark [--dof n] [--robots n] [--contacts n] [--collisions n]
+	*                    [--bounds 0|1] [--ticks n] [--threads n]
+	*                    [--solver name]...
+	*
+	* Without --dof, --robots, --contacts, --collisions and --bounds each
+	* parameter is swept around a base problem while the other ones are kept.
+	* The sweep also run contact problems without joint limits and
+	* PositiveLambda: GIReduced (equality elimination) turns every finite
+	* bound into a dense line and is only expected to win on these ones.
+	* Every available QP solver is used when --solver is not given.
+	* Results are written on the standard output as CSV with one line by
+	* problem, solver and phase. Times are in micro seconds.
+	*/
+
+// includes
+// std
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// sch
+#include <sch/S_Object/S_Sphere.h>
+
+// RBDyn
+#include <RBDyn/EulerIntegration.h>
+#include <RBDyn/FK.h>
+#include <RBDyn/FV.h>
+
+// Tasks
+#include "Bounds.h"
+#include "GenQPSolver.h"
+#include "QPConstr.h"
+#include "QPContactConstr.h"
+#include "QPMotionConstr.h"
+#include "QPSolver.h"
+#include "QPTasks.h"
+
+// Robots
+#include "robots.h"
+
+
+/// Benchmarked problem size.
+struct Problem
+{
+	/// dof of each robot
+	int nrDof;
+	int nrRobots;
+	/// unilateral contacts between a branch tip and the environment
+	int nrContacts;
+	/// sphere pairs in the collision constraint
+	int nrCollisions;
+	/// add the JointLimitsConstr and PositiveLambda bounds
+	bool bounds;
+};
+
+
+/// Tasks, constraints and robots of a benchmarked problem.
+class Scenario
+{
+public:
+	Scenario(const Problem& problem, double timeStep);
+
+	void addToSolver(tasks::qp::QPSolver& solver);
+
+	/// Integrate the robots state of timeStep.
+	void integrate();
+
+	/// Number of contacts and collisions really created.
+	int nrContacts() const
+	{
+		return int(contacts_.size());
+	}
+	int nrCollisions() const
+	{
+		return int(collConstr_->nrCollisions());
+	}
+
+public:
+	std::vector<rbd::MultiBody> mbs;
+	std::vector<rbd::MultiBodyConfig> mbcs;
+	/// tasks and constraints added by addToSolver
+	std::vector<tasks::qp::Task*> tasks;
+	std::vector<tasks::qp::Constraint*> constraints;
+
+private:
+	double timeStep_;
+	bool bounds_;
+
+	std::vector<tasks::qp::UnilateralContact> contacts_;
+	std::vector<std::unique_ptr<sch::S_Sphere>> spheres_;
+
+	std::vector<std::unique_ptr<tasks::qp::PositionTask>> posTasks_;
+	std::vector<std::unique_ptr<tasks::qp::SetPointTask>> posTaskSps_;
+	std::vector<std::unique_ptr<tasks::qp::PostureTask>> postureTasks_;
+
+	std::vector<std::unique_ptr<tasks::qp::MotionConstr>> motionConstrs_;
+	std::vector<std::unique_ptr<tasks::qp::JointLimitsConstr>> jointConstrs_;
+	tasks::qp::PositiveLambda posLambda_;
+	tasks::qp::ContactAccConstr contactConstr_;
+	std::unique_ptr<tasks::qp::CollisionConstr> collConstr_;
+};
+
+
+Scenario::Scenario(const Problem& pb, double timeStep):
+	mbs(),
+	mbcs(),
+	tasks(),
+	constraints(),
+	timeStep_(timeStep),
+	bounds_(pb.bounds),
+	contacts_(),
+	spheres_(),
+	posTasks_(),
+	posTaskSps_(),
+	postureTasks_(),
+	motionConstrs_(),
+	jointConstrs_(),
+	posLambda_(),
+	contactConstr_(),
+	collConstr_()
+{
+	using namespace Eigen;
+	using namespace sva;
+	namespace qp = tasks::qp;
+
+	// robots are side by side along the X axis, each contact is put on
+	// a different branch tip and a branch need 3 dof to fulfill it
+	std::vector<std::vector<std::vector<int>>> branches;
+	for(int r = 0; r < pb.nrRobots; ++r)
+	{
+		int robotContacts = pb.nrContacts/pb.nrRobots +
+			(r < pb.nrContacts%pb.nrRobots ? 1 : 0);
+		int nrBranches = std::max(1, std::min(robotContacts, pb.nrDof/3));
+		SyntheticRobot robot = makeTree(pb.nrDof, nrBranches,
+			PTransformd(Vector3d(double(r), 0., 0.)));
+		mbs.push_back(robot.mb);
+		mbcs.push_back(robot.mbc);
+		branches.push_back(robot.branches);
+	}
+	const int envIndex = int(mbs.size());
+	SyntheticRobot env = makeEnv();
+	mbs.push_back(env.mb);
+	mbcs.push_back(env.mbc);
+
+	for(std::size_t r = 0; r < mbs.size(); ++r)
+	{
+		rbd::forwardKinematics(mbs[r], mbcs[r]);
+		rbd::forwardVelocity(mbs[r], mbcs[r]);
+	}
+
+	// contacts
+	MatrixXd pointDof(MatrixXd::Zero(3, 6));
+	pointDof.block(0, 3, 3, 3).setIdentity();
+	for(int c = 0; c < pb.nrContacts; ++c)
+	{
+		int r = c%pb.nrRobots;
+		std::size_t b = c/pb.nrRobots;
+		if(b >= branches[r].size() || int(branches[r][b].size()) < 3)
+		{
+			continue;
+		}
+
+		int tipId = branches[r][b].back();
+		const PTransformd& X_0_tip = mbcs[r].bodyPosW[mbs[r].bodyIndexById(tipId)];
+		contacts_.emplace_back(r, envIndex, tipId, 0,
+			std::vector<Vector3d>{Vector3d::Zero()}, Matrix3d::Identity(),
+			X_0_tip.inv(), 4, 0.7);
+		// point contact: only the translation is fixed
+		contactConstr_.addDofContact(contacts_.back().contactId, pointDof);
+	}
+
+	// tasks and articular constraints
+	for(int r = 0; r < pb.nrRobots; ++r)
+	{
+		const rbd::MultiBody& mb = mbs[r];
+		const rbd::MultiBodyConfig& mbc = mbcs[r];
+
+		postureTasks_.emplace_back(new qp::PostureTask(mbs, r, mbc.q, 1., 0.1));
+
+		// move up all the free branch tips
+		for(std::size_t b = 0; b < branches[r].size(); ++b)
+		{
+			int tipId = branches[r][b].back();
+			bool inContact = false;
+			for(const qp::UnilateralContact& uc: contacts_)
+			{
+				inContact |= uc.contactId.r1Index == r && uc.contactId.r1BodyId == tipId;
+			}
+			if(inContact)
+			{
+				continue;
+			}
+
+			Vector3d target = mbc.bodyPosW[mb.bodyIndexById(tipId)].translation() +
+				Vector3d(0., 0.05, 0.);
+			posTasks_.emplace_back(new qp::PositionTask(mbs, r, tipId, target));
+			posTaskSps_.emplace_back(new qp::SetPointTask(mbs, r,
+				posTasks_.back().get(), 10., 10.));
+		}
+
+		std::vector<std::vector<double>> qMin(mbc.q), qMax(mbc.q);
+		std::vector<std::vector<double>> tMin(mbc.q), tMax(mbc.q);
+		for(std::size_t i = 1; i < mbc.q.size(); ++i)
+		{
+			qMin[i][0] = -3.;
+			qMax[i][0] = 3.;
+			tMin[i][0] = -1000.;
+			tMax[i][0] = 1000.;
+		}
+
+		if(pb.bounds)
+		{
+			jointConstrs_.emplace_back(new qp::JointLimitsConstr(mbs, r,
+				{qMin, qMax}, timeStep_));
+		}
+		motionConstrs_.emplace_back(new qp::MotionConstr(mbs, r, {tMin, tMax}));
+	}
+
+	// collision pairs between non adjacent bodies of all the robots
+	std::vector<std::pair<std::pair<int, int>, std::pair<int, int>>> candidates;
+	std::vector<std::pair<int, int>> bodies;
+	std::vector<std::pair<int, int>> position; // branch and depth
+	for(int r = 0; r < pb.nrRobots; ++r)
+	{
+		for(std::size_t b = 0; b < branches[r].size(); ++b)
+		{
+			for(std::size_t d = 0; d < branches[r][b].size(); ++d)
+			{
+				bodies.emplace_back(r, branches[r][b][d]);
+				position.emplace_back(int(b), int(d));
+			}
+		}
+	}
+	for(std::size_t i = 0; i < bodies.size(); ++i)
+	{
+		for(std::size_t j = i + 1; j < bodies.size(); ++j)
+		{
+			bool sameBranch = bodies[i].first == bodies[j].first &&
+				position[i].first == position[j].first;
+			if(!sameBranch || std::abs(position[i].second - position[j].second) > 1)
+			{
+				candidates.push_back({bodies[i], bodies[j]});
+			}
+		}
+	}
+
+	std::map<std::pair<int, int>, sch::S_Sphere*> bodySphere;
+	auto sphere = [this, &bodySphere](const std::pair<int, int>& body)
+	{
+		auto it = bodySphere.find(body);
+		if(it == bodySphere.end())
+		{
+			spheres_.emplace_back(new sch::S_Sphere(0.02));
+			it = bodySphere.insert({body, spheres_.back().get()}).first;
+		}
+		return it->second;
+	};
+
+	collConstr_.reset(new qp::CollisionConstr(mbs, timeStep_));
+	int nrColl = std::min(pb.nrCollisions, int(candidates.size()));
+	for(int c = 0; c < nrColl; ++c)
+	{
+		// spread the pairs over all the candidates
+		const auto& cand = candidates[(std::size_t(c)*candidates.size())/nrColl];
+		collConstr_->addCollision(mbs, c,
+			cand.first.first, cand.first.second, sphere(cand.first),
+			PTransformd::Identity(),
+			cand.second.first, cand.second.second, sphere(cand.second),
+			PTransformd::Identity(),
+			0.05, 0.01, 0.);
+	}
+}
+
+
+void Scenario::addToSolver(tasks::qp::QPSolver& solver)
+{
+	for(auto& t: postureTasks_)
+	{
+		tasks.push_back(t.get());
+	}
+	for(auto& t: posTaskSps_)
+	{
+		tasks.push_back(t.get());
+	}
+	for(tasks::qp::Task* t: tasks)
+	{
+		solver.addTask(t);
+	}
+
+	for(auto& c: motionConstrs_)
+	{
+		c->addToSolver(solver);
+		constraints.push_back(c.get());
+	}
+	for(auto& c: jointConstrs_)
+	{
+		c->addToSolver(solver);
+		constraints.push_back(c.get());
+	}
+	if(bounds_)
+	{
+		posLambda_.addToSolver(solver);
+		constraints.push_back(&posLambda_);
+	}
+	contactConstr_.addToSolver(solver);
+	collConstr_->addToSolver(solver);
+	constraints.push_back(&contactConstr_);
+	constraints.push_back(collConstr_.get());
+
+	solver.nrVars(mbs, contacts_, {});
+	solver.updateConstrSize();
+}
+
+
+void Scenario::integrate()
+{
+	for(std::size_t r = 0; r < mbs.size(); ++r)
+	{
+		rbd::eulerIntegration(mbs[r], mbcs[r], timeStep_);
+		rbd::forwardKinematics(mbs[r], mbcs[r]);
+		rbd::forwardVelocity(mbs[r], mbcs[r]);
+	}
+}
+
+
+/// Sum the records tick by tick (all records must contain the same ticks).
+tasks::TimeRecord sumRecords(const std::vector<const tasks::TimeRecord*>& records,
+	int nrTicks)
+{
+	std::vector<double> sum(nrTicks, 0.);
+	for(const tasks::TimeRecord* tr: records)
+	{
+		std::vector<double> times = tr->times();
+		for(std::size_t i = 0; i < times.size() && i < sum.size(); ++i)
+		{
+			sum[i] += times[i];
+		}
+	}
+
+	tasks::TimeRecord res(nrTicks);
+	for(double t: sum)
+	{
+		res.add(t);
+	}
+	return res;
+}
+
+
+void runProblem(const Problem& pb, const std::string& solverName,
+	int nrThreads, int nrTicks, std::ostream& out)
+{
+	const double timeStep = 0.005;
+	const int nrWarmup = 10;
+
+	Scenario scenario(pb, timeStep);
+
+	tasks::qp::QPSolver solver;
+	solver.solver(solverName);
+	solver.nrThreads(nrThreads);
+	scenario.addToSolver(solver);
+
+	int nrFailures = 0;
+	for(int i = 0; i < nrWarmup + nrTicks; ++i)
+	{
+		// don't measure the first solves
+		if(i == nrWarmup)
+		{
+			solver.timing(true, nrTicks);
+		}
+
+		if(!solver.solve(scenario.mbs, scenario.mbcs))
+		{
+			++nrFailures;
+		}
+		scenario.integrate();
+	}
+
+	std::vector<const tasks::TimeRecord*> taskRecords, constrRecords;
+	for(tasks::qp::Task* t: scenario.tasks)
+	{
+		taskRecords.push_back(&solver.taskTime(t));
+	}
+	for(tasks::qp::Constraint* c: scenario.constraints)
+	{
+		constrRecords.push_back(&solver.constraintTime(c));
+	}
+
+	std::vector<std::pair<std::string, tasks::TimeRecord>> phases =
+	{
+		{"data", solver.dataTime()},
+		{"constraints", sumRecords(constrRecords, nrTicks)},
+		{"tasks", sumRecords(taskRecords, nrTicks)},
+		{"matrix", solver.matrixTime()},
+		{"qp", solver.qpTime()},
+		{"total", solver.totalTime()}
+	};
+
+	const double us = 1e6;
+	for(const auto& phase: phases)
+	{
+		const tasks::TimeRecord& tr = phase.second;
+		out << solverName << "," << nrThreads << "," << pb.nrRobots << ","
+				<< pb.nrDof << "," << scenario.nrContacts() << ","
+				<< scenario.nrCollisions() << "," << pb.bounds << ","
+				<< solver.nrVars() << ","
+				<< nrTicks << "," << nrFailures << "," << phase.first << ","
+				<< tr.mean()*us << "," << tr.percentile(50.)*us << ","
+				<< tr.percentile(99.)*us << "," << tr.max()*us << std::endl;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	Problem base = {30, 1, 4, 20, true};
+	bool sweep = true;
+	int nrTicks = 200;
+	int nrThreads = 1;
+	std::vector<std::string> solvers;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if(i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << std::endl;
+			return 1;
+		}
+
+		std::string value(argv[++i]);
+		if(arg == "--dof") { base.nrDof = std::atoi(value.c_str()); sweep = false; }
+		else if(arg == "--robots") { base.nrRobots = std::atoi(value.c_str()); sweep = false; }
+		else if(arg == "--contacts") { base.nrContacts = std::atoi(value.c_str()); sweep = false; }
+		else if(arg == "--collisions") { base.nrCollisions = std::atoi(value.c_str()); sweep = false; }
+		else if(arg == "--bounds") { base.bounds = std::atoi(value.c_str()) != 0; sweep = false; }
+		else if(arg == "--ticks") { nrTicks = std::atoi(value.c_str()); }
+		else if(arg == "--threads") { nrThreads = std::atoi(value.c_str()); }
+		else if(arg == "--solver") { solvers.push_back(value); }
+		else
+		{
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	if(solvers.empty())
+	{
+		solvers = tasks::qp::qpSolverNames();
+	}
+
+	std::vector<Problem> problems = {base};
+	if(sweep)
+	{
+		for(int dof: {10, 50, 100, 200})
+		{
+			problems.push_back({dof, base.nrRobots, base.nrContacts, base.nrCollisions,
+				base.bounds});
+		}
+		for(int robots: {2, 4, 6})
+		{
+			problems.push_back({base.nrDof, robots, base.nrContacts, base.nrCollisions,
+				base.bounds});
+		}
+		for(int contacts: {0, 8, 16})
+		{
+			problems.push_back({base.nrDof, base.nrRobots, contacts, base.nrCollisions,
+				base.bounds});
+		}
+		for(int collisions: {0, 50, 100})
+		{
+			problems.push_back({base.nrDof, base.nrRobots, base.nrContacts, collisions,
+				base.bounds});
+		}
+		// equality heavy problems where GIReduced should be the fastest
+		for(int contacts: {4, 8, 16})
+		{
+			problems.push_back({base.nrDof, base.nrRobots, contacts, 0, false});
+		}
+	}
+
+	std::cout << "solver,threads,robots,dof,contacts,collisions,bounds,vars,ticks,"
+						<< "failures,phase,mean_us,p50_us,p99_us,max_us" << std::endl;
+	for(const Problem& pb: problems)
+	{
+		for(const std::string& name: solvers)
+		{
+			runProblem(pb, name, nrThreads, nrTicks, std::cout);
+		}
+	}
+
+	return 0;
+}
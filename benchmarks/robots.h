@@ -0,0 +1,137 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// boost
+#include <boost/math/constants/constants.hpp>
+
+// SpaceVecAlg
+#include <SpaceVecAlg/SpaceVecAlg>
+
+// RBDyn
+#include <RBDyn/Body.h>
+#include <RBDyn/Joint.h>
+#include <RBDyn/MultiBody.h>
+#include <RBDyn/MultiBodyConfig.h>
+#include <RBDyn/MultiBodyGraph.h>
+
+
+/// Synthetic robot used by the benchmarks.
+struct SyntheticRobot
+{
+	rbd::MultiBody mb;
+	rbd::MultiBodyConfig mbc;
+	/// body id of each branch from the root child to the tip
+	std::vector<std::vector<int>> branches;
+};
+
+
+/**
+	* Fixed base tree made of nrBranches revolute joint chains attached
+	* to the root body.
+	* The nrDof joints are split between the branches and the joint axis
+	* cycle between Z, X and Y. Branches start in a star around the root
+	* and go up along the Y axis.
+	* Everything is deterministic so two calls return the same robot.
+	* @param nrDof Number of revolute joints.
+	* @param nrBranches Number of chains (at least one joint per chain).
+	* @param X_base Root body position.
+	*/
+SyntheticRobot makeTree(int nrDof, int nrBranches,
+	const sva::PTransformd& X_base=sva::PTransformd::Identity())
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	namespace cst = boost::math::constants;
+
+	const double linkLength = 0.1;
+	const Joint::Type types[] = {Joint::RevZ, Joint::RevX, Joint::RevY};
+
+	nrBranches = std::max(1, std::min(nrBranches, nrDof));
+
+	MultiBodyGraph mbg;
+	SyntheticRobot robot;
+
+	RBInertiad rbi(1., Vector3d(0., 0.5*linkLength, 0.), 0.01*Matrix3d::Identity());
+
+	mbg.addBody(Body(rbi, 0, "b0"));
+
+	int id = 1;
+	for(int b = 0; b < nrBranches; ++b)
+	{
+		int branchDof = nrDof/nrBranches + (b < nrDof%nrBranches ? 1 : 0);
+		double angle = 2.*cst::pi<double>()*b/nrBranches;
+		PTransformd X_parent_branch(RotY(angle),
+			Vector3d(0.5*linkLength*std::cos(angle), 0., 0.5*linkLength*std::sin(angle)));
+
+		robot.branches.emplace_back();
+		int parent = 0;
+		for(int j = 0; j < branchDof; ++j, ++id)
+		{
+			std::string name = std::to_string(id);
+			mbg.addBody(Body(rbi, id, "b" + name));
+			mbg.addJoint(Joint(types[id%3], true, id, "j" + name));
+
+			PTransformd to = j == 0 ? X_parent_branch :
+				PTransformd(Vector3d(0., linkLength, 0.));
+			mbg.linkBodies(parent, to, id, PTransformd::Identity(), id);
+
+			robot.branches.back().push_back(id);
+			parent = id;
+		}
+	}
+
+	robot.mb = mbg.makeMultiBody(0, true, X_base);
+	robot.mbc = MultiBodyConfig(robot.mb);
+	robot.mbc.zero(robot.mb);
+
+	// bend the chains to avoid starting on a singular configuration
+	for(int i = 1; i < robot.mb.nrJoints(); ++i)
+	{
+		robot.mbc.q[i][0] = i%2 == 0 ? 0.2 : -0.2;
+	}
+
+	return robot;
+}
+
+
+/// One fixed body robot used as environment.
+SyntheticRobot makeEnv()
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+
+	MultiBodyGraph mbg;
+	SyntheticRobot env;
+
+	RBInertiad rbi(1., Vector3d::Zero(), Matrix3d::Identity());
+	mbg.addBody(Body(rbi, 0, "b0"));
+
+	env.mb = mbg.makeMultiBody(0, true);
+	env.mbc = MultiBodyConfig(env.mb);
+	env.mbc.zero(env.mb);
+
+	return env;
+}
@@ -321,16 +321,25 @@ def build_qp(tasks):
   solData = qp.add_class('SolverData')
 
   frictionCone = qp.add_struct('FrictionCone')
+  wrenchCone = qp.add_struct('WrenchCone')
+  qp.add_enum('ContactModel',
+              [(v, 'tasks::qp::ContactModel::%s' % v) for v in
+               ['Generators', 'Wrench']])
   contactId = qp.add_struct('ContactId')
   unilateralContact = qp.add_struct('UnilateralContact')
   bilateralContact = qp.add_struct('BilateralContact')
   jointStiffness = qp.add_struct('JointStiffness')
   jointGains = qp.add_struct('JointGains')
   springJoint = qp.add_struct('SpringJoint')
+  colBlock = qp.add_struct('ColBlock')
+  qp.add_enum('QStructure',
+              [(v, 'tasks::qp::QStructure::%s' % v) for v in
+               ['Dense', 'Lower', 'Diagonal', 'ScaledIdentity', 'Factor']])
   qBound = tasks.add_struct('QBound')
   alphaBound = tasks.add_struct('AlphaBound')
   torqueBound = tasks.add_struct('TorqueBound')
   polyTorqueBound = tasks.add_struct('PolyTorqueBound')
+  timeRecord = tasks.add_class('TimeRecord')
 
   constr = qp.add_class('Constraint')
   eqConstr = qp.add_class('Equality')
@@ -371,6 +380,8 @@ def build_qp(tasks):
                                                                   constr])
   positiveLambdaConstr = qp.add_class('PositiveLambda', parent=[boundConstr,
                                                                 constr])
+  wrenchConeConstr = qp.add_class('WrenchConeConstr', parent=[ineqConstr,
+                                                             constr])
   contactConstrCommon = qp.add_class('ContactConstrCommon')
   contactAccConstr = qp.add_class('ContactAccConstr', parent=[eqConstr, constr, contactConstrCommon])
   contactSpeedConstr = qp.add_class('ContactSpeedConstr', parent=[eqConstr, contactConstrCommon])
@@ -389,9 +400,11 @@ def build_qp(tasks):
   constrName = ['MotionConstr', 'MotionPolyConstr', 'ContactAccConstr', 'ContactSpeedConstr',
                 'CollisionConstr', 'JointLimitsConstr', 'DamperJointLimitsConstr',
                 'MotionSpringConstr', 'GripperTorqueConstr', 'BoundedSpeedConstr',
-                'CoMIncPlaneConstr', 'PositiveLambda', 'ContactPosConstr']
+                'CoMIncPlaneConstr', 'PositiveLambda', 'ContactPosConstr',
+                'WrenchConeConstr']
   eqConstrName = ['ContactAccConstr', 'ContactSpeedConstr', 'ContactPosConstr']
-  ineqConstrName = ['CollisionConstr', 'GripperTorqueConstr', 'CoMIncPlaneConstr']
+  ineqConstrName = ['CollisionConstr', 'GripperTorqueConstr', 'CoMIncPlaneConstr',
+                    'WrenchConeConstr']
   genineqConstrName = ['MotionConstr', 'MotionPolyConstr', 'MotionSpringConstr']
   boundConstrName = ['PositiveLambda', 'JointLimitsConstr', 'DamperJointLimitsConstr']
   taskName = ['SetPointTask', 'TrackingTask', 'TrajectoryTask', 'PIDTask',
@@ -405,7 +418,8 @@ def build_qp(tasks):
   constrList = [motionConstr, motionPolyConstr, contactAccConstr, contactSpeedConstr,
                 collisionConstr, jointLimitsConstr, damperJointLimitsConstr,
                 motionSpringConstr, gripperTorqueConstr, boundedSpeedConstr,
-                comIncPlaneConstr, positiveLambdaConstr, contactPosConstr]
+                comIncPlaneConstr, positiveLambdaConstr, contactPosConstr,
+                wrenchConeConstr]
 
   # build list type
   tasks.add_container('std::vector<tasks::qp::FrictionCone>',
@@ -420,6 +434,8 @@ def build_qp(tasks):
                       'tasks::qp::JointGains', 'vector')
   tasks.add_container('std::vector<tasks::qp::SpringJoint>',
                       'tasks::qp::SpringJoint', 'vector')
+  tasks.add_container('std::vector<tasks::qp::ColBlock>',
+                      'tasks::qp::ColBlock', 'vector')
   tasks.add_container('std::vector<Eigen::Vector3d>', 'Eigen::Vector3d', 'vector')
   tasks.add_container('std::vector<Eigen::Matrix3d>', 'Eigen::Matrix3d', 'vector')
   tasks.add_container('std::vector<Eigen::VectorXd>', 'Eigen::VectorXd', 'vector')
@@ -457,12 +473,24 @@ def build_qp(tasks):
                   param('std::vector<tasks::qp::BilateralContact>&', 'bi')])
   sol.add_method('nrVars', retval('int'), [], is_const=True)
 
-  sol.add_method('updateTasksNrVars', None, [param('const std::vector<rbd::MultiBody>&', 'mb')],
-                 is_const=True)
-  sol.add_method('updateConstrsNrVars', None, [param('const std::vector<rbd::MultiBody>&', 'mb')],
-                 is_const=True)
-  sol.add_method('updateNrVars', None, [param('const std::vector<rbd::MultiBody>&', 'mb')],
-                 is_const=True)
+  sol.add_method('addContact', retval('bool'),
+                 [param('const std::vector<rbd::MultiBody>&', 'mbs'),
+                  param('const tasks::qp::UnilateralContact&', 'contact')])
+  sol.add_method('addContact', retval('bool'),
+                 [param('const std::vector<rbd::MultiBody>&', 'mbs'),
+                  param('const tasks::qp::BilateralContact&', 'contact')])
+  sol.add_method('removeContact', retval('bool'),
+                 [param('const std::vector<rbd::MultiBody>&', 'mbs'),
+                  param('const tasks::qp::ContactId&', 'contactId')])
+  sol.add_method('reserve', None,
+                 [param('int', 'maxVars'), param('int', 'maxEq'),
+                  param('int', 'maxInEq'), param('int', 'maxGenInEq')])
+  sol.add_method('lambdaCapacity', None, [param('int', 'capacity')])
+  sol.add_method('lambdaCapacity', retval('int'), [], is_const=True)
+
+  sol.add_method('updateTasksNrVars', None, [param('const std::vector<rbd::MultiBody>&', 'mb')])
+  sol.add_method('updateConstrsNrVars', None, [param('const std::vector<rbd::MultiBody>&', 'mb')])
+  sol.add_method('updateNrVars', None, [param('const std::vector<rbd::MultiBody>&', 'mb')])
 
   add_std_solver_add_rm_nr('EqualityConstraint', eqConstrName)
   add_std_solver_add_rm_nr('InequalityConstraint', ineqConstrName)
@@ -479,8 +507,16 @@ def build_qp(tasks):
   sol.add_method('resetTasks', None, [])
 
   sol.add_method('solver', None, [param('const std::string&', 'name')])
-
-  sol.add_method('result', retval('const Eigen::VectorXd&'), [], is_const=True)
+  sol.add_method('warmStart', None, [param('bool', 'warm')])
+  sol.add_method('warmStart', retval('bool'), [], is_const=True)
+  sol.add_method('nextSolveWarm', retval('bool'), [], is_const=True)
+  sol.add_method('resetWarmStart', None, [])
+  sol.add_method('nrThreads', None,
+                 [param('int', 'nrThreads'),
+                  param('std::vector<int>', 'cpus', default_value='std::vector<int>()')])
+  sol.add_method('nrThreads', retval('int'), [], is_const=True)
+
+  sol.add_method('result', retval('Eigen::VectorXd'), [], is_const=True)
   sol.add_method('alphaDVec', retval('Eigen::VectorXd'), [], is_const=True)
   sol.add_method('alphaDVec', retval('Eigen::VectorXd'),
                  [param('int', 'robotIndex')], is_const=True)
@@ -498,8 +534,38 @@ def build_qp(tasks):
   sol.add_method('solveAndBuildTime', retval('boost::timer::cpu_times'),
                  [], is_const=True)
 
+  sol.add_method('timing', None, [param('bool', 'enable'),
+                                  param('int', 'nrTicks', default_value='1000')])
+  sol.add_method('timing', retval('bool'), [], is_const=True)
+  sol.add_method('taskTime', retval('tasks::TimeRecord'),
+                 [param('Task*', 'ptr', transfer_ownership=False)],
+                 throw=[dom_ex], is_const=True)
+  sol.add_method('constraintTime', retval('tasks::TimeRecord'),
+                 [param('Constraint*', 'ptr', transfer_ownership=False)],
+                 throw=[dom_ex], is_const=True)
+  sol.add_method('dataTime', retval('tasks::TimeRecord'), [], is_const=True)
+  sol.add_method('matrixTime', retval('tasks::TimeRecord'), [], is_const=True)
+  sol.add_method('qpTime', retval('tasks::TimeRecord'), [], is_const=True)
+  sol.add_method('totalTime', retval('tasks::TimeRecord'), [], is_const=True)
+
+  # TimeRecord
+  timeRecord.add_constructor([param('int', 'capacity', default_value='1000')])
+  timeRecord.add_method('capacity', None, [param('int', 'capacity')])
+  timeRecord.add_method('capacity', retval('int'), [], is_const=True)
+  timeRecord.add_method('reset', None, [])
+  timeRecord.add_method('add', None, [param('double', 'time')])
+  timeRecord.add_method('size', retval('int'), [], is_const=True)
+  timeRecord.add_method('times', retval('std::vector<double>'), [], is_const=True)
+  timeRecord.add_method('last', retval('double'), [], is_const=True)
+  timeRecord.add_method('min', retval('double'), [], is_const=True)
+  timeRecord.add_method('max', retval('double'), [], is_const=True)
+  timeRecord.add_method('mean', retval('double'), [], is_const=True)
+  timeRecord.add_method('percentile', retval('double'),
+                        [param('double', 'percent')], is_const=True)
+
   # SolverData
   solData.add_method('nrVars', retval('int'), [], is_const=True)
+  solData.add_method('maxNrVars', retval('int'), [], is_const=True)
   solData.add_method('totalAlphaD', retval('int'), [], is_const=True)
   solData.add_method('totalLambda', retval('int'), [], is_const=True)
   solData.add_method('alphaD', retval('int'), [param('int','robotIndex')],
@@ -526,6 +592,8 @@ def build_qp(tasks):
   solData.add_method('allContacts',
                      retval('std::vector<tasks::qp::BilateralContact>'),
                      [], is_const=True)
+  solData.add_method('contactIndex', retval('int'),
+                     [param('const tasks::qp::ContactId&', 'cId')], is_const=True)
   solData.add_method('computeNormalAccB', None,
                      [param('const std::vector<rbd::MultiBody>&', 'mbs'),
                       param('const std::vector<rbd::MultiBodyConfig>&', 'mbcs')])
@@ -541,6 +609,18 @@ def build_qp(tasks):
 
   frictionCone.add_instance_attribute('generators', 'std::vector<Eigen::Vector3d>')
 
+  # WrenchCone
+  wrenchCone.add_constructor([])
+  wrenchCone.add_constructor([param('const sva::PTransformd&', 'X_b_s'),
+                              param('double', 'halfLength'),
+                              param('double', 'halfWidth'),
+                              param('double', 'mu'),
+                              param('double', 'direction', default_value='1.')])
+
+  wrenchCone.add_instance_attribute('X_b_s', 'sva::PTransformd')
+  wrenchCone.add_instance_attribute('wrenches', 'Eigen::MatrixXd')
+  wrenchCone.add_instance_attribute('faces', 'Eigen::MatrixXd')
+
   # ContactId
   contactId.add_constructor([])
   contactId.add_constructor([param('int', 'r1Index'), param('int', 'r2Index'),
@@ -591,6 +671,9 @@ def build_qp(tasks):
   unilateralContact.add_instance_attribute('r2Cone', 'tasks::qp::FrictionCone')
   unilateralContact.add_instance_attribute('X_b1_b2', 'sva::PTransformd')
   unilateralContact.add_instance_attribute('X_b1_cf', 'sva::PTransformd')
+  unilateralContact.add_instance_attribute('r1WrenchCone', 'tasks::qp::WrenchCone')
+  unilateralContact.add_instance_attribute('r2WrenchCone', 'tasks::qp::WrenchCone')
+  unilateralContact.add_instance_attribute('model', 'tasks::qp::ContactModel')
   unilateralContact.add_method('sForce', retval('Eigen::Vector3d'),
                                [param('const Eigen::VectorXd&', 'lambda'),
                                 param('int', 'point'),
@@ -609,6 +692,10 @@ def build_qp(tasks):
                                is_const=True, throw=[dom_ex], custom_name='nrLambda')
   unilateralContact.add_method('nrLambda', retval('int'), [],
                                is_const=True, throw=[dom_ex])
+  unilateralContact.add_method('wrench', retval('sva::ForceVecd'),
+                               [param('const Eigen::VectorXd&', 'lambda'),
+                                param('const tasks::qp::WrenchCone&', 'wc')],
+                               is_const=True)
 
   # BilateralContact
   bilateralContact.add_constructor([])
@@ -649,6 +736,9 @@ def build_qp(tasks):
   bilateralContact.add_instance_attribute('r2Cones', 'std::vector<tasks::qp::FrictionCone>')
   bilateralContact.add_instance_attribute('X_b1_b2', 'sva::PTransformd')
   bilateralContact.add_instance_attribute('X_b1_cf', 'sva::PTransformd')
+  bilateralContact.add_instance_attribute('r1WrenchCone', 'tasks::qp::WrenchCone')
+  bilateralContact.add_instance_attribute('r2WrenchCone', 'tasks::qp::WrenchCone')
+  bilateralContact.add_instance_attribute('model', 'tasks::qp::ContactModel')
   bilateralContact.add_method('sForce', retval('Eigen::Vector3d'),
                               [param('const Eigen::VectorXd&', 'lambda'),
                                param('int', 'point'),
@@ -667,6 +757,10 @@ def build_qp(tasks):
                               is_const=True, throw=[dom_ex], custom_name='nrLambda')
   bilateralContact.add_method('nrLambda', retval('int'), [],
                               is_const=True, throw=[dom_ex])
+  bilateralContact.add_method('wrench', retval('sva::ForceVecd'),
+                              [param('const Eigen::VectorXd&', 'lambda'),
+                               param('const tasks::qp::WrenchCone&', 'wc')],
+                              is_const=True)
 
   # JointStiffness
   jointStiffness.add_constructor([])
@@ -696,6 +790,12 @@ def build_qp(tasks):
   springJoint.add_instance_attribute('C', 'double')
   springJoint.add_instance_attribute('O', 'double')
 
+  # ColBlock
+  colBlock.add_constructor([])
+  colBlock.add_constructor([param('int', 'begin'), param('int', 'size')])
+  colBlock.add_instance_attribute('begin', 'int')
+  colBlock.add_instance_attribute('size', 'int')
+
   # QBound
   qBound.add_constructor([])
   qBound.add_constructor([param('std::vector<std::vector<double> >', 'lQB'),
@@ -776,6 +876,12 @@ def build_qp(tasks):
   # task.add_method('C', retval('Eigen::VectorXd'), [],
   #                 is_virtual=True, is_pure_virtual=True, is_const=True)
 
+  # Q of the task classes follow structureQ and QBlocks
+  task.add_method('structureQ', retval('tasks::qp::QStructure'), [], is_const=True)
+  task.add_method('QBlocks', retval('std::vector<tasks::qp::ColBlock>'), [],
+                  is_const=True)
+  task.add_method('denseQ', retval('Eigen::MatrixXd'), [], is_const=True)
+
   # HighLevelTask
   hlTask.add_method('dim', retval('int'), [])
 
@@ -788,11 +894,14 @@ def build_qp(tasks):
   hlTask.add_method('eval', retval('Eigen::VectorXd'), [])
   hlTask.add_method('speed', retval('Eigen::VectorXd'), [])
   hlTask.add_method('normalAcc', retval('Eigen::VectorXd'), [])
+  hlTask.add_method('shortJac', retval('Eigen::MatrixXd'), [])
+  hlTask.add_method('jacBlocks', retval('std::vector<tasks::qp::ColBlock>'), [])
 
   # SetPointTaskCommon
   def addSpCommonMethods(spt):
     spt.add_method('dimWeight', retval('const Eigen::VectorXd&'), [], is_const=True)
-    spt.add_method('dimWeight', None, [param('const Eigen::VectorXd&', 'dim')])
+    spt.add_method('dimWeight', None, [param('const Eigen::VectorXd&', 'dim')],
+               throw=[dom_ex])
 
     spt.add_method('update', None,
                    [param('const std::vector<rbd::MultiBody>&', 'mb'),
@@ -926,7 +1035,8 @@ def build_qp(tasks):
   toTask.add_method('objDot', None, [param('const Eigen::VectorXd&', 'obj')])
 
   toTask.add_method('dimWeight', retval('const Eigen::VectorXd&'), [], is_const=True)
-  toTask.add_method('dimWeight', None, [param('const Eigen::VectorXd&', 'w')])
+  toTask.add_method('dimWeight', None, [param('const Eigen::VectorXd&', 'w')],
+                  throw=[dom_ex])
 
   toTask.add_method('phi', retval('const Eigen::VectorXd&'), [], is_const=True)
   toTask.add_method('psi', retval('const Eigen::VectorXd&'), [], is_const=True)
@@ -1298,6 +1408,9 @@ def build_qp(tasks):
   # PositiveLambda
   positiveLambdaConstr.add_constructor([])
 
+  # WrenchConeConstr
+  wrenchConeConstr.add_constructor([])
+
   # ContactConstrCommon
   contactConstrCommon.add_method('addVirtualContact', retval('bool'),
                                  [param('const tasks::qp::ContactId&', 'contactId')])
@@ -1346,8 +1459,15 @@ def build_qp(tasks):
   collisionConstr.add_method('nrCollisions', retval('int'),
                              [], is_const=True)
   collisionConstr.add_method('reset', None, []),
+  collisionConstr.add_method('reserve', None, [param('int', 'nrCollisions')])
 
   collisionConstr.add_method('updateNrCollisions', None, []),
+  collisionConstr.add_method('nrThreads', None,
+                             [param('int', 'nrThreads'),
+                              param('std::vector<int>', 'cpus', default_value='std::vector<int>()')])
+  collisionConstr.add_method('nrThreads', retval('int'), [], is_const=True)
+  collisionConstr.add_method('skipFarPairs', None, [param('bool', 'skip')])
+  collisionConstr.add_method('skipFarPairs', retval('bool'), [], is_const=True)
 
 
   # CoMIncPlaneConstr
@@ -0,0 +1,709 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "ADMMQPSolver.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Tasks
+#include "GenQPUtils.h"
+#include "QPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+// rho bounds and scaling of equality and free lines
+static const double RHO_MIN = 1e-6;
+static const double RHO_MAX = 1e6;
+static const double RHO_EQ_SCALE = 1e3;
+// number of iterations between two residuals computation
+static const int CHECK_INTERVAL = 5;
+// number of iterations between two rho adaptation
+static const int ADAPT_INTERVAL = 25;
+// tolerance of the primal infeasibility certificate
+static const double INFEASIBILITY_TOL = 1e-5;
+
+
+/**
+	*															ADMMQPSolver
+	*/
+
+
+ADMMQPSolver::ADMMQPSolver():
+	A_(),AL_(),AU_(),
+	XL_(),XU_(),
+	Q_(),C_(),
+	nrALines_(0),
+	qCache_(),
+	eqCache_(), inEqCache_(), genInEqCache_(), boundCache_(),
+	KKT_(),
+	ldlt_(),
+	pattern_(),
+	analyzed_(false),
+	factorized_(false),
+	QDirty_(false),
+	dirtyLines_(),
+	l_(), u_(),
+	rhoVec_(), rhoInvVec_(),
+	x_(), z_(), y_(), dy_(),
+	rhs_(), sol_(), xt_(), zt_(),
+	Qx_(), Ax_(), Aty_(), Atdy_(),
+	warm_(false),
+	rho0_(0.1),
+	rho_(0.1),
+	sigma_(1e-6),
+	alpha_(1.6),
+	absTol_(1e-6),
+	relTol_(1e-6),
+	maxIter_(4000),
+	warmStart_(true),
+	status_(Status::Success),
+	iter_(0),
+	primRes_(0.),
+	dualRes_(0.)
+{
+}
+
+
+void ADMMQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+{
+	int maxALines = nrEq + nrInEq + nrGenInEq;
+	int nrLines = maxALines + nrVars;
+	int kktSize = nrVars + nrLines;
+
+	A_.resize(maxALines, nrVars);
+	AL_.resize(maxALines);
+	AU_.resize(maxALines);
+
+	XL_.resize(nrVars);
+	XU_.resize(nrVars);
+
+	Q_.resize(nrVars, nrVars);
+	C_.resize(nrVars);
+
+	// constraints only write their non zero columns
+	// so other columns must be zeroed once
+	A_.setZero();
+	AL_.setZero();
+	AU_.setZero();
+	XL_.fill(-std::numeric_limits<double>::infinity());
+	XU_.fill(std::numeric_limits<double>::infinity());
+	nrALines_ = 0;
+
+	qCache_.reset(nrVars);
+	resetConstrCache(eqCache_);
+	resetConstrCache(inEqCache_);
+	resetConstrCache(genInEqCache_);
+	resetConstrCache(boundCache_);
+
+	// the diagonal of Q and the identity lines of the bounds are always there
+	pattern_.assign(std::size_t(kktSize)*nrVars, 0);
+	for(int j = 0; j < nrVars; ++j)
+	{
+		pattern_[std::size_t(j)*kktSize + j] = 1;
+		pattern_[std::size_t(j)*kktSize + nrVars + maxALines + j] = 1;
+	}
+	dirtyLines_.resize(nrLines);
+	buildKKT();
+
+	l_.resize(nrLines);
+	u_.resize(nrLines);
+	rhoVec_.resize(nrLines);
+	rhoInvVec_.resize(nrLines);
+
+	x_.setZero(nrVars);
+	z_.setZero(nrLines);
+	y_.setZero(nrLines);
+	dy_.setZero(nrLines);
+	rhs_.resize(kktSize);
+	sol_.resize(kktSize);
+	xt_.resize(nrVars);
+	zt_.resize(nrLines);
+	Qx_.resize(nrVars);
+	Ax_.resize(nrLines);
+	Aty_.resize(nrVars);
+	Atdy_.resize(nrVars);
+
+	rho_ = rho0_;
+	warm_ = false;
+}
+
+
+void ADMMQPSolver::updateMatrix(
+	const std::vector<Task*>& tasks,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr)
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	const int nrVars = int(Q_.rows());
+	const int maxALines = int(A_.rows());
+
+	int lastNrALines = nrALines_;
+	nrALines_ = 0;
+	nrALines_ = fillEq(eqConstr, nrVars, nrALines_, A_, AL_, AU_, eqCache_);
+	nrALines_ = fillInEq(inEqConstr, nrVars, nrALines_, A_, AL_, AU_,
+		inEqCache_);
+	nrALines_ = fillGenInEq(genInEqConstr, nrVars, nrALines_, A_, AL_, AU_,
+		genInEqCache_);
+
+	fillBound(boundConstr, XL_, XU_, boundCache_);
+	// the KKT matrix only store the lower part of Q
+	if(fillQC(tasks, nrVars, Q_, C_, qCache_, false))
+	{
+		QDirty_ = true;
+	}
+
+	markFilledLines(eqCache_, eqConstr.size());
+	markFilledLines(inEqCache_, inEqConstr.size());
+	markFilledLines(genInEqCache_, genInEqConstr.size());
+	// lines that are not used anymore are zeroed in the KKT matrix
+	std::fill(dirtyLines_.begin() + std::min(lastNrALines, nrALines_),
+		dirtyLines_.begin() + std::max(lastNrALines, nrALines_), 1);
+
+	// unused lines of A are free
+	l_.head(nrALines_) = AL_.head(nrALines_);
+	u_.head(nrALines_) = AU_.head(nrALines_);
+	l_.segment(nrALines_, maxALines - nrALines_).fill(-inf);
+	u_.segment(nrALines_, maxALines - nrALines_).fill(inf);
+	l_.tail(nrVars) = XL_;
+	u_.tail(nrVars) = XU_;
+
+	if(updatePattern())
+	{
+		buildKKT();
+	}
+	updateRhoVec();
+	if(updateKKTValues())
+	{
+		factorized_ = false;
+	}
+}
+
+
+bool ADMMQPSolver::solve()
+{
+	const int nrVars = int(Q_.rows());
+	const int nrLines = int(l_.rows());
+
+	iter_ = 0;
+	primRes_ = 0.;
+	dualRes_ = 0.;
+
+	if(!analyzed_)
+	{
+		ldlt_.analyzePattern(KKT_);
+		analyzed_ = true;
+		factorized_ = false;
+	}
+
+	if(!factorized_)
+	{
+		ldlt_.factorize(KKT_);
+		if(ldlt_.info() != Eigen::Success)
+		{
+			status_ = Status::FactorizationFailed;
+			warm_ = false;
+			return false;
+		}
+		factorized_ = true;
+	}
+
+	if(warmStart_ && warm_)
+	{
+		z_ = z_.cwiseMax(l_).cwiseMin(u_);
+	}
+	else
+	{
+		x_.setZero();
+		z_.setZero();
+		y_.setZero();
+	}
+
+	while(iter_ < maxIter_)
+	{
+		++iter_;
+
+		// solve the KKT system
+		rhs_.head(nrVars) = sigma_*x_ - C_;
+		rhs_.tail(nrLines) = z_ - y_.cwiseProduct(rhoInvVec_);
+		sol_ = ldlt_.solve(rhs_);
+		xt_ = sol_.head(nrVars);
+		zt_ = z_ + (sol_.tail(nrLines) - y_).cwiseProduct(rhoInvVec_);
+
+		// relaxation and projection on [l, u]
+		x_ = alpha_*xt_ + (1. - alpha_)*x_;
+		zt_ = alpha_*zt_ + (1. - alpha_)*z_;
+		z_ = (zt_ + y_.cwiseProduct(rhoInvVec_)).cwiseMax(l_).cwiseMin(u_);
+		dy_ = rhoVec_.cwiseProduct(zt_ - z_);
+		y_ += dy_;
+
+		if(iter_ % CHECK_INTERVAL != 0 && iter_ != maxIter_)
+		{
+			continue;
+		}
+
+		products();
+		primRes_ = (Ax_ - z_).lpNorm<Eigen::Infinity>();
+		dualRes_ = (Qx_ + C_ + Aty_).lpNorm<Eigen::Infinity>();
+		double primScale = std::max(Ax_.lpNorm<Eigen::Infinity>(),
+			z_.lpNorm<Eigen::Infinity>());
+		double dualScale = std::max({Qx_.lpNorm<Eigen::Infinity>(),
+			Aty_.lpNorm<Eigen::Infinity>(), C_.lpNorm<Eigen::Infinity>()});
+
+		if(primRes_ <= absTol_ + relTol_*primScale &&
+			dualRes_ <= absTol_ + relTol_*dualScale)
+		{
+			status_ = Status::Success;
+			warm_ = true;
+			return true;
+		}
+
+		// dy is a certificate of primal infeasibility if A^T dy = 0
+		// and u^T max(dy, 0) + l^T min(dy, 0) < 0
+		double dyNorm = dy_.lpNorm<Eigen::Infinity>();
+		if(dyNorm > 0. &&
+			Atdy_.lpNorm<Eigen::Infinity>() <= INFEASIBILITY_TOL*dyNorm)
+		{
+			double support = 0.;
+			for(int i = 0; i < nrLines; ++i)
+			{
+				if(dy_(i) > 0.)
+				{
+					support += u_(i)*dy_(i);
+				}
+				else if(dy_(i) < 0.)
+				{
+					support += l_(i)*dy_(i);
+				}
+			}
+
+			if(support < -INFEASIBILITY_TOL*dyNorm)
+			{
+				status_ = Status::Infeasible;
+				warm_ = false;
+				return false;
+			}
+		}
+
+		// balance primal and dual residuals
+		if(iter_ % ADAPT_INTERVAL == 0)
+		{
+			const double tiny = 1e-10;
+			double ratio = std::sqrt((primRes_/(primScale + tiny))/
+				(dualRes_/(dualScale + tiny) + tiny));
+			double newRho = std::min(std::max(rho_*ratio, RHO_MIN), RHO_MAX);
+			if(newRho > 5.*rho_ || newRho < rho_/5.)
+			{
+				rho_ = newRho;
+				updateRhoVec();
+				updateKKTValues();
+				ldlt_.factorize(KKT_);
+				if(ldlt_.info() != Eigen::Success)
+				{
+					status_ = Status::FactorizationFailed;
+					factorized_ = false;
+					warm_ = false;
+					return false;
+				}
+			}
+		}
+	}
+
+	status_ = Status::MaxIter;
+	warm_ = false;
+	return false;
+}
+
+
+Eigen::Ref<const Eigen::VectorXd> ADMMQPSolver::result() const
+{
+	return x_;
+}
+
+
+void ADMMQPSolver::warmStart(bool warm)
+{
+	warmStart_ = warm;
+}
+
+
+bool ADMMQPSolver::warmStart() const
+{
+	return warmStart_;
+}
+
+
+bool ADMMQPSolver::nextSolveWarm() const
+{
+	return warmStart_ && warm_;
+}
+
+
+void ADMMQPSolver::resetWarmStart()
+{
+	warm_ = false;
+	rho_ = rho0_;
+}
+
+
+std::ostream& ADMMQPSolver::errorMsg(
+	const std::vector<rbd::MultiBody>& /* mbs */,
+	const std::vector<Task*>& /* tasks */,
+	const std::vector<Equality*>& /* eqConstr */,
+	const std::vector<Inequality*>& /* inEqConstr */,
+	const std::vector<GenInequality*>& /* genInEqConstr */,
+	const std::vector<Bound*>& /* boundConstr */,
+	std::ostream& out) const
+{
+	out << "ADMM output: ";
+	switch(status_)
+	{
+	case Status::Success:
+		out << "success";
+		break;
+	case Status::FactorizationFailed:
+		out << "KKT matrix factorization failed";
+		break;
+	case Status::Infeasible:
+		out << "constraints are infeasible";
+		break;
+	case Status::MaxIter:
+		out << "maximum number of iteration reached (" << iter_ << ")";
+		break;
+	}
+	out << std::endl;
+	out << "primal residual: " << primRes_ << ", dual residual: " << dualRes_ <<
+		", rho: " << rho_ << std::endl;
+	return out;
+}
+
+
+void ADMMQPSolver::rho(double rho)
+{
+	rho0_ = rho;
+	rho_ = rho;
+}
+
+
+double ADMMQPSolver::rho() const
+{
+	return rho_;
+}
+
+
+void ADMMQPSolver::tolerance(double absTol, double relTol)
+{
+	absTol_ = absTol;
+	relTol_ = relTol;
+}
+
+
+void ADMMQPSolver::maxIter(int maxIter)
+{
+	maxIter_ = maxIter;
+}
+
+
+int ADMMQPSolver::maxIter() const
+{
+	return maxIter_;
+}
+
+
+ADMMQPSolver::Status ADMMQPSolver::status() const
+{
+	return status_;
+}
+
+
+int ADMMQPSolver::iter() const
+{
+	return iter_;
+}
+
+
+void ADMMQPSolver::markFilledLines(const std::vector<ConstrCache>& cache,
+	std::size_t nrConstr)
+{
+	for(std::size_t i = 0; i < nrConstr; ++i)
+	{
+		const ConstrCache& cc = cache[i];
+		if(cc.filled)
+		{
+			std::fill(dirtyLines_.begin() + cc.line,
+				dirtyLines_.begin() + cc.line + cc.nrLines, 1);
+		}
+	}
+}
+
+
+bool ADMMQPSolver::updatePattern()
+{
+	const int nrVars = int(Q_.rows());
+	const int kktSize = int(KKT_.rows());
+
+	bool grown = false;
+	// add the strictly lower non zeros of a Q block
+	auto addQBlock = [this, kktSize, &grown](int row, int col, int rows, int cols)
+	{
+		for(int j = col; j < col + cols; ++j)
+		{
+			char* colPattern = &pattern_[std::size_t(j)*kktSize];
+			for(int i = std::max(row, j + 1); i < row + rows; ++i)
+			{
+				if(Q_(i, j) != 0. && !colPattern[i])
+				{
+					colPattern[i] = 1;
+					grown = true;
+				}
+			}
+		}
+	};
+
+	if(QDirty_)
+	{
+		// new non zeros can only come from the QBlocks of the tasks
+		// summed by the last fill, diagonal tasks don't add any
+		for(const Task* t: qCache_.changed)
+		{
+			QStructure structure = t->structureQ();
+			if(structure == QStructure::Diagonal ||
+				 structure == QStructure::ScaledIdentity)
+			{
+				continue;
+			}
+
+			const std::vector<ColBlock>& blocks = t->QBlocks();
+			std::pair<int, int> b = t->begin();
+			if(blocks.empty())
+			{
+				int size = int(t->C().rows());
+				addQBlock(b.first, b.second, size, size);
+				continue;
+			}
+
+			for(std::size_t j = 0; j < blocks.size(); ++j)
+			{
+				const ColBlock& cb = blocks[j];
+				for(std::size_t i = j; i < blocks.size(); ++i)
+				{
+					const ColBlock& rb = blocks[i];
+					addQBlock(b.first + rb.begin, b.second + cb.begin, rb.size, cb.size);
+				}
+			}
+		}
+	}
+
+	for(int r = 0; r < nrALines_; ++r)
+	{
+		if(!dirtyLines_[r])
+		{
+			continue;
+		}
+
+		for(int j = 0; j < nrVars; ++j)
+		{
+			char& nz = pattern_[std::size_t(j)*kktSize + nrVars + r];
+			if(A_(r, j) != 0. && !nz)
+			{
+				nz = 1;
+				grown = true;
+			}
+		}
+	}
+
+	return grown;
+}
+
+
+void ADMMQPSolver::buildKKT()
+{
+	const int nrVars = int(Q_.rows());
+	const int kktSize = nrVars + int(A_.rows()) + nrVars;
+
+	Eigen::VectorXi nnz(kktSize);
+	for(int j = 0; j < kktSize; ++j)
+	{
+		nnz(j) = j < nrVars ? int(std::count(pattern_.begin() + std::size_t(j)*kktSize,
+			pattern_.begin() + std::size_t(j + 1)*kktSize, 1)) : 1;
+	}
+
+	KKT_.resize(kktSize, kktSize);
+	KKT_.setZero();
+	KKT_.reserve(nnz);
+	for(int j = 0; j < kktSize; ++j)
+	{
+		if(j < nrVars)
+		{
+			const char* col = &pattern_[std::size_t(j)*kktSize];
+			for(int i = j; i < kktSize; ++i)
+			{
+				if(col[i])
+				{
+					KKT_.insert(i, j) = 0.;
+				}
+			}
+		}
+		else
+		{
+			KKT_.insert(j, j) = 0.;
+		}
+	}
+	KKT_.makeCompressed();
+
+	// all the values must be copied in the new matrix
+	QDirty_ = true;
+	std::fill(dirtyLines_.begin(), dirtyLines_.end(), 1);
+	analyzed_ = false;
+	factorized_ = false;
+}
+
+
+bool ADMMQPSolver::updateKKTValues()
+{
+	const int nrVars = int(Q_.rows());
+	const int maxALines = int(A_.rows());
+	const int kktSize = int(KKT_.rows());
+
+	double* values = KKT_.valuePtr();
+	const int* outer = KKT_.outerIndexPtr();
+	const int* inner = KKT_.innerIndexPtr();
+
+	bool changed = false;
+	for(int j = 0; j < kktSize; ++j)
+	{
+		for(int p = outer[j]; p < outer[j + 1]; ++p)
+		{
+			int i = inner[p];
+			double v;
+			if(j >= nrVars)
+			{
+				v = -rhoInvVec_(j - nrVars);
+			}
+			else if(i < nrVars)
+			{
+				if(!QDirty_)
+				{
+					continue;
+				}
+				v = i == j ? Q_(i, j) + sigma_ : Q_(i, j);
+			}
+			else
+			{
+				int r = i - nrVars;
+				if(!dirtyLines_[r])
+				{
+					continue;
+				}
+
+				if(r < nrALines_)
+				{
+					v = A_(r, j);
+				}
+				else
+				{
+					v = r - maxALines == j ? 1. : 0.;
+				}
+			}
+
+			if(values[p] != v)
+			{
+				values[p] = v;
+				changed = true;
+			}
+		}
+	}
+
+	QDirty_ = false;
+	std::fill(dirtyLines_.begin(), dirtyLines_.end(), 0);
+	return changed;
+}
+
+
+void ADMMQPSolver::updateRhoVec()
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	for(int i = 0; i < int(l_.rows()); ++i)
+	{
+		if(l_(i) == -inf && u_(i) == inf)
+		{
+			rhoVec_(i) = RHO_MIN;
+		}
+		else if(l_(i) == u_(i))
+		{
+			rhoVec_(i) = RHO_EQ_SCALE*rho_;
+		}
+		else
+		{
+			rhoVec_(i) = rho_;
+		}
+	}
+	rhoInvVec_ = rhoVec_.cwiseInverse();
+}
+
+
+void ADMMQPSolver::products()
+{
+	const int nrVars = int(Q_.rows());
+	const double* values = KKT_.valuePtr();
+	const int* outer = KKT_.outerIndexPtr();
+	const int* inner = KKT_.innerIndexPtr();
+
+	Qx_.setZero();
+	Ax_.setZero();
+	Aty_.setZero();
+	Atdy_.setZero();
+	// only the first nrVars columns hold Q and A
+	for(int j = 0; j < nrVars; ++j)
+	{
+		for(int p = outer[j]; p < outer[j + 1]; ++p)
+		{
+			int i = inner[p];
+			double v = values[p];
+			if(i == j)
+			{
+				Qx_(j) += (v - sigma_)*x_(j);
+			}
+			else if(i < nrVars)
+			{
+				Qx_(i) += v*x_(j);
+				Qx_(j) += v*x_(i);
+			}
+			else
+			{
+				Ax_(i - nrVars) += v*x_(j);
+				Aty_(j) += v*y_(i - nrVars);
+				Atdy_(j) += v*dy_(i - nrVars);
+			}
+		}
+	}
+}
+
+
+} // namespace qp
+
+} // namespace tasks
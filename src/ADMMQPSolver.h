@@ -0,0 +1,180 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
+
+// Tasks
+#include "GenQPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* GenQPSolver interface implementation with an operator splitting
+	* method (ADMM, Stellato et al. 2020).
+	* Bounds and constraints are stacked in a sparse matrix
+	* \f$ \bar{A} = [A; I] \f$ and the KKT matrix
+	* \f[
+	* \left[ \begin{array}{cc}
+	* Q + \sigma I & \bar{A}^T \\
+	* \bar{A} & -\text{diag}(\rho)^{-1}
+	* \end{array} \right]
+	* \f]
+	* is factorized with a sparse LDLT.
+	* The symbolic factorization is only computed again when a new non zero
+	* appear and the numeric one when a value or \f$ \rho \f$ change.
+	* Only the constraint lines copied by the last updateMatrix
+	* (see ConstrCache) and \f$ Q \f$ if a task has changed are copied
+	* in the KKT matrix.
+	* Since a configuration dependent task or constraint change the KKT
+	* values at each control tick, the numeric factorization is then
+	* computed at each solve.
+	*/
+class ADMMQPSolver : public GenQPSolver
+{
+public:
+	/// Reason of the last ADMMQPSolver::solve failure.
+	enum class Status
+	{
+		Success,
+		FactorizationFailed, ///< The KKT matrix can't be factorized.
+		Infeasible, ///< Constraints are primal infeasible.
+		MaxIter ///< Residuals are still above tolerance.
+	};
+
+public:
+	ADMMQPSolver();
+
+	virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq);
+	virtual void updateMatrix(const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr);
+	virtual bool solve();
+	virtual Eigen::Ref<const Eigen::VectorXd> result() const;
+	virtual void warmStart(bool warm);
+	virtual bool warmStart() const;
+	virtual bool nextSolveWarm() const;
+	virtual void resetWarmStart();
+	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		std::ostream& out) const;
+
+	/// Set the initial step size, adapted during the iterations.
+	void rho(double rho);
+	double rho() const;
+
+	/**
+		* Set the stopping criteria.
+		* @param absTol Absolute tolerance on the primal and dual residuals.
+		* @param relTol Relative tolerance on the primal and dual residuals.
+		*/
+	void tolerance(double absTol, double relTol);
+
+	void maxIter(int maxIter);
+	int maxIter() const;
+
+	Status status() const;
+	int iter() const;
+
+private:
+	/// Mark the lines of the constraints copied by the last fill.
+	void markFilledLines(const std::vector<ConstrCache>& cache,
+		std::size_t nrConstr);
+	/**
+		* Add the new non zeros of the Q blocks of the tasks summed by the
+		* last fill and of the dirty lines to the pattern.
+		*/
+	bool updatePattern();
+	void buildKKT();
+	/**
+		* Copy the \f$ \rho \f$ values, Q if QDirty_ and the dirty lines
+		* in the KKT matrix then clear the dirty flags.
+		* @return true if a value has changed.
+		*/
+	bool updateKKTValues();
+	void updateRhoVec();
+	/// Compute Qx_, Ax_, Aty_ and Atdy_ with the KKT matrix.
+	void products();
+
+private:
+	Eigen::MatrixXd A_;
+	Eigen::VectorXd AL_, AU_;
+
+	Eigen::VectorXd XL_;
+	Eigen::VectorXd XU_;
+
+	Eigen::MatrixXd Q_;
+	Eigen::VectorXd C_;
+
+	int nrALines_;
+
+	QCache qCache_;
+	std::vector<ConstrCache> eqCache_, inEqCache_, genInEqCache_, boundCache_;
+
+	// KKT matrix (lower part) and its factorization
+	Eigen::SparseMatrix<double> KKT_;
+	Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower> ldlt_;
+	/// Lower part of [Q; A] that can be non zero.
+	std::vector<char> pattern_;
+	bool analyzed_, factorized_;
+	/// Q and lines of [A; I] that must be copied in the KKT matrix
+	bool QDirty_;
+	std::vector<char> dirtyLines_;
+
+	// stacked bounds of [A; I]
+	Eigen::VectorXd l_, u_;
+	Eigen::VectorXd rhoVec_, rhoInvVec_;
+
+	// iterates
+	Eigen::VectorXd x_, z_, y_, dy_;
+	Eigen::VectorXd rhs_, sol_, xt_, zt_;
+	Eigen::VectorXd Qx_, Ax_, Aty_, Atdy_;
+	bool warm_;
+
+	double rho0_, rho_; ///< initial and adapted step size
+	double sigma_, alpha_;
+	double absTol_, relTol_;
+	int maxIter_;
+	bool warmStart_;
+
+	Status status_;
+	int iter_;
+	double primRes_, dualRes_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,892 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "GIQPSolver.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Tasks
+#include "GenQPUtils.h"
+#include "QPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+// a step direction smaller than this (relatively to R norm)
+// mean the new constraint is linearly dependent of the active set
+static const double DEGENERATE_TOL = 1e3*std::numeric_limits<double>::epsilon();
+
+
+/**
+	*															GIQPSolver
+	*/
+
+
+GIQPSolver::GIQPSolver():
+	A_(),AL_(),AU_(),
+	XL_(),XU_(),
+	Q_(),C_(),
+	nrEqLines_(0), nrALines_(0),
+	qCache_(),
+	eqCache_(), inEqCache_(), genInEqCache_(), boundCache_(),
+	L_(), J0_(),
+	factorized_(false),
+	J_(), R_(),
+	x_(), d_(), z_(), r_(), u_(), np_(), Ax_(),
+	RNorm_(1.),
+	activeSet_(),
+	isActive_(),
+	warmSet_(),
+	nrWarm_(0),
+	warmStart_(true),
+	feasibilityTol_(1e-6),
+	status_(Status::Success),
+	iter_(0),
+	violatedVar_(-1),
+	violatedLine_(-1),
+	eliminateEq_(false),
+	reduced_(),
+	maxReducedLines_(0),
+	AeqT_(),
+	eqQR_(),
+	eqQ_(), Z_(), QZ_(),
+	eqQWork_(),
+	eqRhs_(), x0_(), Qx0_(), Ax0_(),
+	reducedBoundVars_()
+{
+}
+
+
+void GIQPSolver::reserve(int maxVars, int maxEq, int maxInEq, int maxGenInEq)
+{
+	int maxALines = maxEq + maxInEq + maxGenInEq;
+	A_.reserve(maxALines*maxVars);
+	AL_.reserve(maxALines);
+	AU_.reserve(maxALines);
+
+	XL_.reserve(maxVars);
+	XU_.reserve(maxVars);
+
+	Q_.reserve(maxVars*maxVars);
+	C_.reserve(maxVars);
+	qCache_.reserve(maxVars);
+
+	L_.reserve(maxVars*maxVars);
+	J0_.reserve(maxVars*maxVars);
+
+	J_.reserve(maxVars*maxVars);
+	R_.reserve(maxVars*maxVars);
+	for(ReservedMatrix<Eigen::VectorXd>* v: {&x_, &d_, &z_, &r_, &np_})
+	{
+		v->reserve(maxVars);
+	}
+	u_.reserve(maxVars + 1);
+	Ax_.reserve(maxALines);
+
+	activeSet_.reserve(maxVars + 1);
+	isActive_.reserve(2*(maxVars + maxALines));
+	warmSet_.reserve(maxVars);
+	reducedBoundVars_.reserve(maxVars);
+}
+
+
+void GIQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+{
+	int maxALines = nrEq + nrInEq + nrGenInEq;
+	A_.resize(maxALines, nrVars);
+	AL_.resize(maxALines);
+	AU_.resize(maxALines);
+
+	XL_.resize(nrVars);
+	XU_.resize(nrVars);
+
+	Q_.resize(nrVars, nrVars);
+	C_.resize(nrVars);
+
+	// constraints only write their non zero columns
+	// so other columns must be zeroed once
+	A_.setZero();
+	AL_.setZero();
+	AU_.setZero();
+	XL_.fill(-std::numeric_limits<double>::infinity());
+	XU_.fill(std::numeric_limits<double>::infinity());
+
+	qCache_.reset(nrVars);
+	resetConstrCache(eqCache_);
+	resetConstrCache(inEqCache_);
+	resetConstrCache(genInEqCache_);
+	resetConstrCache(boundCache_);
+
+	L_.resize(nrVars, nrVars);
+	J0_.resize(nrVars, nrVars);
+	factorized_ = false;
+
+	J_.resize(nrVars, nrVars);
+	R_.resize(nrVars, nrVars);
+	x_.setZero(nrVars);
+	d_.resize(nrVars);
+	z_.resize(nrVars);
+	r_.resize(nrVars);
+	u_.resize(nrVars + 1);
+	np_.resize(nrVars);
+	Ax_.resize(maxALines);
+
+	activeSet_.resize(nrVars + 1);
+	isActive_.resize(2*(nrVars + maxALines));
+
+	warmSet_.resize(nrVars);
+	nrWarm_ = 0;
+
+	// the reduced QP can have a line for each inequality and each bound
+	maxReducedLines_ = nrInEq + nrGenInEq + nrVars;
+	reducedBoundVars_.reserve(nrVars);
+	if(reduced_)
+	{
+		reduced_->resetWarmStart();
+	}
+}
+
+
+void GIQPSolver::updateMatrix(
+	const std::vector<Task*>& tasks,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr)
+{
+	const int nrVars = int(Q_.rows());
+
+	nrEqLines_ = fillEq(eqConstr, nrVars, 0, A_, AL_, AU_, eqCache_);
+	nrALines_ = fillInEq(inEqConstr, nrVars, nrEqLines_, A_, AL_, AU_,
+		inEqCache_);
+	nrALines_ = fillGenInEq(genInEqConstr, nrVars, nrALines_, A_, AL_, AU_,
+		genInEqCache_);
+
+	fillBound(boundConstr, XL_, XU_, boundCache_);
+	// the Cholesky decomposition only read the lower part of Q
+	if(fillQC(tasks, nrVars, Q_, C_, qCache_, false))
+	{
+		factorized_ = false;
+	}
+}
+
+
+bool GIQPSolver::solve()
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	const int nrVars = int(Q_.rows());
+	const int nrRows = nrALines_ - nrEqLines_;
+	const int nrSides = 2*(nrVars + nrRows);
+	const int maxIter = 10*(nrVars + nrALines_) + 10;
+
+	iter_ = 0;
+	violatedVar_ = -1;
+	violatedLine_ = -1;
+
+	if(eliminateEq_ && nrEqLines_ > 0)
+	{
+		return solveReduced();
+	}
+
+	if(!factorized_ && !factorize())
+	{
+		status_ = Status::NotPositiveDefinite;
+		return false;
+	}
+
+	J_ = J0_;
+	R_.setZero();
+	RNorm_ = 1.;
+
+	// unconstrained minimum x = -Q^{-1} c = -J0 J0^T c
+	d_.noalias() = J0_.transpose()*C_;
+	x_.noalias() = -J0_*d_;
+
+	// add equality constraints
+	int iq = 0;
+	for(int i = 0; i < nrEqLines_; ++i)
+	{
+		np_ = A_.row(i).transpose();
+		stepDirection(iq);
+
+		double dNorm2 = iq < nrVars ? d_.tail(nrVars - iq).squaredNorm() : 0.;
+		double res = AL_(i) - np_.dot(x_);
+		if(std::sqrt(dNorm2) <= DEGENERATE_TOL*RNorm_)
+		{
+			// redundant equality, only a problem if it's not satisfied
+			if(std::abs(res) <= feasibilityTol_)
+			{
+				continue;
+			}
+			violatedLine_ = i;
+			status_ = Status::DependentEqualities;
+			return false;
+		}
+
+		double t = res/dNorm2;
+		x_ += t*z_;
+		u_(iq) = t;
+		u_.head(iq) -= t*r_.head(iq);
+		activeSet_[iq] = -1 - i;
+		if(!addConstraint(iq))
+		{
+			violatedLine_ = i;
+			status_ = Status::DependentEqualities;
+			return false;
+		}
+	}
+	const int meq = iq;
+
+	std::fill(isActive_.begin(), isActive_.begin() + nrSides, 0);
+	int warmIndex = 0;
+
+	while(true)
+	{
+		// step 1: choose a violated constraint
+		int ip = -1;
+		double sp = -feasibilityTol_;
+
+		// constraints of the previous active set are tried first
+		while(warmStart_ && ip == -1 && warmIndex < nrWarm_)
+		{
+			int k = warmSet_[warmIndex++];
+			if(k < nrSides && !isActive_[k])
+			{
+				double s = slack(k);
+				if(s < sp)
+				{
+					ip = k;
+					sp = s;
+				}
+			}
+		}
+
+		if(ip == -1)
+		{
+			for(int j = 0; j < nrVars; ++j)
+			{
+				double sl = x_(j) - XL_(j);
+				double su = XU_(j) - x_(j);
+				if(sl < sp && !isActive_[2*j])
+				{
+					ip = 2*j;
+					sp = sl;
+				}
+				if(su < sp && !isActive_[2*j + 1])
+				{
+					ip = 2*j + 1;
+					sp = su;
+				}
+			}
+
+			if(nrRows > 0)
+			{
+				Ax_.head(nrRows).noalias() = A_.middleRows(nrEqLines_, nrRows)*x_;
+			}
+			for(int i = 0; i < nrRows; ++i)
+			{
+				int k = 2*(nrVars + i);
+				double sl = Ax_(i) - AL_(nrEqLines_ + i);
+				double su = AU_(nrEqLines_ + i) - Ax_(i);
+				if(sl < sp && !isActive_[k])
+				{
+					ip = k;
+					sp = sl;
+				}
+				if(su < sp && !isActive_[k + 1])
+				{
+					ip = k + 1;
+					sp = su;
+				}
+			}
+		}
+
+		// all constraints are satisfied
+		if(ip == -1)
+		{
+			break;
+		}
+
+		normal(ip);
+		u_(iq) = 0.;
+		activeSet_[iq] = ip;
+
+		// step 2: add ip to the active set
+		while(true)
+		{
+			if(++iter_ > maxIter)
+			{
+				status_ = Status::MaxIter;
+				nrWarm_ = 0;
+				return false;
+			}
+
+			stepDirection(iq);
+
+			// partial step length, biggest step in dual space
+			// that keep dual feasibility
+			double t1 = inf;
+			int l = -1;
+			for(int k = meq; k < iq; ++k)
+			{
+				if(r_(k) > 0. && u_(k)/r_(k) < t1)
+				{
+					t1 = u_(k)/r_(k);
+					l = activeSet_[k];
+				}
+			}
+
+			// full step length, step in primal space that satisfy ip
+			double dNorm2 = iq < nrVars ? d_.tail(nrVars - iq).squaredNorm() : 0.;
+			double t2 = inf;
+			if(std::sqrt(dNorm2) > DEGENERATE_TOL*RNorm_)
+			{
+				t2 = -sp/dNorm2;
+			}
+
+			double t = std::min(t1, t2);
+			if(t >= inf)
+			{
+				if(ip < 2*nrVars)
+				{
+					violatedVar_ = ip/2;
+				}
+				else
+				{
+					violatedLine_ = nrEqLines_ + (ip - 2*nrVars)/2;
+				}
+				status_ = Status::Infeasible;
+				nrWarm_ = 0;
+				return false;
+			}
+
+			u_.head(iq) -= t*r_.head(iq);
+			u_(iq) += t;
+
+			// step in dual space only
+			if(t2 >= inf)
+			{
+				isActive_[l] = 0;
+				deleteConstraint(meq, iq, l);
+				continue;
+			}
+
+			// step in primal and dual space
+			x_ += t*z_;
+			if(t == t2)
+			{
+				if(!addConstraint(iq))
+				{
+					status_ = Status::Infeasible;
+					nrWarm_ = 0;
+					return false;
+				}
+				isActive_[ip] = 1;
+				break;
+			}
+
+			isActive_[l] = 0;
+			deleteConstraint(meq, iq, l);
+			sp = slack(ip);
+		}
+	}
+
+	nrWarm_ = iq - meq;
+	std::copy(activeSet_.begin() + meq, activeSet_.begin() + iq, warmSet_.begin());
+
+	status_ = Status::Success;
+	return true;
+}
+
+
+Eigen::Ref<const Eigen::VectorXd> GIQPSolver::result() const
+{
+	return x_;
+}
+
+
+void GIQPSolver::warmStart(bool warm)
+{
+	warmStart_ = warm;
+}
+
+
+bool GIQPSolver::warmStart() const
+{
+	return warmStart_;
+}
+
+
+bool GIQPSolver::nextSolveWarm() const
+{
+	return warmStart_ &&
+		(nrWarm_ > 0 || (eliminateEq_ && reduced_->nrWarm_ > 0));
+}
+
+
+void GIQPSolver::resetWarmStart()
+{
+	nrWarm_ = 0;
+	if(reduced_)
+	{
+		reduced_->resetWarmStart();
+	}
+}
+
+
+std::ostream& GIQPSolver::errorMsg(
+	const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<Task*>& /* tasks */,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr,
+	std::ostream& out) const
+{
+	out << "GI output: ";
+	switch(status_)
+	{
+	case Status::Success:
+		out << "success";
+		break;
+	case Status::NotPositiveDefinite:
+		out << "Q is not positive definite";
+		break;
+	case Status::DependentEqualities:
+		out << "equality constraints are inconsistent";
+		break;
+	case Status::Infeasible:
+		out << "constraints are infeasible";
+		break;
+	case Status::MaxIter:
+		out << "maximum number of iteration reached (" << iter_ << ")";
+		break;
+	}
+	out << std::endl;
+
+	if(violatedVar_ != -1)
+	{
+		for(Bound* b: boundConstr)
+		{
+			int start = b->beginVar();
+			int end = start + int(b->Lower().rows());
+			if(violatedVar_ >= start && violatedVar_ < end)
+			{
+				int line = violatedVar_ - start;
+				out << b->nameBound() << " violated at line: " << line << std::endl;
+				out << b->descBound(mbs, line) << std::endl;
+				out << XL_(violatedVar_) << " <= " << x_(violatedVar_) << " <= " <<
+					XU_(violatedVar_) << std::endl;
+				break;
+			}
+		}
+	}
+
+	if(violatedLine_ != -1)
+	{
+		int start = 0;
+		int end = 0;
+
+		constrErrorMsg(mbs, x_, violatedLine_, eqConstr, start, end, out);
+		constrErrorMsg(mbs, x_, violatedLine_, inEqConstr, start, end, out);
+		constrErrorMsg(mbs, x_, violatedLine_, genInEqConstr, start, end, out);
+		out << std::endl;
+	}
+
+	return out;
+}
+
+
+void GIQPSolver::feasibilityTol(double tol)
+{
+	feasibilityTol_ = tol;
+}
+
+
+double GIQPSolver::feasibilityTol() const
+{
+	return feasibilityTol_;
+}
+
+
+void GIQPSolver::eliminateEqualities(bool eliminate)
+{
+	eliminateEq_ = eliminate;
+	if(eliminate && !reduced_)
+	{
+		reduced_.reset(new GIQPSolver);
+	}
+}
+
+
+bool GIQPSolver::eliminateEqualities() const
+{
+	return eliminateEq_;
+}
+
+
+GIQPSolver::Status GIQPSolver::status() const
+{
+	return status_;
+}
+
+
+int GIQPSolver::iter() const
+{
+	return iter_;
+}
+
+
+bool GIQPSolver::solveReduced()
+{
+	const int nrVars = int(Q_.rows());
+	const int nrRows = nrALines_ - nrEqLines_;
+
+	// A_eq^T P = Qr R so A_eq x = b_eq become R^T Qr^T x = P^T b_eq,
+	// with Qr^T x = [w; y] the first rank lines give w and
+	// the other lines must be satisfied by w
+	AeqT_ = A_.topRows(nrEqLines_).transpose();
+	eqQR_.compute(AeqT_);
+	const int rank = int(eqQR_.rank());
+	const int nrRedVars = nrVars - rank;
+	const Eigen::MatrixXd& R = eqQR_.matrixQR();
+
+	eqRhs_ = eqQR_.colsPermutation().transpose()*AL_.head(nrEqLines_);
+	R.topLeftCorner(rank, rank).triangularView<Eigen::Upper>().transpose().
+		solveInPlace(eqRhs_.head(rank));
+	if(rank < nrEqLines_)
+	{
+		eqRhs_.tail(nrEqLines_ - rank).noalias() -=
+			R.topRightCorner(rank, nrEqLines_ - rank).transpose()*eqRhs_.head(rank);
+		for(int i = rank; i < nrEqLines_; ++i)
+		{
+			if(std::abs(eqRhs_(i)) > feasibilityTol_)
+			{
+				violatedLine_ = eqQR_.colsPermutation().indices()(i);
+				status_ = Status::DependentEqualities;
+				return false;
+			}
+		}
+	}
+
+	// householderQ() evaluation would allocate its workspace at each call
+	eqQ_.resize(nrVars, nrVars);
+	eqQWork_.resize(nrVars);
+	eqQR_.householderQ().evalTo(eqQ_, eqQWork_);
+	x0_.noalias() = eqQ_.leftCols(rank)*eqRhs_.head(rank);
+	Z_ = eqQ_.rightCols(nrRedVars);
+
+	// minimize 1/2 y^T Z^T Q Z y + y^T Z^T (Q x0 + c)
+	GIQPSolver& red = *reduced_;
+	if(int(red.Q_.rows()) != nrRedVars || int(red.A_.rows()) != maxReducedLines_)
+	{
+		red.updateSize(nrRedVars, 0, 0, maxReducedLines_);
+	}
+
+	// only the lower part of Q is filled
+	QZ_.noalias() = Q_.selfadjointView<Eigen::Lower>()*Z_;
+	red.Q_.noalias() = Z_.transpose()*QZ_;
+	Qx0_.noalias() = Q_.selfadjointView<Eigen::Lower>()*x0_;
+	Qx0_ += C_;
+	red.C_.noalias() = Z_.transpose()*Qx0_;
+	red.factorized_ = false;
+
+	// AL - A x0 <= A Z y <= AU - A x0
+	if(nrRows > 0)
+	{
+		red.A_.topRows(nrRows).noalias() = A_.middleRows(nrEqLines_, nrRows)*Z_;
+		Ax0_.noalias() = A_.middleRows(nrEqLines_, nrRows)*x0_;
+		red.AL_.head(nrRows) = AL_.segment(nrEqLines_, nrRows) - Ax0_;
+		red.AU_.head(nrRows) = AU_.segment(nrEqLines_, nrRows) - Ax0_;
+	}
+
+	// XL - x0 <= Z y <= XU - x0 for variables with a finite bound
+	int line = nrRows;
+	reducedBoundVars_.clear();
+	for(int j = 0; j < nrVars; ++j)
+	{
+		if(std::isinf(XL_(j)) && std::isinf(XU_(j)))
+		{
+			continue;
+		}
+		red.A_.row(line) = Z_.row(j);
+		red.AL_(line) = XL_(j) - x0_(j);
+		red.AU_(line) = XU_(j) - x0_(j);
+		reducedBoundVars_.push_back(j);
+		++line;
+	}
+	red.nrEqLines_ = 0;
+	red.nrALines_ = line;
+
+	red.warmStart_ = warmStart_;
+	red.feasibilityTol_ = feasibilityTol_;
+	bool success = red.solve();
+
+	x_ = x0_;
+	x_.noalias() += Z_*red.x_;
+	status_ = red.status_;
+	iter_ = red.iter_;
+	if(red.violatedLine_ != -1)
+	{
+		if(red.violatedLine_ < nrRows)
+		{
+			violatedLine_ = nrEqLines_ + red.violatedLine_;
+		}
+		else
+		{
+			violatedVar_ = reducedBoundVars_[red.violatedLine_ - nrRows];
+		}
+	}
+
+	return success;
+}
+
+
+bool GIQPSolver::factorize()
+{
+	const int nrVars = int(Q_.rows());
+
+	// unblocked Cholesky decomposition Q = L L^T, only the lower part is used
+	L_ = Q_;
+	for(int j = 0; j < nrVars; ++j)
+	{
+		double dj = L_(j, j) - L_.row(j).head(j).squaredNorm();
+		if(!(dj > 0.))
+		{
+			return false;
+		}
+		dj = std::sqrt(dj);
+		L_(j, j) = dj;
+
+		int m = nrVars - j - 1;
+		if(m > 0)
+		{
+			if(j > 0)
+			{
+				L_.col(j).tail(m).noalias() -=
+					L_.bottomLeftCorner(m, j)*L_.row(j).head(j).transpose();
+			}
+			L_.col(j).tail(m) /= dj;
+		}
+	}
+
+	// J0 = L^{-T} is upper triangular, column i is the solution of
+	// L^T j_i = e_i restricted to the i+1 first lines
+	J0_.setIdentity();
+	for(int i = 0; i < nrVars; ++i)
+	{
+		L_.topLeftCorner(i + 1, i + 1).triangularView<Eigen::Lower>().transpose().
+			solveInPlace(J0_.col(i).head(i + 1));
+	}
+
+	factorized_ = true;
+	return true;
+}
+
+
+double GIQPSolver::slack(int k) const
+{
+	const int nrVars = int(Q_.rows());
+	if(k < 2*nrVars)
+	{
+		int j = k/2;
+		return k % 2 == 0 ? x_(j) - XL_(j) : XU_(j) - x_(j);
+	}
+
+	int line = nrEqLines_ + (k - 2*nrVars)/2;
+	double ax = A_.row(line).dot(x_);
+	return k % 2 == 0 ? ax - AL_(line) : AU_(line) - ax;
+}
+
+
+void GIQPSolver::normal(int k)
+{
+	const int nrVars = int(Q_.rows());
+	double sign = k % 2 == 0 ? 1. : -1.;
+	if(k < 2*nrVars)
+	{
+		np_.setZero();
+		np_(k/2) = sign;
+	}
+	else
+	{
+		np_ = sign*A_.row(nrEqLines_ + (k - 2*nrVars)/2).transpose();
+	}
+}
+
+
+void GIQPSolver::stepDirection(int iq)
+{
+	const int nrVars = int(Q_.rows());
+
+	d_.noalias() = J_.transpose()*np_;
+
+	// step in primal space
+	if(iq < nrVars)
+	{
+		z_.noalias() = J_.rightCols(nrVars - iq)*d_.tail(nrVars - iq);
+	}
+	else
+	{
+		z_.setZero();
+	}
+
+	// negative of the step in dual space
+	if(iq > 0)
+	{
+		r_.head(iq) = d_.head(iq);
+		R_.topLeftCorner(iq, iq).triangularView<Eigen::Upper>().solveInPlace(
+			r_.head(iq));
+	}
+}
+
+
+bool GIQPSolver::addConstraint(int& iq)
+{
+	const int nrVars = int(Q_.rows());
+
+	// Givens rotations to zero d(iq+1:n) and keep J^T np = [R; 0] updated
+	for(int j = nrVars - 1; j >= iq + 1; --j)
+	{
+		double cc = d_(j - 1);
+		double ss = d_(j);
+		double h = std::hypot(cc, ss);
+		if(h == 0.)
+		{
+			continue;
+		}
+
+		d_(j) = 0.;
+		ss /= h;
+		cc /= h;
+		if(cc < 0.)
+		{
+			cc = -cc;
+			ss = -ss;
+			d_(j - 1) = -h;
+		}
+		else
+		{
+			d_(j - 1) = h;
+		}
+
+		double xny = ss/(1. + cc);
+		for(int k = 0; k < nrVars; ++k)
+		{
+			double t1 = J_(k, j - 1);
+			double t2 = J_(k, j);
+			J_(k, j - 1) = t1*cc + t2*ss;
+			J_(k, j) = xny*(t1 + J_(k, j - 1)) - t2;
+		}
+	}
+
+	++iq;
+	R_.col(iq - 1).head(iq) = d_.head(iq);
+
+	if(std::abs(d_(iq - 1)) <= std::numeric_limits<double>::epsilon()*RNorm_)
+	{
+		return false;
+	}
+	RNorm_ = std::max(RNorm_, std::abs(d_(iq - 1)));
+	return true;
+}
+
+
+void GIQPSolver::deleteConstraint(int meq, int& iq, int l)
+{
+	const int nrVars = int(Q_.rows());
+
+	int qq = meq;
+	while(qq < iq && activeSet_[qq] != l)
+	{
+		++qq;
+	}
+
+	// remove the constraint from the active set and the duals,
+	// the candidate constraint in iq is moved too
+	for(int i = qq; i < iq - 1; ++i)
+	{
+		activeSet_[i] = activeSet_[i + 1];
+		u_(i) = u_(i + 1);
+		R_.col(i) = R_.col(i + 1);
+	}
+	activeSet_[iq - 1] = activeSet_[iq];
+	u_(iq - 1) = u_(iq);
+	u_(iq) = 0.;
+	R_.col(iq - 1).head(iq).setZero();
+
+	--iq;
+	if(iq == 0)
+	{
+		return;
+	}
+
+	// Givens rotations to restore R upper triangular form
+	for(int j = qq; j < iq; ++j)
+	{
+		double cc = R_(j, j);
+		double ss = R_(j + 1, j);
+		double h = std::hypot(cc, ss);
+		if(h == 0.)
+		{
+			continue;
+		}
+
+		cc /= h;
+		ss /= h;
+		R_(j + 1, j) = 0.;
+		if(cc < 0.)
+		{
+			R_(j, j) = -h;
+			cc = -cc;
+			ss = -ss;
+		}
+		else
+		{
+			R_(j, j) = h;
+		}
+
+		double xny = ss/(1. + cc);
+		for(int k = j + 1; k < iq; ++k)
+		{
+			double t1 = R_(j, k);
+			double t2 = R_(j + 1, k);
+			R_(j, k) = t1*cc + t2*ss;
+			R_(j + 1, k) = xny*(t1 + R_(j, k)) - t2;
+		}
+		for(int k = 0; k < nrVars; ++k)
+		{
+			double t1 = J_(k, j);
+			double t2 = J_(k, j + 1);
+			J_(k, j) = t1*cc + t2*ss;
+			J_(k, j + 1) = xny*(J_(k, j) + t1) - t2;
+		}
+	}
+}
+
+
+} // namespace qp
+
+} // namespace tasks
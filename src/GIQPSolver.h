@@ -0,0 +1,189 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <memory>
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+#include <Eigen/QR>
+
+// Tasks
+#include "GenQPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* GenQPSolver interface implementation with a dual active set method
+	* (Goldfarb and Idnani, 1983).
+	* Two-sided constraints \f$ L \leq A x \leq U \f$ and bounds are handled
+	* natively, each line is only stored once.
+	* The Cholesky factor of \f$ Q \f$ is kept until \f$ Q \f$ change and
+	* GIQPSolver::solve don't allocate memory.
+	* Buffers allocated by GIQPSolver::reserve are kept by updateSize
+	* so a smaller problem don't allocate memory either.
+	*
+	* Equality constraints can be eliminated before the active set method
+	* (see GIQPSolver::eliminateEqualities).
+	*/
+class GIQPSolver : public GenQPSolver
+{
+public:
+	/// Reason of the last GIQPSolver::solve failure.
+	enum class Status
+	{
+		Success,
+		NotPositiveDefinite, ///< Q is not positive definite.
+		DependentEqualities, ///< Equality constraints are inconsistent.
+		Infeasible, ///< Inequality constraints are infeasible.
+		MaxIter ///< Maximum number of iteration reached.
+	};
+
+public:
+	GIQPSolver();
+
+	virtual void reserve(int maxVars, int maxEq, int maxInEq, int maxGenInEq);
+	virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq);
+	virtual void updateMatrix(const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr);
+	virtual bool solve();
+	virtual Eigen::Ref<const Eigen::VectorXd> result() const;
+	virtual void warmStart(bool warm);
+	virtual bool warmStart() const;
+	virtual bool nextSolveWarm() const;
+	virtual void resetWarmStart();
+	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		std::ostream& out) const;
+
+	/// Set the tolerance used to consider a constraint as violated.
+	void feasibilityTol(double tol);
+	double feasibilityTol() const;
+
+	/**
+		* Eliminate the equality constraints \f$ A_{eq} x = b_{eq} \f$ before
+		* solving (disabled by default, enabled for the "GIReduced" solver).
+		* \f$ x = x_0 + Z y \f$ with \f$ x_0 \f$ the minimum norm solution
+		* of the equalities and \f$ Z \f$ a basis of their null space computed
+		* by a QR decomposition of \f$ A_{eq}^T \f$.
+		* The smaller inequality only QP in \f$ y \f$ is solved.
+		* Each variable with a finite bound becomes a dense line of the
+		* reduced QP (\f$ XL - x_0 \leq Z_j y \leq XU - x_0 \f$), so this is only
+		* efficient when there is many equalities and few bounds.
+		* BEWARE PositiveLambda bound every lambda and JointLimitsConstr every
+		* alphaD, the reduced QP can then be larger than the original one.
+		*
+		* The elimination don't allocate memory while the number of equality
+		* lines and their rank stay the same. Otherwise the QR decomposition
+		* and the reduced QP are resized by the next solve.
+		*/
+	void eliminateEqualities(bool eliminate);
+	bool eliminateEqualities() const;
+
+	Status status() const;
+	int iter() const;
+
+private:
+	bool factorize();
+
+	/// Solve the QP with the equality constraints eliminated.
+	bool solveReduced();
+
+	/// Violation of the inequality side k, negative if violated.
+	double slack(int k) const;
+	/// Store the normal of the inequality side k in np_.
+	void normal(int k);
+	/// Compute d_, z_ and r_ from np_.
+	void stepDirection(int iq);
+	bool addConstraint(int& iq);
+	void deleteConstraint(int meq, int& iq, int k);
+
+private:
+	// buffers are kept when the problem shrink (see reserve)
+	ReservedMatrix<Eigen::MatrixXd> A_;
+	ReservedMatrix<Eigen::VectorXd> AL_, AU_;
+
+	ReservedMatrix<Eigen::VectorXd> XL_;
+	ReservedMatrix<Eigen::VectorXd> XU_;
+
+	ReservedMatrix<Eigen::MatrixXd> Q_;
+	ReservedMatrix<Eigen::VectorXd> C_;
+
+	int nrEqLines_, nrALines_;
+
+	QCache qCache_;
+	std::vector<ConstrCache> eqCache_, inEqCache_, genInEqCache_, boundCache_;
+
+	// factorization of Q, J0_ = L^{-T}
+	ReservedMatrix<Eigen::MatrixXd> L_, J0_;
+	bool factorized_;
+
+	// active set method data
+	ReservedMatrix<Eigen::MatrixXd> J_, R_;
+	ReservedMatrix<Eigen::VectorXd> x_, d_, z_, r_, u_, np_, Ax_;
+	double RNorm_;
+	/// Active constraints, -1 - line for equalities and the side index otherwise.
+	std::vector<int> activeSet_;
+	/// true if the side index is in the active set.
+	std::vector<char> isActive_;
+
+	// active set of the last successful solve
+	std::vector<int> warmSet_;
+	int nrWarm_;
+	bool warmStart_;
+
+	double feasibilityTol_;
+	Status status_;
+	int iter_;
+	/// Variable or line of A that caused the last failure, -1 if none.
+	int violatedVar_, violatedLine_;
+
+	// equality elimination data
+	bool eliminateEq_;
+	/// QP in the null space of the equalities
+	std::unique_ptr<GIQPSolver> reduced_;
+	/// maximum number of lines of the reduced QP
+	int maxReducedLines_;
+	Eigen::MatrixXd AeqT_;
+	Eigen::ColPivHouseholderQR<Eigen::MatrixXd> eqQR_;
+	Eigen::MatrixXd eqQ_, Z_, QZ_;
+	/// householder sequence evaluation workspace
+	Eigen::VectorXd eqQWork_;
+	Eigen::VectorXd eqRhs_, x0_, Qx0_, Ax0_;
+	/// variable of each bound line of the reduced QP
+	std::vector<int> reducedBoundVars_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
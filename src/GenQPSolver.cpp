@@ -21,6 +21,8 @@
 #include <map>
 
 // Tasks
+#include "ADMMQPSolver.h"
+#include "GIQPSolver.h"
 #include "QLDQPSolver.h"
 
 #ifdef LSSOL_SOLVER_FOUND
@@ -49,12 +51,23 @@ T* allocateQP()
 }
 
 
+static GenQPSolver* allocateReducedGI()
+{
+	GIQPSolver* solver = new GIQPSolver;
+	solver->eliminateEqualities(true);
+	return solver;
+}
+
+
 static const
 std::map<std::string, std::function<GenQPSolver*(void)> > qpFactory = {
 #ifdef LSSOL_SOLVER_FOUND
 	{"LSSOL", allocateQP<LSSOLQPSolver>},
 #endif
-	{"QLD", allocateQP<QLDQPSolver>}
+	{"QLD", allocateQP<QLDQPSolver>},
+	{"GI", allocateQP<GIQPSolver>},
+	{"GIReduced", allocateReducedGI},
+	{"ADMM", allocateQP<ADMMQPSolver>}
 };
 
 
@@ -64,6 +77,17 @@ GenQPSolver* createQPSolver(const std::string& name)
 }
 
 
+std::vector<std::string> qpSolverNames()
+{
+	std::vector<std::string> names;
+	for(const auto& qp: qpFactory)
+	{
+		names.push_back(qp.first);
+	}
+	return names;
+}
+
+
 } // namespace qp
 
 } // namespace tasks
@@ -17,6 +17,9 @@
 
 // includes
 // std
+#include <new>
+#include <string>
+#include <utility>
 #include <vector>
 
 // Eigen
@@ -45,12 +48,214 @@ class Bound;
 class GenQPSolver;
 
 
+/**
+	* Contiguous range of columns of a constraint matrix.
+	*/
+struct ColBlock
+{
+	ColBlock():
+		begin(0),
+		size(0)
+	{}
+	ColBlock(int b, int s):
+		begin(b),
+		size(s)
+	{}
+
+	bool operator==(const ColBlock& cb) const
+	{
+		return begin == cb.begin && size == cb.size;
+	}
+
+	bool operator!=(const ColBlock& cb) const
+	{
+		return !(*this == cb);
+	}
+
+	int begin; ///< First column.
+	int size; ///< Number of columns.
+};
+
+
 /**
 	* Factory to create GenQPSolver implementation.
-	* Two argument are supported QLD and LSSOL.
+	* Supported arguments are QLD, GI, GIReduced (GI with equality
+	* constraints elimination), ADMM and LSSOL (if available).
 	*/
 GenQPSolver* createQPSolver(const std::string& name);
 
+/// @return Names of the QP solvers that createQPSolver can create.
+std::vector<std::string> qpSolverNames();
+
+
+/**
+	* Dynamic matrix or vector that keep its storage when its size change.
+	* Eigen::Matrix reallocate its coefficients each time its size change,
+	* ReservedMatrix is a map on a buffer that is only reallocated when
+	* the new size exceed its capacity (see reserve).
+	* The content is lost when the size change.
+	*/
+template<typename MatrixType>
+class ReservedMatrix : public Eigen::Map<MatrixType>
+{
+public:
+	typedef Eigen::Map<MatrixType> Base;
+	typedef Eigen::Matrix<typename MatrixType::Scalar, Eigen::Dynamic, 1>
+		StorageType;
+
+public:
+	ReservedMatrix():
+		Base(nullptr, 0, MatrixType::ColsAtCompileTime == 1 ? 1 : 0),
+		storage_()
+	{}
+
+	// the map would point on the copied matrix storage
+	ReservedMatrix(const ReservedMatrix&) = delete;
+
+	/// Take the storage of m, m become empty.
+	ReservedMatrix(ReservedMatrix&& m):
+		Base(nullptr, 0, MatrixType::ColsAtCompileTime == 1 ? 1 : 0),
+		storage_()
+	{
+		storage_.swap(m.storage_);
+		remap(int(m.rows()), int(m.cols()));
+		m.remap(0, MatrixType::ColsAtCompileTime == 1 ? 1 : 0);
+	}
+
+	ReservedMatrix& operator=(const ReservedMatrix& m)
+	{
+		Base::operator=(m);
+		return *this;
+	}
+
+	using Base::operator=;
+	using Base::setZero;
+
+	/// Reallocate the storage if it's smaller than size, the content is kept.
+	void reserve(int size)
+	{
+		if(size > int(storage_.size()))
+		{
+			StorageType storage(size);
+			storage.head(this->size()) =
+				Eigen::Map<const StorageType>(this->data(), this->size());
+			storage_.swap(storage);
+			remap(int(this->rows()), int(this->cols()));
+		}
+	}
+
+	int capacity() const
+	{
+		return int(storage_.size());
+	}
+
+	void resize(int rows, int cols)
+	{
+		if(rows*cols > int(storage_.size()))
+		{
+			storage_.resize(rows*cols);
+		}
+		remap(rows, cols);
+	}
+
+	void resize(int size)
+	{
+		resize(size, 1);
+	}
+
+	void setZero(int rows, int cols)
+	{
+		resize(rows, cols);
+		Base::setZero();
+	}
+
+	void setZero(int size)
+	{
+		resize(size);
+		Base::setZero();
+	}
+
+private:
+	void remap(int rows, int cols)
+	{
+		new (static_cast<Base*>(this)) Base(storage_.data(), rows, cols);
+	}
+
+private:
+	StorageType storage_;
+};
+
+
+/// Task contribution summed in the constant part of \f$ Q \f$.
+struct TaskCache
+{
+	bool operator==(const TaskCache& tc) const
+	{
+		return task == tc.task && version == tc.version && weight == tc.weight &&
+			begin == tc.begin;
+	}
+
+	const Task* task;
+	int version;
+	double weight;
+	std::pair<int, int> begin;
+};
+
+
+/**
+	* Constant part of the \f$ Q \f$ matrix.
+	* Tasks with a positive Task::versionQ are summed in constQ and
+	* this sum is only computed again when one of them change.
+	*/
+struct QCache
+{
+	QCache():
+		tasks(),
+		constQ(),
+		changed(),
+		valid(false),
+		dynamic(false)
+	{}
+
+	/// Invalidate the cache and resize the constant matrix.
+	void reset(int nrVars)
+	{
+		tasks.clear();
+		constQ.setZero(nrVars, nrVars);
+		changed.clear();
+		valid = false;
+		dynamic = false;
+	}
+
+	/// Allocate the constant matrix for maxVars variables.
+	void reserve(int maxVars)
+	{
+		constQ.reserve(maxVars*maxVars);
+	}
+
+	std::vector<TaskCache> tasks; ///< Tasks summed in constQ.
+	ReservedMatrix<Eigen::MatrixXd> constQ;
+	/// Tasks summed in Q by the last fill, other entries of Q are unchanged.
+	std::vector<const Task*> changed;
+	bool valid; ///< false if constQ must be computed again.
+	bool dynamic; ///< true if some tasks was not constant at the last fill.
+};
+
+
+/**
+	* Position, column blocks and version of a constraint in the QP matrices
+	* at the last fill.
+	*/
+struct ConstrCache
+{
+	const void* constr;
+	int version;
+	int line, nrLines;
+	bool filled; ///< true if the constraint was copied by the last fill
+	/// columns filled at the last fill, the other columns are zero
+	std::vector<ColBlock> blocks;
+};
+
 
 /**
 	* Generic QP solver abstract interface.
@@ -69,8 +274,27 @@ public:
 public:
 	virtual ~GenQPSolver() {}
 
+	/**
+		* Allocate the solver buffers for the largest expected problem.
+		* The following updateSize calls with a smaller problem don't
+		* allocate memory.
+		* Only the GI solver implement it, QLD and LSSOL matrices are given
+		* to their wrappers as Eigen::MatrixXd and ADMM build a new sparse KKT
+		* matrix when the number of variables change, so they ignore this call.
+		* @param maxVars Maximum number of variables.
+		* @param maxEq Maximum number of equality lines.
+		* @param maxInEq Maximum number of inequality lines.
+		* @param maxGenInEq Maximum number of general inequality lines.
+		*/
+	virtual void reserve(int /* maxVars */, int /* maxEq */, int /* maxInEq */,
+		int /* maxGenInEq */)
+	{}
+
 	/**
 		* Update the problem size.
+		* This also reset the warm start data.
+		* Constraints can fill less lines than the maximum number of lines
+		* without calling this method again.
 		* @param nrVars Variable number.
 		* @param nrEq maximum number of equality.
 		* @param nrInEq maximum number of inequality.
@@ -99,7 +323,38 @@ public:
 	virtual bool solve() = 0;
 
 	/// @return Optimal \f$ x \f$ vector.
-	virtual const Eigen::VectorXd& result() const = 0;
+	virtual Eigen::Ref<const Eigen::VectorXd> result() const = 0;
+
+	/**
+		* Enable or disable the warm start.
+		* When enabled the solver start from the solution and the active set
+		* of the previous call to GenQPSolver::solve.
+		* Solvers that don't support warm start ignore this call.
+		*/
+	virtual void warmStart(bool /* warm */)
+	{}
+
+	/// @return Warm start setting, false if the solver don't support it.
+	virtual bool warmStart() const
+	{
+		return false;
+	}
+
+	/**
+		* @return true if the next GenQPSolver::solve will use the warm start
+		* (warm start enabled and a previous solution available).
+		*/
+	virtual bool nextSolveWarm() const
+	{
+		return false;
+	}
+
+	/**
+		* Forget the previous solution and active set.
+		* The next GenQPSolver::solve will be cold started.
+		*/
+	virtual void resetWarmStart()
+	{}
 
 	/// @return Error message if GenQPSolver::solve has returned false.
 	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
@@ -17,6 +17,7 @@
 
 // includes
 // std
+#include <algorithm>
 #include <vector>
 
 // Eigen
@@ -38,23 +39,296 @@ static const double DIAG_CONSTANT = 1e-4;
 
 
 /**
-	* Fill the \f$ Q \f$ matrix and the \f$ c \f$ vector based on the
-	* task list.
+	* Update the cache entry of a constraint.
+	* @param cache Cache of a constraint list.
+	* @param index Index of the constraint in its list.
+	* @param blocks Column blocks of the constraint matrix.
+	* @param zero Set to true if the constraint lines or columns have moved
+	* and must be zeroed before being filled.
+	* @return true if the constraint must be copied in the QP matrices.
+	*/
+inline bool updateConstrCache(std::vector<ConstrCache>& cache, std::size_t index,
+	const void* constr, int version, int line, int nrLines,
+	const std::vector<ColBlock>& blocks, bool& zero)
+{
+	if(index >= cache.size())
+	{
+		cache.push_back({nullptr, -1, -1, -1, false, {}});
+	}
+
+	ConstrCache& cc = cache[index];
+	// columns of the last fill that are not in blocks anymore
+	// (like the lambda of a removed contact) must be cleared
+	zero = cc.constr != constr || cc.line != line || cc.nrLines != nrLines ||
+		cc.blocks != blocks;
+	bool changed = zero || version < 0 || cc.version != version;
+	cc.constr = constr;
+	cc.version = version;
+	cc.line = line;
+	cc.nrLines = nrLines;
+	cc.filled = changed;
+	if(zero)
+	{
+		cc.blocks = blocks;
+	}
+	return changed;
+}
+
+
+/**
+	* Force the next fill to copy all the constraints.
+	* Entries are kept so their column blocks are not allocated again.
 	*/
-inline void fillQC(const std::vector<Task*>& tasks, int nrVars,
-	Eigen::MatrixXd& Q, Eigen::VectorXd& C)
+inline void resetConstrCache(std::vector<ConstrCache>& cache)
+{
+	for(ConstrCache& cc: cache)
+	{
+		cc.constr = nullptr;
+		cc.filled = false;
+	}
+}
+
+
+/// Add weight*Qi of a diagonal or scaled identity task in the Q diagonal.
+inline void addTaskQDiagonal(const Task* task, double weight,
+	Eigen::Ref<Eigen::MatrixXd> Q)
+{
+	const Eigen::MatrixXd& Qi = task->Q();
+	const std::vector<ColBlock>& blocks = task->QBlocks();
+	int begin = task->begin().first;
+	bool diagonal = task->structureQ() == QStructure::Diagonal;
+
+	if(blocks.empty())
+	{
+		int size = static_cast<int>(task->C().rows());
+		if(diagonal)
+		{
+			Q.diagonal().segment(begin, size) += weight*Qi.col(0);
+		}
+		else
+		{
+			Q.diagonal().segment(begin, size).array() += weight*Qi(0, 0);
+		}
+		return;
+	}
+
+	int qiRow = 0;
+	for(const ColBlock& cb: blocks)
+	{
+		if(diagonal)
+		{
+			Q.diagonal().segment(begin + cb.begin, cb.size) +=
+				weight*Qi.col(0).segment(qiRow, cb.size);
+		}
+		else
+		{
+			Q.diagonal().segment(begin + cb.begin, cb.size).array() +=
+				weight*Qi(0, 0);
+		}
+		qiRow += cb.size;
+	}
+}
+
+
+/// Add the lower triangular part of weight*F^T*F of a factor task in Q.
+inline void addTaskQFactor(const Task* task, double weight,
+	Eigen::Ref<Eigen::MatrixXd> Q)
+{
+	const Eigen::MatrixXd& F = task->Q();
+	const std::vector<ColBlock>& blocks = task->QBlocks();
+	std::pair<int, int> b = task->begin();
+
+	if(blocks.empty())
+	{
+		int size = static_cast<int>(F.cols());
+		Q.block(b.first, b.second, size, size).selfadjointView<Eigen::Lower>().
+			rankUpdate(F.transpose(), weight);
+		return;
+	}
+
+	int fCol = 0;
+	for(std::size_t j = 0; j < blocks.size(); ++j)
+	{
+		const ColBlock& cb = blocks[j];
+		int col = b.second + cb.begin;
+		Q.block(b.first + cb.begin, col, cb.size, cb.size).
+			selfadjointView<Eigen::Lower>().
+				rankUpdate(F.middleCols(fCol, cb.size).transpose(), weight);
+
+		int fRow = fCol + cb.size;
+		for(std::size_t i = j + 1; i < blocks.size(); ++i)
+		{
+			const ColBlock& rb = blocks[i];
+			Q.block(b.first + rb.begin, col, rb.size, cb.size).noalias() +=
+				weight*F.middleCols(fRow, rb.size).transpose()*
+					F.middleCols(fCol, cb.size);
+			fRow += rb.size;
+		}
+		fCol += cb.size;
+	}
+}
+
+
+/// Add the lower triangular part of weight*Qi of a task in Q.
+inline void addTaskQ(const Task* task, double weight,
+	Eigen::Ref<Eigen::MatrixXd> Q)
 {
-	for(std::size_t i = 0; i < tasks.size(); ++i)
+	switch(task->structureQ())
 	{
-		const Eigen::MatrixXd& Qi = tasks[i]->Q();
-		const Eigen::VectorXd& Ci = tasks[i]->C();
-		std::pair<int, int> b = tasks[i]->begin();
+		case QStructure::Diagonal:
+		case QStructure::ScaledIdentity:
+			addTaskQDiagonal(task, weight, Q);
+			return;
+		case QStructure::Factor:
+			addTaskQFactor(task, weight, Q);
+			return;
+		default:
+			break;
+	}
+
+	const Eigen::MatrixXd& Qi = task->Q();
+	const std::vector<ColBlock>& blocks = task->QBlocks();
+	std::pair<int, int> b = task->begin();
 
+	if(blocks.empty())
+	{
 		int r = static_cast<int>(Qi.rows());
 		int c = static_cast<int>(Qi.cols());
 
-		Q.block(b.first, b.second, r, c) += tasks[i]->weight()*Qi;
-		C.segment(b.first, r) += tasks[i]->weight()*Ci;
+		Q.block(b.first, b.second, r, c).triangularView<Eigen::Lower>() += weight*Qi;
+		return;
+	}
+
+	// blocks are sorted so the lower part of Qi is scattered
+	// in the lower part of Q
+	int qiCol = 0;
+	for(std::size_t j = 0; j < blocks.size(); ++j)
+	{
+		const ColBlock& cb = blocks[j];
+		int col = b.second + cb.begin;
+		Q.block(b.first + cb.begin, col, cb.size, cb.size).
+			triangularView<Eigen::Lower>() +=
+				weight*Qi.block(qiCol, qiCol, cb.size, cb.size);
+
+		int qiRow = qiCol + cb.size;
+		for(std::size_t i = j + 1; i < blocks.size(); ++i)
+		{
+			const ColBlock& rb = blocks[i];
+			Q.block(b.first + rb.begin, col, rb.size, cb.size).noalias() +=
+				weight*Qi.block(qiRow, qiCol, rb.size, cb.size);
+			qiRow += rb.size;
+		}
+		qiCol += cb.size;
+	}
+}
+
+
+/// Add weight*Ci of a task in C.
+inline void addTaskC(const Task* task, double weight,
+	Eigen::Ref<Eigen::VectorXd> C)
+{
+	const Eigen::VectorXd& Ci = task->C();
+	const std::vector<ColBlock>& blocks = task->QBlocks();
+	int begin = task->begin().first;
+
+	if(blocks.empty())
+	{
+		C.segment(begin, Ci.rows()) += weight*Ci;
+		return;
+	}
+
+	int ciRow = 0;
+	for(const ColBlock& cb: blocks)
+	{
+		C.segment(begin + cb.begin, cb.size) += weight*Ci.segment(ciRow, cb.size);
+		ciRow += cb.size;
+	}
+}
+
+
+/**
+	* Fill the \f$ Q \f$ matrix and the \f$ c \f$ vector based on the
+	* task list.
+	* Constant tasks are summed once in the cache, if there is no
+	* other tasks Q is left untouched.
+	* The tasks summed in Q are listed in QCache::changed, the constant tasks
+	* are only listed when their sum is computed again.
+	* @param full If false only the lower triangular part of Q is filled.
+	* @return true if Q has changed since the last call.
+	*/
+inline bool fillQC(const std::vector<Task*>& tasks, int nrVars,
+	Eigen::Ref<Eigen::MatrixXd> Q, Eigen::Ref<Eigen::VectorXd> C, QCache& cache,
+	bool full=true)
+{
+	bool constChanged = !cache.valid;
+	bool dynamic = false;
+	std::size_t nrConst = 0;
+	cache.changed.clear();
+	for(Task* t: tasks)
+	{
+		int version = t->versionQ();
+		if(version < 0)
+		{
+			dynamic = true;
+			continue;
+		}
+
+		TaskCache tc = {t, version, t->weight(), t->begin()};
+		if(nrConst >= cache.tasks.size())
+		{
+			cache.tasks.push_back(tc);
+			constChanged = true;
+		}
+		else if(!(cache.tasks[nrConst] == tc))
+		{
+			cache.tasks[nrConst] = tc;
+			constChanged = true;
+		}
+		++nrConst;
+	}
+
+	if(nrConst != cache.tasks.size())
+	{
+		cache.tasks.resize(nrConst);
+		constChanged = true;
+	}
+
+	if(constChanged)
+	{
+		cache.constQ.setZero();
+		for(const TaskCache& tc: cache.tasks)
+		{
+			addTaskQ(tc.task, tc.weight, cache.constQ);
+			cache.changed.push_back(tc.task);
+		}
+	}
+
+	bool QChanged = constChanged || dynamic || cache.dynamic;
+	cache.valid = true;
+	cache.dynamic = dynamic;
+
+	C.setZero();
+	for(Task* t: tasks)
+	{
+		addTaskC(t, t->weight(), C);
+	}
+
+	if(!QChanged)
+	{
+		return false;
+	}
+
+	Q = cache.constQ;
+	if(dynamic)
+	{
+		for(Task* t: tasks)
+		{
+			if(t->versionQ() < 0)
+			{
+				addTaskQ(t, t->weight(), Q);
+				cache.changed.push_back(t);
+			}
+		}
 	}
 
 	// try to transform Q_ to a positive matrix
@@ -71,6 +345,65 @@ inline void fillQC(const std::vector<Task*>& tasks, int nrVars,
 			Q(i, i) += DIAG_CONSTANT;
 		}
 	}
+
+	if(full)
+	{
+		for(int j = 0; j < nrVars - 1; ++j)
+		{
+			Q.row(j).tail(nrVars - j - 1) = Q.col(j).tail(nrVars - j - 1).transpose();
+		}
+	}
+
+	return true;
+}
+
+
+/**
+	* Copy the first nrConstr lines of Ai in A starting at line nrALines.
+	* Only the columns in blocks are copied, other columns of A are left
+	* untouched and must be zero.
+	* @param blocks Column blocks of Ai, empty to copy all columns.
+	* @param zero Set the lines to zero before copying the column blocks.
+	* @param minus Copy -Ai instead of Ai.
+	*/
+inline void fillA(const std::vector<ColBlock>& blocks, const Eigen::MatrixXd& Ai,
+	int nrConstr, int nrVars, int nrALines, Eigen::Ref<Eigen::MatrixXd> A,
+	bool zero,
+	bool minus=false)
+{
+	if(blocks.empty())
+	{
+		if(minus)
+		{
+			A.block(nrALines, 0, nrConstr, nrVars) =
+				-Ai.block(0, 0, nrConstr, nrVars);
+		}
+		else
+		{
+			A.block(nrALines, 0, nrConstr, nrVars) =
+				Ai.block(0, 0, nrConstr, nrVars);
+		}
+		return;
+	}
+
+	if(zero)
+	{
+		A.block(nrALines, 0, nrConstr, nrVars).setZero();
+	}
+
+	for(const ColBlock& cb: blocks)
+	{
+		if(minus)
+		{
+			A.block(nrALines, cb.begin, nrConstr, cb.size) =
+				-Ai.block(0, cb.begin, nrConstr, cb.size);
+		}
+		else
+		{
+			A.block(nrALines, cb.begin, nrConstr, cb.size) =
+				Ai.block(0, cb.begin, nrConstr, cb.size);
+		}
+	}
 }
 
 
@@ -80,22 +413,28 @@ inline void fillQC(const std::vector<Task*>& tasks, int nrVars,
 /**
 	* Fill the \f$ A \f$ matrix and the \f$ L \f$ and \f$ U \f$ bounds vectors
 	* based on the equality constaint list.
+	* Constraints that have not changed since the last call are not copied.
 	*/
 inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& AL, Eigen::VectorXd& AU)
+	int nrALines, Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> AL,
+	Eigen::Ref<Eigen::VectorXd> AU, std::vector<ConstrCache>& cache)
 {
 	for(std::size_t i = 0; i < eq.size(); ++i)
 	{
 		// ineq constraint can return a matrix with more line
 		// than the number of constraint
 		int nrConstr = eq[i]->nrEq();
-		const Eigen::MatrixXd& Ai = eq[i]->AEq();
-		const Eigen::VectorXd& bi = eq[i]->bEq();
+		bool zero = false;
+		if(updateConstrCache(cache, i, eq[i], eq[i]->versionEq(),
+			nrALines, nrConstr, eq[i]->AEqBlocks(), zero))
+		{
+			const Eigen::MatrixXd& Ai = eq[i]->AEq();
+			const Eigen::VectorXd& bi = eq[i]->bEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
-		AL.segment(nrALines, nrConstr) = bi.head(nrConstr);
-		AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
+			fillA(eq[i]->AEqBlocks(), Ai, nrConstr, nrVars, nrALines, A, zero);
+			AL.segment(nrALines, nrConstr) = bi.head(nrConstr);
+			AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
+		}
 
 		nrALines += nrConstr;
 	}
@@ -107,22 +446,28 @@ inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
 /**
 	* Fill the \f$ A \f$ matrix and the \f$ L \f$ and \f$ U \f$ bounds vectors
 	* based on the inequality constaint list.
+	* Constraints that have not changed since the last call are not copied.
 	*/
 inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& AL, Eigen::VectorXd& AU)
+	int nrALines, Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> AL,
+	Eigen::Ref<Eigen::VectorXd> AU, std::vector<ConstrCache>& cache)
 {
 	for(std::size_t i = 0; i < inEq.size(); ++i)
 	{
 		// ineq constraint can return a matrix with more line
 		// than the number of constraint
 		int nrConstr = inEq[i]->nrInEq();
-		const Eigen::MatrixXd& Ai = inEq[i]->AInEq();
-		const Eigen::VectorXd& bi = inEq[i]->bInEq();
+		bool zero = false;
+		if(updateConstrCache(cache, i, inEq[i], inEq[i]->versionInEq(),
+			nrALines, nrConstr, inEq[i]->AInEqBlocks(), zero))
+		{
+			const Eigen::MatrixXd& Ai = inEq[i]->AInEq();
+			const Eigen::VectorXd& bi = inEq[i]->bInEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
-		AL.segment(nrALines, nrConstr).fill(-std::numeric_limits<double>::infinity());
-		AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
+			fillA(inEq[i]->AInEqBlocks(), Ai, nrConstr, nrVars, nrALines, A, zero);
+			AL.segment(nrALines, nrConstr).fill(-std::numeric_limits<double>::infinity());
+			AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
+		}
 
 		nrALines += nrConstr;
 	}
@@ -134,23 +479,30 @@ inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
 /**
 	* Fill the \f$ A \f$ matrix and the \f$ L \f$ and \f$ U \f$ bounds vectors
 	* based on the general inequality constaint list.
+	* Constraints that have not changed since the last call are not copied.
 	*/
 inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& AL, Eigen::VectorXd& AU)
+	int nrALines, Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> AL,
+	Eigen::Ref<Eigen::VectorXd> AU, std::vector<ConstrCache>& cache)
 {
 	for(std::size_t i = 0; i < genInEq.size(); ++i)
 	{
 		// ineq constraint can return a matrix with more line
 		// than the number of constraint
 		int nrConstr = genInEq[i]->nrGenInEq();
-		const Eigen::MatrixXd& Ai = genInEq[i]->AGenInEq();
-		const Eigen::VectorXd& ALi = genInEq[i]->LowerGenInEq();
-		const Eigen::VectorXd& AUi = genInEq[i]->UpperGenInEq();
-
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
-		AL.segment(nrALines, nrConstr) = ALi.head(nrConstr);
-		AU.segment(nrALines, nrConstr) = AUi.head(nrConstr);
+		bool zero = false;
+		if(updateConstrCache(cache, i, genInEq[i], genInEq[i]->versionGenInEq(),
+			nrALines, nrConstr, genInEq[i]->AGenInEqBlocks(), zero))
+		{
+			const Eigen::MatrixXd& Ai = genInEq[i]->AGenInEq();
+			const Eigen::VectorXd& ALi = genInEq[i]->LowerGenInEq();
+			const Eigen::VectorXd& AUi = genInEq[i]->UpperGenInEq();
+
+			fillA(genInEq[i]->AGenInEqBlocks(), Ai, nrConstr, nrVars, nrALines, A,
+				zero);
+			AL.segment(nrALines, nrConstr) = ALi.head(nrConstr);
+			AU.segment(nrALines, nrConstr) = AUi.head(nrConstr);
+		}
 
 		nrALines += nrConstr;
 	}
@@ -165,21 +517,27 @@ inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
 /**
 	* Fill the \f$ A \f$ matrix and the \f$ b \f$ vectors
 	* based on the equality constaint list.
+	* Constraints that have not changed since the last call are not copied.
 	*/
 inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& b)
+	int nrALines, Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+	std::vector<ConstrCache>& cache)
 {
 	for(std::size_t i = 0; i < eq.size(); ++i)
 	{
 		// ineq constraint can return a matrix with more line
 		// than the number of constraint
 		int nrConstr = eq[i]->nrEq();
-		const Eigen::MatrixXd& Ai = eq[i]->AEq();
-		const Eigen::VectorXd& bi = eq[i]->bEq();
+		bool zero = false;
+		if(updateConstrCache(cache, i, eq[i], eq[i]->versionEq(),
+			nrALines, nrConstr, eq[i]->AEqBlocks(), zero))
+		{
+			const Eigen::MatrixXd& Ai = eq[i]->AEq();
+			const Eigen::VectorXd& bi = eq[i]->bEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
-		b.segment(nrALines, nrConstr) = bi.head(nrConstr);
+			fillA(eq[i]->AEqBlocks(), Ai, nrConstr, nrVars, nrALines, A, zero);
+			b.segment(nrALines, nrConstr) = bi.head(nrConstr);
+		}
 
 		nrALines += nrConstr;
 	}
@@ -191,21 +549,27 @@ inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
 /**
 	* Fill the \f$ A \f$ matrix and the \f$ b \f$ vectors
 	* based on the inequality constaint list.
+	* Constraints that have not changed since the last call are not copied.
 	*/
 inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& b)
+	int nrALines, Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+	std::vector<ConstrCache>& cache)
 {
 	for(std::size_t i = 0; i < inEq.size(); ++i)
 	{
 		// ineq constraint can return a matrix with more line
 		// than the number of constraint
 		int nrConstr = inEq[i]->nrInEq();
-		const Eigen::MatrixXd& Ai = inEq[i]->AInEq();
-		const Eigen::VectorXd& bi = inEq[i]->bInEq();
+		bool zero = false;
+		if(updateConstrCache(cache, i, inEq[i], inEq[i]->versionInEq(),
+			nrALines, nrConstr, inEq[i]->AInEqBlocks(), zero))
+		{
+			const Eigen::MatrixXd& Ai = inEq[i]->AInEq();
+			const Eigen::VectorXd& bi = inEq[i]->bInEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
-		b.segment(nrALines, nrConstr) = bi.head(nrConstr);
+			fillA(inEq[i]->AInEqBlocks(), Ai, nrConstr, nrVars, nrALines, A, zero);
+			b.segment(nrALines, nrConstr) = bi.head(nrConstr);
+		}
 
 		nrALines += nrConstr;
 	}
@@ -217,30 +581,36 @@ inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
 /**
 	* Fill the \f$ A \f$ matrix and the \f$ b \f$ vectors
 	* based on the general inequality constaint list.
+	* Constraints that have not changed since the last call are not copied.
 	*/
 inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& b)
+	int nrALines, Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+	std::vector<ConstrCache>& cache)
 {
 	for(std::size_t i = 0; i < genInEq.size(); ++i)
 	{
 		// ineq constraint can return a matrix with more line
 		// than the number of constraint
 		int nrConstr = genInEq[i]->nrGenInEq();
-		const Eigen::MatrixXd& Ai = genInEq[i]->AGenInEq();
-		const Eigen::VectorXd& ALi = genInEq[i]->LowerGenInEq();
-		const Eigen::VectorXd& AUi = genInEq[i]->UpperGenInEq();
-
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			-Ai.block(0, 0, nrConstr, nrVars);
-		b.segment(nrALines, nrConstr) = -ALi.head(nrConstr);
+		bool zero = false;
+		// the two line sets move together so only the first one is tracked
+		if(updateConstrCache(cache, i, genInEq[i], genInEq[i]->versionGenInEq(),
+			nrALines, nrConstr, genInEq[i]->AGenInEqBlocks(), zero))
+		{
+			const Eigen::MatrixXd& Ai = genInEq[i]->AGenInEq();
+			const Eigen::VectorXd& ALi = genInEq[i]->LowerGenInEq();
+			const Eigen::VectorXd& AUi = genInEq[i]->UpperGenInEq();
 
-		nrALines += nrConstr;
+			fillA(genInEq[i]->AGenInEqBlocks(), Ai, nrConstr, nrVars, nrALines, A,
+				zero, true);
+			b.segment(nrALines, nrConstr) = -ALi.head(nrConstr);
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
-		b.segment(nrALines, nrConstr) = AUi.head(nrConstr);
+			fillA(genInEq[i]->AGenInEqBlocks(), Ai, nrConstr, nrVars,
+				nrALines + nrConstr, A, zero);
+			b.segment(nrALines + nrConstr, nrConstr) = AUi.head(nrConstr);
+		}
 
-		nrALines += nrConstr;
+		nrALines += 2*nrConstr;
 	}
 
 	return nrALines;
@@ -250,51 +620,74 @@ inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
 /**
 	* Fill the \f$ L \f$  and \f$ U \f$ bounds vectors
 	* based on the bound constaint list.
+	* Vectors are left untouched if no bound has changed since the last call.
 	*/
 inline void fillBound(const std::vector<Bound*>& bounds,
-	Eigen::VectorXd& XL, Eigen::VectorXd& XU)
+	Eigen::Ref<Eigen::VectorXd> XL, Eigen::Ref<Eigen::VectorXd> XU,
+	std::vector<ConstrCache>& cache)
 {
+	bool changed = bounds.size() != cache.size();
+	for(std::size_t i = 0; i < bounds.size(); ++i)
+	{
+		bool moved = false;
+		changed |= updateConstrCache(cache, i, bounds[i], bounds[i]->versionBound(),
+			bounds[i]->beginVar(), int(bounds[i]->Lower().size()),
+			std::vector<ColBlock>(), moved);
+	}
+	cache.resize(bounds.size());
+
+	if(!changed)
+	{
+		return;
+	}
+
+	XL.fill(-std::numeric_limits<double>::infinity());
+	XU.fill(std::numeric_limits<double>::infinity());
 	for(std::size_t i = 0; i < bounds.size(); ++i)
 	{
 		const Eigen::VectorXd& XLi = bounds[i]->Lower();
 		const Eigen::VectorXd& XUi = bounds[i]->Upper();
 		int bv = bounds[i]->beginVar();
+		// bounds can have up to SolverData::maxNrVars variables
+		int size = std::min(int(XLi.size()), int(XL.size()) - bv);
 
-		XL.segment(bv, XLi.size()) = XLi;
-		XU.segment(bv, XUi.size()) = XUi;
+		XL.segment(bv, size) = XLi.head(size);
+		XU.segment(bv, size) = XUi.head(size);
 	}
 }
 
 
 // print of a constraint at a given line
+// constraint matrices can have more columns than the result (see
+// SolverData::maxNrVars), the other columns are zero
 template<typename T>
-std::ostream& printConstr(const Eigen::VectorXd& result, T* constr, int line,
-	std::ostream& out);
+std::ostream& printConstr(const Eigen::Ref<const Eigen::VectorXd>& result,
+	T* constr, int line, std::ostream& out);
 
 template<>
-inline std::ostream& printConstr(const Eigen::VectorXd& result, Equality* constr,
-	int line, std::ostream& out)
+inline std::ostream& printConstr(const Eigen::Ref<const Eigen::VectorXd>& result,
+	Equality* constr, int line, std::ostream& out)
 {
-	out << constr->AEq().row(line)*result <<" = " <<
+	out << constr->AEq().row(line).head(result.size())*result <<" = " <<
 				 constr->bEq()(line);
 	return out;
 }
 
 template<>
-inline std::ostream& printConstr(const Eigen::VectorXd& result, Inequality* constr,
-	int line, std::ostream& out)
+inline std::ostream& printConstr(const Eigen::Ref<const Eigen::VectorXd>& result,
+	Inequality* constr, int line, std::ostream& out)
 {
-	out << constr->AInEq().row(line)*result <<" <= " <<
+	out << constr->AInEq().row(line).head(result.size())*result <<" <= " <<
 				 constr->bInEq()(line);
 	return out;
 }
 
 template<>
-inline std::ostream& printConstr(const Eigen::VectorXd& result, GenInequality* constr,
-	int line, std::ostream& out)
+inline std::ostream& printConstr(const Eigen::Ref<const Eigen::VectorXd>& result,
+	GenInequality* constr, int line, std::ostream& out)
 {
 	out << constr->LowerGenInEq()(line) << " <= " <<
-				 constr->AGenInEq().row(line)*result <<" <= " <<
+				 constr->AGenInEq().row(line).head(result.size())*result <<" <= " <<
 				 constr->UpperGenInEq()(line);
 	return out;
 }
@@ -302,7 +695,7 @@ inline std::ostream& printConstr(const Eigen::VectorXd& result, GenInequality* c
 
 template <typename T>
 inline std::ostream& constrErrorMsg(const std::vector<rbd::MultiBody>& mbs,
-	const Eigen::VectorXd& result,
+	const Eigen::Ref<const Eigen::VectorXd>& result,
 	int ALine, const std::vector<T*>& constr, int& start, int& end,
 	std::ostream& out)
 {
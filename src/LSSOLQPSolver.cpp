@@ -34,9 +34,13 @@ LSSOLQPSolver::LSSOLQPSolver():
 	A_(),AL_(),AU_(),
 	XL_(),XU_(),
 	Q_(),C_(),
-	nrALines_(0)
+	QSolve_(),
+	nrALines_(0),
+	warmStart_(true),
+	coldStart_(true),
+	qCache_(),
+	eqCache_(), inEqCache_(), genInEqCache_(), boundCache_()
 {
-	lssol_.warm(true);
 	lssol_.feasibilityTol(1e-6);
 }
 
@@ -52,8 +56,26 @@ void LSSOLQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
 	XU_.resize(nrVars);
 
 	Q_.resize(nrVars, nrVars);
+	QSolve_.resize(nrVars, nrVars);
 	C_.resize(nrVars);
 
+	// constraints only write their non zero columns
+	// so other columns must be zeroed once
+	A_.setZero();
+	AL_.setZero();
+	AU_.setZero();
+	XL_.fill(-std::numeric_limits<double>::infinity());
+	XU_.fill(std::numeric_limits<double>::infinity());
+
+	qCache_.reset(nrVars);
+	resetConstrCache(eqCache_);
+	resetConstrCache(inEqCache_);
+	resetConstrCache(genInEqCache_);
+	resetConstrCache(boundCache_);
+
+	// istate and result from the previous problem are meaningless now
+	coldStart_ = true;
+
 	lssol_.problem(nrVars, maxALines);
 }
 
@@ -65,41 +87,63 @@ void LSSOLQPSolver::updateMatrix(
 	const std::vector<GenInequality*>& genInEqConstr,
 	const std::vector<Bound*>& boundConstr)
 {
-	A_.setZero();
-	AL_.setZero();
-	AU_.setZero();
-	XL_.fill(-std::numeric_limits<double>::infinity());
-	XU_.fill(std::numeric_limits<double>::infinity());
-	Q_.setZero();
-	C_.setZero();
-
 	const int nrVars = int(Q_.rows());
 
 	nrALines_ = 0;
-	nrALines_ = fillEq(eqConstr, nrVars, nrALines_, A_, AL_, AU_);
-	nrALines_ = fillInEq(inEqConstr, nrVars, nrALines_, A_, AL_, AU_);
-	nrALines_ = fillGenInEq(genInEqConstr, nrVars, nrALines_, A_, AL_, AU_);
-
-	fillBound(boundConstr, XL_, XU_);
-	fillQC(tasks, nrVars, Q_, C_);
+	nrALines_ = fillEq(eqConstr, nrVars, nrALines_, A_, AL_, AU_, eqCache_);
+	nrALines_ = fillInEq(inEqConstr, nrVars, nrALines_, A_, AL_, AU_,
+		inEqCache_);
+	nrALines_ = fillGenInEq(genInEqConstr, nrVars, nrALines_, A_, AL_, AU_,
+		genInEqCache_);
+
+	fillBound(boundConstr, XL_, XU_, boundCache_);
+	fillQC(tasks, nrVars, Q_, C_, qCache_);
 }
 
 
 bool LSSOLQPSolver::solve()
 {
-	bool success = lssol_.solve(Q_, C_,
+	lssol_.warm(warmStart_ && !coldStart_);
+	// LSSOL overwrite the objective matrix with its factor
+	QSolve_ = Q_;
+	bool success = lssol_.solve(QSolve_, C_,
 		A_.block(0, 0, nrALines_, int(A_.cols())), int(A_.rows()),
 		AL_.segment(0, nrALines_), AU_.segment(0, nrALines_), XL_, XU_);
+	coldStart_ = false;
 	return success;
 }
 
 
-const Eigen::VectorXd& LSSOLQPSolver::result() const
+Eigen::Ref<const Eigen::VectorXd> LSSOLQPSolver::result() const
 {
 	return lssol_.result();
 }
 
 
+void LSSOLQPSolver::warmStart(bool warm)
+{
+	warmStart_ = warm;
+}
+
+
+bool LSSOLQPSolver::warmStart() const
+{
+	return warmStart_;
+}
+
+
+bool LSSOLQPSolver::nextSolveWarm() const
+{
+	return warmStart_ && !coldStart_;
+}
+
+
+void LSSOLQPSolver::resetWarmStart()
+{
+	coldStart_ = true;
+}
+
+
 std::ostream& LSSOLQPSolver::errorMsg(
 	const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<Task*>& /* tasks */,
@@ -45,7 +45,11 @@ public:
 		const std::vector<GenInequality*>& genInEqConstr,
 		const std::vector<Bound*>& boundConstr);
 	virtual bool solve();
-	virtual const Eigen::VectorXd& result() const;
+	virtual Eigen::Ref<const Eigen::VectorXd> result() const;
+	virtual void warmStart(bool warm);
+	virtual bool warmStart() const;
+	virtual bool nextSolveWarm() const;
+	virtual void resetWarmStart();
 	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<Task*>& tasks,
 		const std::vector<Equality*>& eqConstr,
@@ -65,8 +69,15 @@ private:
 
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
+	/// copy of Q_ given to the fortran solver that can overwrite it,
+	/// Q_ is only filled again when a task change
+	Eigen::MatrixXd QSolve_;
 
 	int nrALines_;
+	bool warmStart_, coldStart_; ///< coldStart_ is true until the next solve.
+
+	QCache qCache_;
+	std::vector<ConstrCache> eqCache_, inEqCache_, genInEqCache_, boundCache_;
 };
 
 } // namespace qp
@@ -35,7 +35,10 @@ QLDQPSolver::QLDQPSolver():
 	beq_(), bineq_(),
 	XL_(),XU_(),
 	Q_(),C_(),
-	nrAeqLines_(0), nrAineqLines_(0)
+	QSolve_(),
+	nrAeqLines_(0), nrAineqLines_(0),
+	qCache_(),
+	eqCache_(), inEqCache_(), genInEqCache_(), boundCache_()
 {
 }
 
@@ -55,8 +58,24 @@ void QLDQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
 	XU_.resize(nrVars);
 
 	Q_.resize(nrVars, nrVars);
+	QSolve_.resize(nrVars, nrVars);
 	C_.resize(nrVars);
 
+	// constraints only write their non zero columns
+	// so other columns must be zeroed once
+	Aeq_.setZero();
+	Aineq_.setZero();
+	beq_.setZero();
+	bineq_.setZero();
+	XL_.fill(-std::numeric_limits<double>::infinity());
+	XU_.fill(std::numeric_limits<double>::infinity());
+
+	qCache_.reset(nrVars);
+	resetConstrCache(eqCache_);
+	resetConstrCache(inEqCache_);
+	resetConstrCache(genInEqCache_);
+	resetConstrCache(boundCache_);
+
 	qld_.problem(nrVars, maxAeqLines, maxAineqLines);
 }
 
@@ -68,31 +87,26 @@ void QLDQPSolver::updateMatrix(
 	const std::vector<GenInequality*>& genInEqConstr,
 	const std::vector<Bound*>& boundConstr)
 {
-	Aeq_.setZero();
-	Aineq_.setZero();
-	beq_.setZero();
-	bineq_.setZero();
-	XL_.fill(-std::numeric_limits<double>::infinity());
-	XU_.fill(std::numeric_limits<double>::infinity());
-	Q_.setZero();
-	C_.setZero();
-
 	const int nrVars = int(Q_.rows());
 
 	nrAeqLines_ = 0;
-	nrAeqLines_ = fillEq(eqConstr, nrVars, nrAeqLines_, Aeq_, beq_);
+	nrAeqLines_ = fillEq(eqConstr, nrVars, nrAeqLines_, Aeq_, beq_, eqCache_);
 	nrAineqLines_ = 0;
-	nrAineqLines_ = fillInEq(inEqConstr, nrVars, nrAineqLines_, Aineq_, bineq_);
-	nrAineqLines_ = fillGenInEq(genInEqConstr, nrVars, nrAineqLines_, Aineq_, bineq_);
+	nrAineqLines_ = fillInEq(inEqConstr, nrVars, nrAineqLines_, Aineq_, bineq_,
+		inEqCache_);
+	nrAineqLines_ = fillGenInEq(genInEqConstr, nrVars, nrAineqLines_, Aineq_,
+		bineq_, genInEqCache_);
 
-	fillBound(boundConstr, XL_, XU_);
-	fillQC(tasks, nrVars, Q_, C_);
+	fillBound(boundConstr, XL_, XU_, boundCache_);
+	fillQC(tasks, nrVars, Q_, C_, qCache_);
 }
 
 
 bool QLDQPSolver::solve()
 {
-	bool success = qld_.solve(Q_, C_,
+	// QL0001 can work in its objective matrix
+	QSolve_ = Q_;
+	bool success = qld_.solve(QSolve_, C_,
 		Aeq_.block(0, 0, nrAeqLines_, int(Aeq_.cols())), beq_.segment(0, nrAeqLines_),
 		Aineq_.block(0, 0, nrAineqLines_, int(Aineq_.cols())), bineq_.segment(0, nrAineqLines_),
 		XL_, XU_, 1e-6);
@@ -100,7 +114,7 @@ bool QLDQPSolver::solve()
 }
 
 
-const Eigen::VectorXd& QLDQPSolver::result() const
+Eigen::Ref<const Eigen::VectorXd> QLDQPSolver::result() const
 {
 	return qld_.result();
 }
@@ -32,6 +32,8 @@ namespace qp
 
 /**
 	* GenQPSolver interface implementation with the QLD QP solver.
+	* QLD is always cold started so the warm start setting is ignored
+	* and nextSolveWarm is always false.
 	*/
 class QLDQPSolver : public GenQPSolver
 {
@@ -45,7 +47,7 @@ public:
 		const std::vector<GenInequality*>& genInEqConstr,
 		const std::vector<Bound*>& boundConstr);
 	virtual bool solve();
-	virtual const Eigen::VectorXd& result() const;
+	virtual Eigen::Ref<const Eigen::VectorXd> result() const;
 	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<Task*>& tasks,
 		const std::vector<Equality*>& eqConstr,
@@ -65,9 +67,15 @@ private:
 
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
+	/// copy of Q_ given to the fortran solver that can overwrite it,
+	/// Q_ is only filled again when a task change
+	Eigen::MatrixXd QSolve_;
 
 	int nrAeqLines_;
 	int nrAineqLines_;
+
+	QCache qCache_;
+	std::vector<ConstrCache> eqCache_, inEqCache_, genInEqCache_, boundCache_;
 };
 
 
@@ -19,6 +19,8 @@
 // includes
 // std
 #include <cmath>
+#include <limits>
+#include <new>
 
 // RBDyn
 #include <RBDyn/MultiBody.h>
@@ -30,6 +32,7 @@
 
 // Tasks
 #include "Bounds.h"
+#include "ThreadPool.h"
 #include "utils.h"
 
 namespace tasks
@@ -317,24 +320,62 @@ sch::Matrix4x4 tosch(const sva::PTransformd& t)
 }
 
 
+/// Sphere bounding the axis aligned box of the hull in its current position.
+static void boundingSphere(const sch::S_Object* hull,
+	Eigen::Vector3d& center, double& radius)
+{
+	Eigen::Vector3d lower, upper;
+	for(int i = 0; i < 3; ++i)
+	{
+		sch::Vector3 dir(0., 0., 0.);
+		dir[i] = 1.;
+		upper(i) = hull->support(dir)[i];
+		dir[i] = -1.;
+		lower(i) = hull->support(dir)[i];
+	}
+
+	center = (lower + upper)/2.;
+	radius = (upper - lower).norm()/2.;
+}
+
+
 
 CollisionConstr::BodyCollData::BodyCollData(const rbd::MultiBody& mb,
 	int rI, int bId, sch::S_Object* h, const sva::PTransformd& X):
 	hull(h),
 	jac(mb, bId),
+	pathBlocks(jointsColBlocks(mb, jac.jointsPath())),
 	X_op_o(X),
+	bound(),
+	rot(Eigen::Matrix3d::Identity()),
+	checkRot(Eigen::Matrix3d::Identity()),
 	rIndex(rI),
 	bIndex(mb.bodyIndexById(bId)),
-	bodyId(bId)
-{}
+	bodyId(bId),
+	bodyJacIndex(-1)
+{
+	// the hull position is set at each update so we can move it
+	// to compute the bounding sphere in the hull frame
+	hull->setTransformation(tosch(sva::PTransformd::Identity()));
+	boundingSphere(hull, bound.center, bound.radius);
+}
 
 
 
 CollisionConstr::CollData::CollData(
-		std::vector<BodyCollData> bcds, int collId,
+		std::vector<BodyCollData> bcds, int collId, sch::CD_Pair* p,
 		sch::S_Object* body1, sch::S_Object* body2,
 		double di, double ds, double damp, double dampOff):
-		pair(new sch::CD_Pair(body1, body2)),
+		pair(p),
+		hulls{body1, body2},
+		bounds(),
+		moving{false, false},
+		hullX(),
+		checkHullX(),
+		checkBounds(),
+		checkDist(0.),
+		checked(false),
+		evaluated(false),
 		normVecDist(Eigen::Vector3d::Zero()),
 		di(di),
 		ds(ds),
@@ -342,25 +383,103 @@ CollisionConstr::CollData::CollData(
 		bodies(std::move(bcds)),
 		dampingType(damping > 0. ? DampingType::Hard : DampingType::Free),
 		dampingOff(dampOff),
-		collId(collId)
+		collId(collId),
+		active(false),
+		AInEq(),
+		bInEq(0.),
+		distJac()
 {
+	for(const BodyCollData& bcd: bodies)
+	{
+		moving[bcd.hull == body1 ? 0 : 1] = true;
+	}
+
+	// NaN force the bounding sphere computation at the first update
+	for(int i = 0; i < 2; ++i)
+	{
+		hullX[i].setConstant(std::numeric_limits<double>::quiet_NaN());
+		checkHullX[i] = hullX[i];
+	}
 }
 
 
 
 CollisionConstr::CollisionConstr(const std::vector<rbd::MultiBody>& mbs, double step):
 	dataVec_(),
+	freePairs_(),
+	reservedColls_(0),
 	step_(step),
 	nrActivated_(0),
 	totalAlphaD_(-1),
 	AInEq_(),
 	bInEq_(),
-	fullJac_(),
-	distJac_()
+	colBlocks_(),
+	maxDof_(std::max_element(mbs.begin(), mbs.end(), compareDof)->nrDof()),
+	nrVars_(0),
+	skipFarPairs_(true),
+	pool_()
 {
-	int maxDof = std::max_element(mbs.begin(), mbs.end(), compareDof)->nrDof();
-	fullJac_.resize(1, maxDof);
-	distJac_.resize(1, maxDof);
+}
+
+
+// must declare it in cpp because of ThreadPool fwd declarition
+CollisionConstr::~CollisionConstr()
+{
+	reset();
+	for(void* mem: freePairs_)
+	{
+		::operator delete(mem);
+	}
+}
+
+
+void CollisionConstr::reserve(int nrCollisions)
+{
+	reservedColls_ = nrCollisions;
+	dataVec_.reserve(nrCollisions);
+	freePairs_.reserve(nrCollisions);
+	for(int i = int(dataVec_.size() + freePairs_.size()); i < nrCollisions; ++i)
+	{
+		freePairs_.push_back(::operator new(sizeof(sch::CD_Pair)));
+	}
+}
+
+
+void CollisionConstr::freePair(sch::CD_Pair* pair)
+{
+	pair->~CD_Pair();
+	freePairs_.push_back(pair);
+}
+
+
+void CollisionConstr::nrThreads(int nrThreads, const std::vector<int>& cpus)
+{
+	if(nrThreads > 1)
+	{
+		pool_.reset(new ThreadPool(nrThreads, cpus));
+	}
+	else
+	{
+		pool_.reset();
+	}
+}
+
+
+int CollisionConstr::nrThreads() const
+{
+	return pool_ ? pool_->nrThreads() : 1;
+}
+
+
+void CollisionConstr::skipFarPairs(bool skip)
+{
+	skipFarPairs_ = skip;
+}
+
+
+bool CollisionConstr::skipFarPairs() const
+{
+	return skipFarPairs_;
 }
 
 
@@ -371,8 +490,8 @@ void CollisionConstr::addCollision(const std::vector<rbd::MultiBody>& mbs, int c
 	sch::S_Object* body2, const sva::PTransformd& X_op2_o2,
 	double di, double ds, double damping, double dampingOff)
 {
-	const rbd::MultiBody mb1 = mbs[r1Index];
-	const rbd::MultiBody mb2 = mbs[r2Index];
+	const rbd::MultiBody& mb1 = mbs[r1Index];
+	const rbd::MultiBody& mb2 = mbs[r2Index];
 	std::vector<BodyCollData> bodies;
 	if(mb1.nrDof() > 0)
 	{
@@ -383,8 +502,23 @@ void CollisionConstr::addCollision(const std::vector<rbd::MultiBody>& mbs, int c
 		bodies.emplace_back(mb2, r2Index, r2BodyId, body2, X_op2_o2);
 	}
 
-	dataVec_.emplace_back(std::move(bodies), collId, body1, body2,
+	// the sch pair memory of a removed pair is reused
+	void* mem = nullptr;
+	if(freePairs_.empty())
+	{
+		mem = ::operator new(sizeof(sch::CD_Pair));
+	}
+	else
+	{
+		mem = freePairs_.back();
+		freePairs_.pop_back();
+	}
+	sch::CD_Pair* pair = new (mem) sch::CD_Pair(body1, body2);
+
+	dataVec_.emplace_back(std::move(bodies), collId, pair, body1, body2,
 		di, ds, damping, dampingOff);
+	dataVec_.back().distJac.resize(1, maxDof_);
+	dataVec_.back().AInEq.setZero(std::max(totalAlphaD_, 0));
 }
 
 
@@ -398,7 +532,7 @@ bool CollisionConstr::rmCollision(int collId)
 
 	if(it != dataVec_.end())
 	{
-		delete it->pair;
+		freePair(it->pair);
 		dataVec_.erase(it);
 		return true;
 	}
@@ -415,14 +549,37 @@ std::size_t CollisionConstr::nrCollisions() const
 
 void CollisionConstr::reset()
 {
+	for(CollData& d: dataVec_)
+	{
+		freePair(d.pair);
+	}
 	dataVec_.clear();
 }
 
 
 void CollisionConstr::updateNrCollisions()
 {
-	AInEq_.setZero(dataVec_.size(), nrVars_);
-	bInEq_.setZero(dataVec_.size());
+	// keep the reserved lines so adding a pair don't resize the matrix
+	int nrLines = std::max(int(dataVec_.size()), reservedColls_);
+	AInEq_.setZero(nrLines, nrVars_);
+	bInEq_.setZero(nrLines);
+	for(CollData& d: dataVec_)
+	{
+		d.AInEq.setZero(std::max(totalAlphaD_, 0));
+	}
+}
+
+
+void CollisionConstr::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	for(CollData& d: dataVec_)
+	{
+		for(BodyCollData& bcd: d.bodies)
+		{
+			bcd.bodyJacIndex = data.addBodyJacobian(mbs, bcd.rIndex, bcd.bodyId);
+		}
+	}
 }
 
 
@@ -430,7 +587,11 @@ void CollisionConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mb */,
 	const SolverData& data)
 {
 	totalAlphaD_ = data.totalAlphaD();
-	nrVars_ = data.nrVars();
+	nrVars_ = data.maxNrVars();
+	// collision can be added between two updateNrVars call
+	// so we declare all the alphaD vector
+	colBlocks_.clear();
+	addColBlock(colBlocks_, 0, totalAlphaD_);
 	updateNrCollisions();
 }
 
@@ -438,101 +599,259 @@ void CollisionConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mb */,
 void CollisionConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
+{
+	// a hull can be shared between pairs so hull positions are set
+	// before computing the pairs
+	for(CollData& d: dataVec_)
+	{
+		// update moving hull position and bounding spheres
+		for(int i = 0, bi = 0; i < 2; ++i)
+		{
+			BoundingSphere& bound = d.bounds[i];
+			if(d.moving[i])
+			{
+				BodyCollData& bcd = d.bodies[bi++];
+				const rbd::MultiBodyConfig& mbc = mbcs[bcd.rIndex];
+				sva::PTransformd X_0_o = bcd.X_op_o*mbc.bodyPosW[bcd.bIndex];
+				bcd.hull->setTransformation(tosch(X_0_o));
+				bcd.rot = X_0_o.rotation();
+				bound.center = X_0_o.translation() +
+					X_0_o.rotation().transpose()*bcd.bound.center;
+				bound.radius = bcd.bound.radius;
+			}
+			else
+			{
+				// a robot without dof doesn't move its hull, only recompute
+				// the bounding sphere if the user has moved it
+				Eigen::Matrix<double, 16, 1> X_0_o;
+				d.hulls[i]->getTransformationMatrix(X_0_o.data());
+				if(X_0_o != d.hullX[i])
+				{
+					d.hullX[i] = X_0_o;
+					boundingSphere(d.hulls[i], bound.center, bound.radius);
+				}
+			}
+		}
+	}
+
+	auto update = [this, &mbs, &mbcs, &data](int i)
+	{
+		updatePair(mbs, mbcs, data, dataVec_[i]);
+	};
+
+	if(pool_)
+	{
+		// pairs only write their own data
+		pool_->parallelFor(int(dataVec_.size()), update);
+	}
+	else
+	{
+		for(int i = 0; i < int(dataVec_.size()); ++i)
+		{
+			update(i);
+		}
+	}
+
+	// store activated pairs in the pair order
+	nrActivated_ = 0;
+	for(const CollData& d: dataVec_)
+	{
+		if(d.active)
+		{
+			AInEq_.block(nrActivated_, 0, 1, totalAlphaD_) = d.AInEq;
+			bInEq_(nrActivated_) = d.bInEq;
+			++nrActivated_;
+		}
+	}
+}
+
+
+void CollisionConstr::updatePair(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs,
+	const SolverData& data, CollData& d) const
 {
 	using namespace Eigen;
 
 	Vector3d nearestPoint[2];
 
-	nrActivated_ = 0;
-	for(CollData& d: dataVec_)
+	// d.normVecDist is the distance vector direction of the last update
+	// only if the pair has not been skipped
+	bool wasEvaluated = d.evaluated;
+	d.active = false;
+	d.evaluated = false;
+
+	// skip the closest points computation if the bounding spheres
+	// are farther than di, the constraint can't be activated
+	double centerDist = (d.bounds[0].center - d.bounds[1].center).norm();
+	if(skipFarPairs_ && centerDist - d.bounds[0].radius - d.bounds[1].radius > d.di)
 	{
-		// update moving hull position
-		for(BodyCollData& bcd: d.bodies)
+		if(d.dampingType == CollData::DampingType::Soft)
 		{
-			const rbd::MultiBodyConfig& mbc = mbcs[bcd.rIndex];
-			bcd.hull->setTransformation(tosch(bcd.X_op_o*mbc.bodyPosW[bcd.bIndex]));
+			d.dampingType = CollData::DampingType::Free;
 		}
+		return;
+	}
 
-		sch::Point3 pb1Tmp, pb2Tmp;
-		double dist = d.pair->getClosestPoints(pb1Tmp, pb2Tmp);
-		dist = dist >= 0 ? std::sqrt(dist) : -std::sqrt(-dist);
+	// skip the closest points computation if the hulls can't have moved
+	// enough since the last computation to be closer than di
+	if(skipFarPairs_ && d.checked && d.checkDist - maxDisplacement(d) > d.di)
+	{
+		if(d.dampingType == CollData::DampingType::Soft)
+		{
+			d.dampingType = CollData::DampingType::Free;
+		}
+		return;
+	}
 
-		nearestPoint[0] << pb1Tmp[0], pb1Tmp[1], pb1Tmp[2];
-		nearestPoint[1] << pb2Tmp[0], pb2Tmp[1], pb2Tmp[2];
+	sch::Point3 pb1Tmp, pb2Tmp;
+	double dist = d.pair->getClosestPoints(pb1Tmp, pb2Tmp);
+	dist = dist >= 0 ? std::sqrt(dist) : -std::sqrt(-dist);
+
+	d.checked = true;
+	d.evaluated = true;
+	d.checkDist = dist;
+	d.checkBounds[0] = d.bounds[0];
+	d.checkBounds[1] = d.bounds[1];
+	d.checkHullX[0] = d.hullX[0];
+	d.checkHullX[1] = d.hullX[1];
+	for(BodyCollData& bcd: d.bodies)
+	{
+		bcd.checkRot = bcd.rot;
+	}
+
+	nearestPoint[0] << pb1Tmp[0], pb1Tmp[1], pb1Tmp[2];
+	nearestPoint[1] << pb2Tmp[0], pb2Tmp[1], pb2Tmp[2];
+
+	Eigen::Vector3d normVecDist = (nearestPoint[0] - nearestPoint[1])/dist;
 
-		Eigen::Vector3d normVecDist = (nearestPoint[0] - nearestPoint[1])/dist;
+	// compute nearestPoint in body coordinate
+	for(std::size_t i = 0; i < d.bodies.size(); ++i)
+	{
+		BodyCollData& bcd = d.bodies[i];
+		const rbd::MultiBodyConfig& mbc = mbcs[bcd.rIndex];
+		nearestPoint[i] = (sva::PTransformd(nearestPoint[i])*
+			mbc.bodyPosW[bcd.bIndex].inv()).translation();
 
-		// compute nearestPoint in body coordinate
+		// change the jacobian end point
+		bcd.jac.point(nearestPoint[i]);
+	}
+
+	if(dist < d.di)
+	{
+		// automatic damping computation if needed
+		if(d.dampingType == CollData::DampingType::Free)
+		{
+			d.dampingType = CollData::DampingType::Soft;
+			d.damping = computeDamping(mbs, mbcs, d, normVecDist, dist);
+		}
+
+		double dampers = d.damping*((dist - d.ds)/(d.di - d.ds));
+
+		// the distance vector direction derivative is only known if the
+		// pair has been evaluated at the last update, it's taken null
+		// if the pair was skipped or just added
+		Vector3d nf = normVecDist;
+		Vector3d dnf(Vector3d::Zero());
+		if(wasEvaluated)
+		{
+			dnf = (nf - d.normVecDist)/step_;
+		}
+
+		double sign = 1.;
+		d.bInEq = dampers;
+		d.AInEq.setZero();
 		for(std::size_t i = 0; i < d.bodies.size(); ++i)
 		{
 			BodyCollData& bcd = d.bodies[i];
+			const rbd::MultiBody& mb = mbs[bcd.rIndex];
 			const rbd::MultiBodyConfig& mbc = mbcs[bcd.rIndex];
-			nearestPoint[i] = (sva::PTransformd(nearestPoint[i])*
-				mbc.bodyPosW[bcd.bIndex].inv()).translation();
 
-			// change the jacobian end point
-			bcd.jac.point(nearestPoint[i]);
-		}
+			// Compute body1
+			Eigen::Vector3d pSpeed = bcd.jac.velocity(mb, mbc).linear();
+			Eigen::Vector3d pNormalAcc = bcd.jac.normalAcceleration(
+				mb, mbc, data.normalAccB(bcd.rIndex)).linear();
 
-		if(dist < d.di)
-		{
-			// automatic damping computation if needed
-			if(d.dampingType == CollData::DampingType::Free)
+			// pairs added without a registerData call compute their own jacobian
+			const BodyJacobian* bodyJac = data.bodyJacobian(bcd.bodyJacIndex,
+				bcd.rIndex, bcd.bIndex);
+			if(bodyJac)
 			{
-				d.dampingType = CollData::DampingType::Soft;
-				d.damping = computeDamping(mbs, mbcs, d, normVecDist, dist);
+				// n^T*J_p with n in body coordinates and J_p the linear part
+				// of the body jacobian moved at the nearest point:
+				// n^T*(J_v - p x J_w) = n^T*J_v + (p x n)^T*J_w
+				const MatrixXd& bJac = bodyJac->bodyJac();
+				Vector3d nB = mbc.bodyPosW[bcd.bIndex].rotation()*(nf*step_*sign);
+				Vector3d pxn = nearestPoint[i].cross(nB);
+				d.distJac.block(0, 0, 1, bcd.jac.dof()).noalias() =
+					nB.transpose()*bJac.bottomRows<3>();
+				d.distJac.block(0, 0, 1, bcd.jac.dof()).noalias() +=
+					pxn.transpose()*bJac.topRows<3>();
 			}
-
-			double dampers = d.damping*((dist - d.ds)/(d.di - d.ds));
-
-			Vector3d nf = normVecDist;
-			Vector3d onf = d.normVecDist;
-			Vector3d dnf = (nf - onf)/step_;
-
-			double sign = 1.;
-			bInEq_(nrActivated_) = dampers;
-			AInEq_.block(nrActivated_, 0, 1, totalAlphaD_).setZero();
-			for(std::size_t i = 0; i < d.bodies.size(); ++i)
+			else
 			{
-				BodyCollData& bcd = d.bodies[i];
-				const rbd::MultiBody& mb = mbs[bcd.rIndex];
-				const rbd::MultiBodyConfig& mbc = mbcs[bcd.rIndex];
-
-				// Compute body1
 				const MatrixXd& jac = bcd.jac.jacobian(mb, mbc);
-				Eigen::Vector3d pSpeed = bcd.jac.velocity(mb, mbc).linear();
-				Eigen::Vector3d pNormalAcc = bcd.jac.normalAcceleration(
-					mb, mbc, data.normalAccB(bcd.rIndex)).linear();
-
-				distJac_.block(0, 0, 1, bcd.jac.dof()).noalias() =
+				d.distJac.block(0, 0, 1, bcd.jac.dof()).noalias() =
 					(nf*step_*sign).transpose()*jac.block(3, 0, 3, bcd.jac.dof());
+			}
 
-				bcd.jac.fullJacobian(mb, distJac_.block(0, 0, 1, bcd.jac.dof()), fullJac_);
-
-				double jqdn = pSpeed.dot(nf);
-				double jqdnd = pSpeed.dot(dnf*step_);
-				double jdqdn = pNormalAcc.dot(nf*step_);
+			double jqdn = pSpeed.dot(nf);
+			double jqdnd = pSpeed.dot(dnf*step_);
+			double jdqdn = pNormalAcc.dot(nf*step_);
 
-				AInEq_.block(nrActivated_, data.alphaDBegin(bcd.rIndex),
-					1, mb.nrDof()).noalias() -= fullJac_.block(0, 0, 1, mb.nrDof());
-				bInEq_(nrActivated_) += sign*(jqdn + jqdnd + jdqdn);
-				// little hack
-				// the max iteration number is two, so at the second iteration
-				// sign will be -1
-				sign = -1.;
+			// jacobian columns are written on the body path dof only
+			// (rbd::Jacobian::fullJacobian resize its result for each robot)
+			int alphaDBegin = data.alphaDBegin(bcd.rIndex);
+			int jacCol = 0;
+			for(const ColBlock& pb: bcd.pathBlocks)
+			{
+				d.AInEq.segment(alphaDBegin + pb.begin, pb.size) -=
+					d.distJac.block(0, jacCol, 1, pb.size);
+				jacCol += pb.size;
 			}
-			++nrActivated_;
+			d.bInEq += sign*(jqdn + jqdnd + jdqdn);
+			// little hack
+			// the max iteration number is two, so at the second iteration
+			// sign will be -1
+			sign = -1.;
 		}
-		else
+		d.active = true;
+	}
+	else
+	{
+		if(d.dampingType == CollData::DampingType::Soft)
 		{
-			if(d.dampingType == CollData::DampingType::Soft)
-			{
-				d.dampingType = CollData::DampingType::Free;
-			}
+			d.dampingType = CollData::DampingType::Free;
 		}
+	}
 
-		d.normVecDist = normVecDist;
+	d.normVecDist = normVecDist;
+}
+
+
+double CollisionConstr::maxDisplacement(const CollData& d) const
+{
+	double displacement = 0.;
+	for(int i = 0, bi = 0; i < 2; ++i)
+	{
+		const BoundingSphere& bound = d.bounds[i];
+		const BoundingSphere& checkBound = d.checkBounds[i];
+		if(d.moving[i])
+		{
+			// a point at r from the sphere center move at most from the center
+			// displacement plus r*||R - R_check||, with the spectral norm
+			// ||R - R_check|| = ||R - R_check||_F/sqrt(2) for rotation matrices
+			const BodyCollData& bcd = d.bodies[bi++];
+			displacement += (bound.center - checkBound.center).norm() +
+				bound.radius*(bcd.rot - bcd.checkRot).norm()/std::sqrt(2.);
+		}
+		else if(d.hullX[i] != d.checkHullX[i])
+		{
+			// a rotation around the bounding sphere center doesn't move the
+			// sphere so the hull transformation must be compared
+			return std::numeric_limits<double>::infinity();
+		}
 	}
+	return displacement;
 }
 
 
@@ -599,6 +918,12 @@ const Eigen::VectorXd& CollisionConstr::bInEq() const
 }
 
 
+const std::vector<ColBlock>& CollisionConstr::AInEqBlocks() const
+{
+	return colBlocks_;
+}
+
+
 double CollisionConstr::computeDamping(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs, const CollData& cd,
 	const Eigen::Vector3d& normVecDist, double dist) const
@@ -662,7 +987,8 @@ CoMIncPlaneConstr::CoMIncPlaneConstr(const std::vector<rbd::MultiBody>& mbs,
 	activated_(0),
 	jacCoM_(mbs[robotIndex]),
 	AInEq_(),
-	bInEq_()
+	bInEq_(),
+	colBlocks_()
 {
 }
 
@@ -715,11 +1041,13 @@ void CoMIncPlaneConstr::updateNrPlanes()
 }
 
 
-void CoMIncPlaneConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
+void CoMIncPlaneConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	const SolverData& data)
 {
 	alphaDBegin_ = data.alphaDBegin(robotIndex_);
-	nrVars_ = data.nrVars();
+	nrVars_ = data.maxNrVars();
+	colBlocks_.clear();
+	addColBlock(colBlocks_, alphaDBegin_, mbs[robotIndex_].nrDof());
 	updateNrPlanes();
 }
 
@@ -846,6 +1174,12 @@ const Eigen::VectorXd& CoMIncPlaneConstr::bInEq() const
 }
 
 
+const std::vector<ColBlock>& CoMIncPlaneConstr::AInEqBlocks() const
+{
+	return colBlocks_;
+}
+
+
 /**
 	*													GripperTorqueConstr
 	*/
@@ -863,7 +1197,9 @@ GripperTorqueConstr::GripperData::GripperData(const ContactId& cId, double tl,
 GripperTorqueConstr::GripperTorqueConstr():
 	dataVec_(),
 	AInEq_(),
-	bInEq_()
+	bInEq_(),
+	colBlocks_(),
+	version_(newVersion())
 {}
 
 
@@ -898,45 +1234,54 @@ void GripperTorqueConstr::reset()
 }
 
 
+void GripperTorqueConstr::registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+	SolverData& data)
+{
+	// the gripper lambda come from the bilateral contacts
+	data.dependOnContacts();
+}
+
+
 void GripperTorqueConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
 	using namespace Eigen;
-	AInEq_.setZero(dataVec_.size(), data.nrVars());
+	AInEq_.setZero(dataVec_.size(), data.maxNrVars());
 	bInEq_.setZero(dataVec_.size());
+	colBlocks_.clear();
 
 	int line = 0;
 	int nrUni = int(data.unilateralContacts().size());
 	for(const GripperData& gd: dataVec_)
 	{
-		for(std::size_t bi = 0; bi < data.bilateralContacts().size(); ++bi)
+		// if the contact is not a bilateral contact with the
+		// ContactModel::Generators model the AInEq_ and BInEq_ line stay at zero
+		int index = data.contactIndex(gd.contactId);
+		if(index >= nrUni &&
+			 data.allContacts()[index].model == ContactModel::Generators)
 		{
-			const BilateralContact& bc = data.bilateralContacts()[bi];
-
-			if(bc.contactId == gd.contactId)
+			const BilateralContact& bc = data.allContacts()[index];
+			int col = data.lambdaBegin(index);
+			addColBlock(colBlocks_, col, bc.nrLambda());
+			// Torque applied on the gripper motor
+			// Sum_i^nrF  T_i·( p_i^T_o x f_i)
+			for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
 			{
-				int col = data.lambdaBegin(int(bi) + nrUni);
-				// Torque applied on the gripper motor
-				// Sum_i^nrF  T_i·( p_i^T_o x f_i)
-				for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
+				Vector3d T_o_p = bc.r1Points[i] - gd.origin;
+				for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
 				{
-					Vector3d T_o_p = bc.r1Points[i] - gd.origin;
-					for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
-					{
-						// we use abs because the contact force cannot apply
-						// negative torque on the gripper
-						AInEq_(line, col) = std::abs(
-							gd.axis.transpose()*(T_o_p.cross(bc.r1Cones[i].generators[j])));
-						++col;
-					}
+					// we use abs because the contact force cannot apply
+					// negative torque on the gripper
+					AInEq_(line, col) = std::abs(
+						gd.axis.transpose()*(T_o_p.cross(bc.r1Cones[i].generators[j])));
+					++col;
 				}
-				bInEq_(line) = gd.torqueLimit;
-				++line;
-				break;
 			}
-			// if the bodyId is not found the AInEq_ and BInEq_ line stay at zero
+			bInEq_(line) = gd.torqueLimit;
+			++line;
 		}
 	}
+	version_ = newVersion();
 }
 
 
@@ -987,6 +1332,18 @@ const Eigen::VectorXd& GripperTorqueConstr::bInEq() const
 }
 
 
+const std::vector<ColBlock>& GripperTorqueConstr::AInEqBlocks() const
+{
+	return colBlocks_;
+}
+
+
+int GripperTorqueConstr::versionInEq() const
+{
+	return version_;
+}
+
+
 /**
 	*															BoundedSpeedConstr
 	*/
@@ -1000,6 +1357,7 @@ BoundedSpeedConstr::BoundedSpeedConstr(const std::vector<rbd::MultiBody>& mbs,
 	A_(),
 	lower_(),
 	upper_(),
+	colBlocks_(),
 	nrVars_(0),
 	timeStep_(timeStep)
 {}
@@ -1060,11 +1418,23 @@ void BoundedSpeedConstr::updateBoundedSpeeds()
 }
 
 
-void BoundedSpeedConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
+void BoundedSpeedConstr::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	for(BoundedSpeedData& c: cont_)
+	{
+		c.bodyJacIndex = data.addBodyJacobian(mbs, robotIndex_, c.bodyId);
+	}
+}
+
+
+void BoundedSpeedConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	const SolverData& data)
 {
 	alphaDBegin_ = data.alphaDBegin(robotIndex_);
-	nrVars_ = data.nrVars();
+	nrVars_ = data.maxNrVars();
+	colBlocks_.clear();
+	addColBlock(colBlocks_, alphaDBegin_, mbs[robotIndex_].nrDof());
 	updateNrEq();
 }
 
@@ -1088,10 +1458,23 @@ void BoundedSpeedConstr::update(const std::vector<rbd::MultiBody>& mbs,
 		int rows = int(cont_[i].dof.rows());
 
 		// AEq
-		const MatrixXd& jac = cont_[i].jac.bodyJacobian(mb, mbc);
-		cont_[i].jac.fullJacobian(mb, jac, fullJac_);
-		A_.block(index, alphaDBegin_, rows, mb.nrDof()).noalias() =
-			cont_[i].dof*fullJac_;
+		// bounded speeds added without a registerData call
+		// compute their own jacobian
+		const BodyJacobian* bodyJac = data.bodyJacobian(cont_[i].bodyJacIndex,
+			robotIndex_, cont_[i].body);
+		if(bodyJac)
+		{
+			cont_[i].jac.fullJacobian(mb, bodyJac->bodyJac(), fullJac_);
+			A_.block(index, alphaDBegin_, rows, mb.nrDof()).noalias() =
+				cont_[i].dofX*fullJac_;
+		}
+		else
+		{
+			const MatrixXd& jac = cont_[i].jac.bodyJacobian(mb, mbc);
+			cont_[i].jac.fullJacobian(mb, jac, fullJac_);
+			A_.block(index, alphaDBegin_, rows, mb.nrDof()).noalias() =
+				cont_[i].dof*fullJac_;
+		}
 
 		// BEq
 		Vector6d speed = cont_[i].jac.bodyVelocity(mb, mbc).vector();
@@ -1155,6 +1538,12 @@ const Eigen::VectorXd& BoundedSpeedConstr::UpperGenInEq() const
 }
 
 
+const std::vector<ColBlock>& BoundedSpeedConstr::AGenInEqBlocks() const
+{
+	return colBlocks_;
+}
+
+
 void BoundedSpeedConstr::updateNrEq()
 {
 	int nrEq = 0;
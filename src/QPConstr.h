@@ -16,6 +16,9 @@
 #pragma once
 
 // includes
+// std
+#include <memory>
+
 // Eigen
 #include <Eigen/Core>
 
@@ -213,6 +216,13 @@ private:
 	* the distance \f$ d \f$ go below the interactive distance \f$ d_i \f$ with
 	* the following formula:
 	* \f[ \xi = -\frac{d_i - d_s}{d - d_s}\alpha + \xi_{\text{off}} \f]
+	*
+	* Each hull is bounded by a sphere. The closest points of a pair are only
+	* computed if the distance between the two spheres is below \f$ d_i \f$
+	* and if the hulls have moved enough since the last computation
+	* to be closer than \f$ d_i \f$.
+	* Hulls of robots without dof are considered fixed while their bounding
+	* sphere doesn't change.
 	*/
 class CollisionConstr : public ConstraintFunction<Inequality>
 {
@@ -222,6 +232,30 @@ public:
 		* @param step Time step in second.
 		*/
 	CollisionConstr(const std::vector<rbd::MultiBody>& mbs, double step);
+	~CollisionConstr();
+
+	/**
+		* Compute the collision pairs in parallel.
+		* Hull positions are set before so hulls can be shared between pairs.
+		* Activated pairs are always stored in the pair order so the
+		* constraint matrix doesn't depend of the number of threads.
+		* @param nrThreads Number of threads that compute the pairs
+		* (including the calling thread), 1 to compute them
+		* sequentially (default).
+		* @param cpus CPU of each created thread, empty to not pin them.
+		*/
+	void nrThreads(int nrThreads, const std::vector<int>& cpus=std::vector<int>());
+	int nrThreads() const;
+
+	/**
+		* Skip the closest points computation of the pairs that can't be closer
+		* than di (default).
+		* The constraint is the same with or without skipping except when
+		* a pair is activated just after being skipped, its distance vector
+		* direction derivative is then taken null.
+		*/
+	void skipFarPairs(bool skip);
+	bool skipFarPairs() const;
 
 	/**
 		* Add a collision avoidance constraint.
@@ -268,10 +302,21 @@ public:
 	/// Remove all collision constraints.
 	void reset();
 
+	/**
+		* Reserve the storage of nrCollisions pairs (pair list, sch pairs and
+		* constraint lines) so adding pairs below this number don't reallocate
+		* it. addCollision still build the jacobians of the new pair bodies.
+		* Constraint lines are taken into account by the next
+		* updateNrCollisions call.
+		*/
+	void reserve(int nrCollisions);
+
 	/// Reallocate A and b matrix.
 	void updateNrCollisions();
 
 	// Constraint
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
@@ -288,8 +333,15 @@ public:
 
 	virtual const Eigen::MatrixXd& AInEq() const;
 	virtual const Eigen::VectorXd& bInEq() const;
+	virtual const std::vector<ColBlock>& AInEqBlocks() const;
 
 private:
+	struct BoundingSphere
+	{
+		Eigen::Vector3d center;
+		double radius;
+	};
+
 	struct BodyCollData
 	{
 		BodyCollData(const rbd::MultiBody& mb,
@@ -298,18 +350,44 @@ private:
 
 		sch::S_Object* hull;
 		rbd::Jacobian jac;
+		/// robot dof of the jacobian columns
+		std::vector<ColBlock> pathBlocks;
 		sva::PTransformd X_op_o;
+		/// hull bounding sphere in the hull frame
+		BoundingSphere bound;
+		/// hull orientation at the last update and at the last
+		/// closest points computation
+		Eigen::Matrix3d rot, checkRot;
 		int rIndex, bIndex, bodyId;
+		/// SolverData::bodyJacobian index, -1 if not registered
+		int bodyJacIndex;
 	};
 
 	struct CollData
 	{
 		enum class DampingType {Hard, Soft, Free};
-		CollData(std::vector<BodyCollData> bcds, int collId,
+		CollData(std::vector<BodyCollData> bcds, int collId, sch::CD_Pair* pair,
 			sch::S_Object* body1, sch::S_Object* body2,
 			double di, double ds, double damping, double dampingOff);
 
 		sch::CD_Pair* pair;
+		/// body1 and body2 hull
+		sch::S_Object* hulls[2];
+		/// body1 and body2 bounding sphere in world frame
+		BoundingSphere bounds[2];
+		/// true if the hull is attached to a robot with dof (in bodies)
+		bool moving[2];
+		/// transformation of the hulls not in bodies (moved by the user)
+		/// at the last update and at the last closest points computation
+		Eigen::Matrix<double, 16, 1, Eigen::DontAlign> hullX[2], checkHullX[2];
+		/// bounding spheres and distance at the last closest points computation
+		BoundingSphere checkBounds[2];
+		double checkDist;
+		/// false until the first closest points computation
+		bool checked;
+		/// true if the closest points have been computed at the last update
+		bool evaluated;
+		/// distance vector direction at the last closest points computation
 		Eigen::Vector3d normVecDist;
 		double di, ds;
 		double damping;
@@ -318,24 +396,52 @@ private:
 		DampingType dampingType;
 		double dampingOff;
 		int collId;
+
+		/// true if the constraint is activated at the last update
+		bool active;
+		/// constraint line computed at the last update
+		Eigen::RowVectorXd AInEq;
+		double bInEq;
+		Eigen::MatrixXd distJac;
 	};
 
 private:
+	/// Compute the distance of a pair and its constraint line if activated.
+	void updatePair(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs,
+		const SolverData& data, CollData& d) const;
+
+	/**
+		* @return Upper bound of the distance travelled by the hulls points
+		* since the last closest points computation.
+		*/
+	double maxDisplacement(const CollData& d) const;
+
 	double computeDamping(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs, const CollData& cd,
 		const Eigen::Vector3d& normalVecDist, double dist) const;
 
+	/// Destroy the pair and keep its memory for the next addCollision.
+	void freePair(sch::CD_Pair* pair);
+
 private:
 	std::vector<CollData> dataVec_;
+	/// memory of the destroyed sch pairs
+	std::vector<void*> freePairs_;
+	int reservedColls_;
 	double step_;
 	int nrActivated_, totalAlphaD_;
 
 	Eigen::MatrixXd AInEq_;
 	Eigen::VectorXd bInEq_;
+	std::vector<ColBlock> colBlocks_;
 
-	Eigen::MatrixXd fullJac_, distJac_;
+	int maxDof_;
 
 	int nrVars_;
+
+	bool skipFarPairs_;
+	std::unique_ptr<ThreadPool> pool_;
 };
 
 
@@ -419,6 +525,7 @@ public:
 
 	virtual const Eigen::MatrixXd& AInEq() const;
 	virtual const Eigen::VectorXd& bInEq() const;
+	virtual const std::vector<ColBlock>& AInEqBlocks() const;
 
 private:
 	struct PlaneData
@@ -448,6 +555,7 @@ private:
 	rbd::CoMJacobian jacCoM_;
 	Eigen::MatrixXd AInEq_;
 	Eigen::VectorXd bInEq_;
+	std::vector<ColBlock> colBlocks_;
 };
 
 
@@ -463,6 +571,8 @@ public:
 	void reset();
 
 	// Constraint
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mb,
 		const SolverData& data);
 
@@ -478,6 +588,8 @@ public:
 
 	virtual const Eigen::MatrixXd& AInEq() const;
 	virtual const Eigen::VectorXd& bInEq() const;
+	virtual const std::vector<ColBlock>& AInEqBlocks() const;
+	virtual int versionInEq() const;
 
 private:
 	struct GripperData
@@ -496,6 +608,8 @@ private:
 
 	Eigen::MatrixXd AInEq_;
 	Eigen::VectorXd bInEq_;
+	std::vector<ColBlock> colBlocks_;
+	int version_;
 };
 
 
@@ -575,6 +689,8 @@ public:
 	void updateBoundedSpeeds();
 
 	// Constraint
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
@@ -591,6 +707,7 @@ public:
 	virtual const Eigen::MatrixXd& AGenInEq() const;
 	virtual const Eigen::VectorXd& LowerGenInEq() const;
 	virtual const Eigen::VectorXd& UpperGenInEq() const;
+	virtual const std::vector<ColBlock>& AGenInEqBlocks() const;
 
 private:
 	struct BoundedSpeedData
@@ -600,18 +717,24 @@ private:
 			jac(j),
 			bodyPoint(j.point()),
 			dof(d),
+			dofX(d*bodyPoint.matrix()),
 			lSpeed(ls),
 			uSpeed(us),
 			body(j.jointsPath().back()),
-			bodyId(bId)
+			bodyId(bId),
+			bodyJacIndex(-1)
 		{}
 
 		rbd::Jacobian jac;
 		sva::PTransformd bodyPoint;
 		Eigen::MatrixXd dof;
+		/// dof*bodyPoint, apply dof on the body jacobian at the body origin
+		Eigen::MatrixXd dofX;
 		Eigen::VectorXd lSpeed, uSpeed;
 		int body;
 		int bodyId;
+		/// SolverData::bodyJacobian index, -1 if not registered
+		int bodyJacIndex;
 	};
 
 private:
@@ -625,6 +748,7 @@ private:
 
 	Eigen::MatrixXd A_;
 	Eigen::VectorXd lower_, upper_;
+	std::vector<ColBlock> colBlocks_;
 
 	int nrVars_;
 	double timeStep_;
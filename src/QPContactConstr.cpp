@@ -117,10 +117,11 @@ ContactConstrCommon::contactCommonInContact(
 
 ContactConstr::ContactConstr():
 	cont_(),
-	fullJac_(),
+	frameJac_(),
 	dofJac_(),
 	A_(),
 	b_(),
+	colBlocks_(),
 	nrEq_(0),
 	totalAlphaD_(0)
 {}
@@ -144,6 +145,24 @@ void ContactConstr::updateDofContacts()
 }
 
 
+void ContactConstr::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	data.dependOnContacts();
+	for(const ContactCommon& cC: contactCommonInContact(mbs, data))
+	{
+		if(mbs[cC.cId.r1Index].nrDof() > 0)
+		{
+			data.addBodyJacobian(mbs, cC.cId.r1Index, cC.cId.r1BodyId);
+		}
+		if(mbs[cC.cId.r2Index].nrDof() > 0)
+		{
+			data.addBodyJacobian(mbs, cC.cId.r2Index, cC.cId.r2BodyId);
+		}
+	}
+}
+
+
 void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	const SolverData& data)
 {
@@ -151,7 +170,7 @@ void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	totalAlphaD_ = data.totalAlphaD();
 
 	int maxDof = std::max_element(mbs.begin(), mbs.end(), compareDof)->nrDof();
-	fullJac_.resize(6, maxDof);
+	frameJac_.resize(6, maxDof);
 	dofJac_.resize(6, maxDof);
 
 	std::set<ContactCommon> contactCSet = contactCommonInContact(mbs, data);
@@ -169,8 +188,9 @@ void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		{
 			if(mbs[rIndex].nrDof() > 0)
 			{
-				contacts.emplace_back(rIndex, data.alphaDBegin(rIndex), sign,
-															rbd::Jacobian(mbs[rIndex], bId), point);
+				contacts.emplace_back(mbs[rIndex], rIndex, data.alphaDBegin(rIndex),
+															data.bodyJacobianIndex(mbs, rIndex, bId), sign,
+															bId, point);
 			}
 		};
 		addContact(cC.cId.r1Index, cC.cId.r1BodyId, 1., cC.X_b1_cf);
@@ -183,7 +203,17 @@ void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	}
 	updateNrEq();
 
-	A_.setZero(cont_.size()*6, data.nrVars());
+	// only the alphaD of robots in contact are used
+	colBlocks_.clear();
+	for(const ContactData& c: cont_)
+	{
+		for(const ContactSideData& csd: c.contacts)
+		{
+			addColBlock(colBlocks_, csd.alphaDBegin, mbs[csd.robotIndex].nrDof());
+		}
+	}
+
+	A_.setZero(cont_.size()*6, data.maxNrVars());
 	b_.setZero(cont_.size()*6);
 }
 
@@ -226,6 +256,12 @@ const Eigen::VectorXd& ContactConstr::bEq() const
 }
 
 
+const std::vector<ColBlock>& ContactConstr::AEqBlocks() const
+{
+	return colBlocks_;
+}
+
+
 void ContactConstr::updateNrEq()
 {
 	nrEq_ = 0;
@@ -236,6 +272,30 @@ void ContactConstr::updateNrEq()
 }
 
 
+void ContactConstr::addContactJacobian(const SolverData& data,
+	const ContactData& cd, const ContactSideData& csd, int index)
+{
+	const int rows = int(cd.dof.rows());
+	const int dof = csd.jac.dof();
+
+	// the jacobian in the p frame is X_b_p*J_b
+	const Eigen::MatrixXd& bodyJac = data.bodyJacobian(csd.bodyJacIndex).bodyJac();
+	frameJac_.block(0, 0, 6, dof).noalias() = csd.X_b_p.matrix()*bodyJac;
+	dofJac_.block(0, 0, rows, dof).noalias() =
+		csd.sign*cd.dof*frameJac_.block(0, 0, 6, dof);
+
+	// jacobian columns are written on the body path dof only
+	// (rbd::Jacobian::fullJacobian resize its result for each robot)
+	int jacCol = 0;
+	for(const ColBlock& pb: csd.pathBlocks)
+	{
+		A_.block(index, csd.alphaDBegin + pb.begin, rows, pb.size) +=
+			dofJac_.block(0, jacCol, rows, pb.size);
+		jacCol += pb.size;
+	}
+}
+
+
 /**
 	*															ContactAccConstr
 	*/
@@ -269,14 +329,7 @@ void ContactAccConstr::update(const std::vector<rbd::MultiBody>& mbs,
 			const rbd::MultiBodyConfig& mbc = mbcs[csd.robotIndex];
 
 			// AEq = J_i
-			sva::PTransformd X_0_p = csd.X_b_p*mbc.bodyPosW[csd.bodyIndex];
-			const MatrixXd& jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-			dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() =
-				csd.sign*cd.dof*jacMat;
-			csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()),
-				fullJac_);
-			A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() +=
-					fullJac_.block(0, 0, rows, mb.nrDof());
+			addContactJacobian(data, cd, csd, index);
 
 			// BEq = -JD_i*alpha
 			Vector6d normalAcc = csd.jac.normalAcceleration(
@@ -329,14 +382,7 @@ void ContactSpeedConstr::update(const std::vector<rbd::MultiBody>& mbs,
 			const rbd::MultiBodyConfig& mbc = mbcs[csd.robotIndex];
 
 			// AEq = J_i
-			sva::PTransformd X_0_p = csd.X_b_p*mbc.bodyPosW[csd.bodyIndex];
-			const MatrixXd& jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-			dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() =
-				csd.sign*cd.dof*jacMat;
-			csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()),
-				fullJac_);
-			A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() +=
-					fullJac_.block(0, 0, rows, mb.nrDof());
+			addContactJacobian(data, cd, csd, index);
 
 			// BEq = -JD_i*alpha
 			Vector6d normalAcc = csd.jac.normalAcceleration(
@@ -392,14 +438,7 @@ void ContactPosConstr::update(const std::vector<rbd::MultiBody>& mbs,
 			const rbd::MultiBodyConfig& mbc = mbcs[csd.robotIndex];
 
 			// AEq = J_i
-			sva::PTransformd X_0_p = csd.X_b_p*mbc.bodyPosW[csd.bodyIndex];
-			const MatrixXd& jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-			dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() =
-				csd.sign*cd.dof*jacMat;
-			csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()),
-				fullJac_);
-			A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() +=
-					fullJac_.block(0, 0, rows, mb.nrDof());
+			addContactJacobian(data, cd, csd, index);
 
 			// BEq = -JD_i*alpha
 			Vector6d normalAcc = csd.jac.normalAcceleration(
@@ -420,7 +459,7 @@ void ContactPosConstr::update(const std::vector<rbd::MultiBody>& mbs,
 		Eigen::Vector6d error;
 		error.head<3>() = sva::rotationVelocity(X_b1cf_b2cf.rotation(), 1e-7);
 		error.tail<3>() = X_b1cf_b2cf.translation();
-		b_.segment(index, rows) += cd.dof*(error/timeStep_);
+		b_.segment(index, rows).noalias() += cd.dof*(error/timeStep_);
 
 		index += rows;
 	}
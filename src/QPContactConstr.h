@@ -17,8 +17,9 @@
 
 // includes
 // std
-#include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 // Eigen
 #include <Eigen/Core>
@@ -96,8 +97,8 @@ protected:
 		const SolverData& data);
 
 protected:
-	std::set<ContactId> virtualContacts_;
-	std::map<ContactId, Eigen::MatrixXd> dofContacts_;
+	std::unordered_set<ContactId> virtualContacts_;
+	std::unordered_map<ContactId, Eigen::MatrixXd> dofContacts_;
 };
 
 
@@ -119,6 +120,8 @@ public:
 	void updateDofContacts();
 
 	// Constraint
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
@@ -130,19 +133,24 @@ public:
 
 	virtual const Eigen::MatrixXd& AEq() const;
 	virtual const Eigen::VectorXd& bEq() const;
+	virtual const std::vector<ColBlock>& AEqBlocks() const;
 
 protected:
 	struct ContactSideData
 	{
-		ContactSideData(int rI, int aDB, double s, const rbd::Jacobian& j,
-			const sva::PTransformd& Xbp):
-			robotIndex(rI), alphaDBegin(aDB), bodyIndex(j.jointsPath().back()),
-			sign(s), jac(j), X_b_p(Xbp)
+		ContactSideData(const rbd::MultiBody& mb, int rI, int aDB, int bJI,
+			double s, int bId, const sva::PTransformd& Xbp):
+			robotIndex(rI), alphaDBegin(aDB), bodyIndex(mb.bodyIndexById(bId)),
+			bodyJacIndex(bJI), sign(s), jac(mb, bId),
+			pathBlocks(jointsColBlocks(mb, jac.jointsPath())), X_b_p(Xbp)
 		{}
 
 		int robotIndex, alphaDBegin, bodyIndex;
+		int bodyJacIndex; ///< SolverData::bodyJacobian index
 		double sign;
 		rbd::Jacobian jac;
+		/// robot dof of the jacobian columns
+		std::vector<ColBlock> pathBlocks;
 		sva::PTransformd X_b_p;
 	};
 
@@ -170,14 +178,18 @@ protected:
 
 protected:
 	void updateNrEq();
+	/// Add the csd side jacobian of the contact cd to A_ rows from index.
+	void addContactJacobian(const SolverData& data, const ContactData& cd,
+		const ContactSideData& csd, int index);
 
 protected:
 	std::vector<ContactData> cont_;
 
-	Eigen::MatrixXd fullJac_, dofJac_;
+	Eigen::MatrixXd frameJac_, dofJac_;
 
 	Eigen::MatrixXd A_;
 	Eigen::VectorXd b_;
+	std::vector<ColBlock> colBlocks_;
 
 	int nrEq_, totalAlphaD_;
 	double timeStep_;
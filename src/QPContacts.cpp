@@ -18,12 +18,14 @@
 
 // includes
 // std
+#include <cmath>
 #include <stdexcept>
 
 // Eigen
 #include <Eigen/Geometry>
 
 //boost
+#include <boost/functional/hash.hpp>
 #include <boost/math/constants/constants.hpp>
 
 
@@ -73,6 +75,48 @@ FrictionCone::FrictionCone(const Eigen::Matrix3d& frame, int nrGen, double mu,
 
 
 
+/**
+	*													WrenchCone
+	*/
+
+
+
+WrenchCone::WrenchCone(const sva::PTransformd& Xbs, double X, double Y,
+	double mu, double dir):
+	X_b_s(Xbs),
+	wrenches(dir*Xbs.matrix().transpose()),
+	faces(16, 6)
+{
+	// corners friction pyramid inscribed in the friction cone
+	double m = mu/std::sqrt(2.);
+
+	// wrench is (tau_x, tau_y, tau_z, f_x, f_y, f_z)
+	// |f_x| <= m f_z, |f_y| <= m f_z
+	faces.row(0) << 0., 0., 0., -1., 0., m;
+	faces.row(1) << 0., 0., 0., 1., 0., m;
+	faces.row(2) << 0., 0., 0., 0., -1., m;
+	faces.row(3) << 0., 0., 0., 0., 1., m;
+	// center of pressure in the surface: |tau_x| <= Y f_z, |tau_y| <= X f_z
+	faces.row(4) << -1., 0., 0., 0., 0., Y;
+	faces.row(5) << 1., 0., 0., 0., 0., Y;
+	faces.row(6) << 0., -1., 0., 0., 0., X;
+	faces.row(7) << 0., 1., 0., 0., 0., X;
+	// yaw torque bounds
+	// tau_min = -m(X + Y) f_z + |Y f_x - m tau_x| + |X f_y - m tau_y|
+	// tau_max = m(X + Y) f_z - |Y f_x + m tau_x| - |X f_y + m tau_y|
+	int row = 8;
+	for(double s1: {-1., 1.})
+	{
+		for(double s2: {-1., 1.})
+		{
+			faces.row(row++) << s1*m, s2*m, 1., -s1*Y, -s2*X, m*(X + Y);
+			faces.row(row++) << -s1*m, -s2*m, -1., -s1*Y, -s2*X, m*(X + Y);
+		}
+	}
+}
+
+
+
 /**
 	*													ContactId
 	*/
@@ -126,6 +170,41 @@ bool ContactId::operator<(const ContactId& cId) const
 
 
 
+/**
+	* Compute the wrench cones of the rectangle that bound the points
+	* in the frame tangent plane.
+	*/
+void boundingWrenchCones(const std::vector<Eigen::Vector3d>& r1Points,
+	const Eigen::Matrix3d& frame, const sva::PTransformd& X_b1_b2, double mu,
+	WrenchCone& r1WrenchCone, WrenchCone& r2WrenchCone)
+{
+	Eigen::Vector3d sMin(Eigen::Vector3d::Zero()), sMax(Eigen::Vector3d::Zero());
+	Eigen::Vector3d sCenter(Eigen::Vector3d::Zero());
+	if(!r1Points.empty())
+	{
+		sMin = frame*r1Points[0];
+		sMax = sMin;
+		for(const Eigen::Vector3d& p: r1Points)
+		{
+			Eigen::Vector3d p_s(frame*p);
+			sMin = sMin.cwiseMin(p_s);
+			sMax = sMax.cwiseMax(p_s);
+			sCenter += p_s;
+		}
+		sCenter /= double(r1Points.size());
+	}
+	// the surface is at the points mean height along the normal
+	sCenter.head<2>() = (sMin.head<2>() + sMax.head<2>())/2.;
+	Eigen::Vector2d half((sMax.head<2>() - sMin.head<2>())/2.);
+
+	sva::PTransformd X_b1_s(frame, frame.transpose()*sCenter);
+	r1WrenchCone = WrenchCone(X_b1_s, half.x(), half.y(), mu);
+	// the wrench applied on b2 is opposed
+	r2WrenchCone = WrenchCone(X_b1_s*X_b1_b2.inv(), half.x(), half.y(), mu, -1.);
+}
+
+
+
 /**
 	*													UnilateralContact
 	*/
@@ -144,8 +223,11 @@ UnilateralContact::UnilateralContact(int r1I, int r2I,
 	r2Points(),
 	r1Cone(r1Frame, nrGen, mu),
 	r2Cone(),
+	r1WrenchCone(),
+	r2WrenchCone(),
 	X_b1_b2(Xbb),
-	X_b1_cf(Xbcf)
+	X_b1_cf(Xbcf),
+	model(ContactModel::Generators)
 {
 	construct(r1Frame, nrGen, mu);
 }
@@ -163,8 +245,11 @@ UnilateralContact::UnilateralContact(int r1I, int r2I,
 	r2Points(),
 	r1Cone(r1Frame, nrGen, mu),
 	r2Cone(),
+	r1WrenchCone(),
+	r2WrenchCone(),
 	X_b1_b2(Xbb),
-	X_b1_cf(Xbcf)
+	X_b1_cf(Xbcf),
+	model(ContactModel::Generators)
 {
 	construct(r1Frame, nrGen, mu);
 }
@@ -181,8 +266,11 @@ UnilateralContact::UnilateralContact(const ContactId& cId,
 	r2Points(),
 	r1Cone(r1Frame, nrGen, mu),
 	r2Cone(),
+	r1WrenchCone(),
+	r2WrenchCone(),
 	X_b1_b2(Xbb),
-	X_b1_cf(Xbcf)
+	X_b1_cf(Xbcf),
+	model(ContactModel::Generators)
 {
 	construct(r1Frame, nrGen, mu);
 }
@@ -244,8 +332,20 @@ int UnilateralContact::nrLambda(int /* point */) const
 }
 
 
+sva::ForceVecd UnilateralContact::wrench(const Eigen::VectorXd& lambda,
+	const WrenchCone& wc) const
+{
+	return sva::ForceVecd(wc.wrenches*lambda.head<6>());
+}
+
+
 int UnilateralContact::nrLambda() const
 {
+	if(model == ContactModel::Wrench)
+	{
+		return 6;
+	}
+
 	int totalLambda = 0;
 	for(int i = 0; i < int(r1Points.size()); ++i)
 	{
@@ -330,6 +430,9 @@ void UnilateralContact::construct(const Eigen::MatrixXd& r1Frame, int nrGen, dou
 	// create the b2 cone
 	// We take the oppostie frame because force are opposed
 	r2Cone = FrictionCone(-r2Frame, nrGen, mu, -1.);
+
+	boundingWrenchCones(r1Points, r1Frame, X_b1_b2, mu, r1WrenchCone,
+		r2WrenchCone);
 }
 
 
@@ -352,8 +455,11 @@ BilateralContact::BilateralContact(int r1I, int r2I,
 	r2Points(),
 	r1Cones(r1Points.size()),
 	r2Cones(r1Points.size()),
+	r1WrenchCone(),
+	r2WrenchCone(),
 	X_b1_b2(Xbb),
-	X_b1_cf(Xbcf)
+	X_b1_cf(Xbcf),
+	model(ContactModel::Generators)
 {
 	construct(r1Frames, nrGen, mu);
 }
@@ -371,8 +477,11 @@ BilateralContact::BilateralContact(int r1I, int r2I,
 	r2Points(),
 	r1Cones(r1Points.size()),
 	r2Cones(r1Points.size()),
+	r1WrenchCone(),
+	r2WrenchCone(),
 	X_b1_b2(Xbb),
-	X_b1_cf(Xbcf)
+	X_b1_cf(Xbcf),
+	model(ContactModel::Generators)
 {
 	construct(r1Frames, nrGen, mu);
 }
@@ -389,8 +498,11 @@ BilateralContact::BilateralContact(const ContactId& cId,
 	r2Points(),
 	r1Cones(r1Points.size()),
 	r2Cones(r1Points.size()),
+	r1WrenchCone(),
+	r2WrenchCone(),
 	X_b1_b2(Xbb),
-	X_b1_cf(Xbcf)
+	X_b1_cf(Xbcf),
+	model(ContactModel::Generators)
 {
 	construct(r1Frames, nrGen, mu);
 }
@@ -402,8 +514,11 @@ BilateralContact::BilateralContact(const UnilateralContact& c):
 	r2Points(c.r2Points),
 	r1Cones(c.r1Points.size(), c.r1Cone),
 	r2Cones(c.r1Points.size(), c.r2Cone),
+	r1WrenchCone(c.r1WrenchCone),
+	r2WrenchCone(c.r2WrenchCone),
 	X_b1_b2(c.X_b1_b2),
-	X_b1_cf(c.X_b1_cf)
+	X_b1_cf(c.X_b1_cf),
+	model(c.model)
 { }
 
 
@@ -463,8 +578,20 @@ int BilateralContact::nrLambda(int point) const
 }
 
 
+sva::ForceVecd BilateralContact::wrench(const Eigen::VectorXd& lambda,
+	const WrenchCone& wc) const
+{
+	return sva::ForceVecd(wc.wrenches*lambda.head<6>());
+}
+
+
 int BilateralContact::nrLambda() const
 {
+	if(model == ContactModel::Wrench)
+	{
+		return 6;
+	}
+
 	int totalLambda = 0;
 	for(int i = 0; i < int(r1Points.size()); ++i)
 	{
@@ -552,9 +679,34 @@ void BilateralContact::construct(const std::vector<Eigen::Matrix3d>& r1Frames,
 		// We take the oppostie frame because force are opposed
 		r2Cones[i] = FrictionCone(-X_b2_p.rotation(), nrGen, mu, -1.);
 	}
+
+	// the wrench cone surface is in the first friction cone tangent plane
+	if(!r1Frames.empty())
+	{
+		boundingWrenchCones(r1Points, r1Frames.front(), X_b1_b2, mu,
+			r1WrenchCone, r2WrenchCone);
+	}
 }
 
 
 } // namespace qp
 
 } // namespace tasks
+
+
+namespace std
+{
+
+std::size_t hash<tasks::qp::ContactId>::operator()(
+	const tasks::qp::ContactId& cId) const
+{
+	std::size_t seed = 0;
+	boost::hash_combine(seed, cId.r1Index);
+	boost::hash_combine(seed, cId.r2Index);
+	boost::hash_combine(seed, cId.r1BodyId);
+	boost::hash_combine(seed, cId.r2BodyId);
+	boost::hash_combine(seed, cId.ambiguityId);
+	return seed;
+}
+
+} // namespace std
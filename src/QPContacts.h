@@ -17,6 +17,7 @@
 
 // include
 // std
+#include <functional>
 #include <vector>
 
 // Eigen
@@ -57,6 +58,58 @@ struct FrictionCone
 
 
 
+/**
+	* Linearized contact wrench cone of a rectangular contact surface.
+	* The 6D wrench \f$ w = (\tau, f) \f$ is expressed at the surface center
+	* in the surface frame and is in the cone if \f$ F w \geq 0 \f$.
+	* Each surface corner friction cone is approximated by the four sided
+	* pyramid inscribed in it.
+	* @see Caron, Pham and Nakamura, "Stability of surface contacts for humanoid
+	* robots: Closed-form formulae of the Contact Wrench Cone for rectangular
+	* support areas", ICRA 2015.
+	*/
+struct WrenchCone
+{
+	WrenchCone(){}
+
+	/**
+		* @param X_b_s Surface frame in body coordinate. The surface normal is
+		* the frame Z axis.
+		* @param halfLength Half length of the surface along the X axis.
+		* @param halfWidth Half width of the surface along the Y axis.
+		* @param mu Coefficient of friction.
+		* @param direction Wrench direction (-1. if the wrench is applied by the body).
+		*/
+	WrenchCone(const sva::PTransformd& X_b_s, double halfLength,
+		double halfWidth, double mu, double direction=1.);
+
+	/// Surface frame in body coordinate.
+	sva::PTransformd X_b_s;
+	/// Wrench applied at the body origin in body coordinate by each lambda.
+	Eigen::MatrixXd wrenches;
+	/// Cone faces F.
+	Eigen::MatrixXd faces;
+};
+
+
+
+/**
+	* Model of the contact forces.
+	*/
+enum class ContactModel
+{
+	/// One lambda by friction cone generator of each contact point.
+	Generators,
+	/**
+		* Six lambda, the wrench applied at the contact surface center
+		* in the surface frame (@see WrenchCone). The wrench is constrained
+		* by WrenchConeConstr instead of PositiveLambda.
+		*/
+	Wrench
+};
+
+
+
 /**
 	* Unique identifier for a contact.
 	*/
@@ -92,7 +145,9 @@ struct ContactId
 	*/
 struct UnilateralContact
 {
-	UnilateralContact(){}
+	UnilateralContact():
+		model(ContactModel::Generators)
+	{}
 
 	/**
 		* @param r1Index First robot imply in the contact.
@@ -174,9 +229,20 @@ struct UnilateralContact
 		const std::vector<Eigen::Vector3d>& r_b_pi,
 		const FrictionCone& c_pi_b) const;
 
+	/**
+	 * Compute the wrench applied on the body origin in the body frame
+	 * by a contact using the ContactModel::Wrench model.
+	 * @param lambda Contact surface wrench.
+	 * @param wc Wrench cone of the body (r1WrenchCone or r2WrenchCone).
+	 * @return F_b, the 6D force applied on the body origin at the body frame.
+	 */
+	sva::ForceVecd wrench(const Eigen::VectorXd& lambda,
+		const WrenchCone& wc) const;
+
 	/// @return Number of lambda needed to compute the force vector of the contact point.
 	int nrLambda(int point) const;
-	/// @return Number of lambda needed to compute the force vector.
+	/// @return Number of lambda needed to compute the force vector
+	/// (6 with the ContactModel::Wrench model).
 	int nrLambda() const;
 
 	/**
@@ -210,8 +276,15 @@ struct UnilateralContact
 	ContactId contactId;
 	std::vector<Eigen::Vector3d> r1Points, r2Points;
 	FrictionCone r1Cone, r2Cone;
+	/**
+		* Wrench cones of the rectangle that bound the contact points in the
+		* r1Frame tangent plane, only used by the ContactModel::Wrench model.
+		*/
+	WrenchCone r1WrenchCone, r2WrenchCone;
 	sva::PTransformd X_b1_b2;
 	sva::PTransformd X_b1_cf;
+	/// Contact forces model, ContactModel::Generators by default.
+	ContactModel model;
 
 private:
 	void construct(const Eigen::MatrixXd& r1Frame, int nrGen, double mu);
@@ -225,7 +298,9 @@ private:
 	*/
 struct BilateralContact
 {
-	BilateralContact(){}
+	BilateralContact():
+		model(ContactModel::Generators)
+	{}
 
 	/**
 		* @param r1Index First robot imply in the contact.
@@ -314,9 +389,14 @@ struct BilateralContact
 		const std::vector<Eigen::Vector3d>& r_b_pi,
 		const std::vector<FrictionCone>& c_pi_b) const;
 
+	/// @see UnilateralContact::wrench
+	sva::ForceVecd wrench(const Eigen::VectorXd& lambda,
+		const WrenchCone& wc) const;
+
 	/// @return Number of lambda needed to compute the force vector of the contact point.
 	int nrLambda(int point) const;
-	/// @return Number of lambda needed to compute the force vector.
+	/// @return Number of lambda needed to compute the force vector
+	/// (6 with the ContactModel::Wrench model).
 	int nrLambda() const;
 
 	/**
@@ -350,8 +430,16 @@ struct BilateralContact
 	ContactId contactId;
 	std::vector<Eigen::Vector3d> r1Points, r2Points;
 	std::vector<FrictionCone> r1Cones, r2Cones;
+	/**
+		* Wrench cones of the rectangle that bound the contact points in the
+		* first r1Frames tangent plane, only used by the ContactModel::Wrench
+		* model. Left empty by the default constructor.
+		*/
+	WrenchCone r1WrenchCone, r2WrenchCone;
 	sva::PTransformd X_b1_b2;
 	sva::PTransformd X_b1_cf;
+	/// Contact forces model, ContactModel::Generators by default.
+	ContactModel model;
 
 private:
 	void construct(const std::vector<Eigen::Matrix3d>& r1Frames, int nrGen, double mu);
@@ -361,3 +449,16 @@ private:
 } // namespace qp
 
 } // namespace tasks
+
+
+namespace std
+{
+
+/// Allow to use ContactId as std::unordered_map and std::unordered_set key.
+template<>
+struct hash<tasks::qp::ContactId>
+{
+	std::size_t operator()(const tasks::qp::ContactId& cId) const;
+};
+
+} // namespace std
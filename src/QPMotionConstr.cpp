@@ -17,6 +17,9 @@
 #include "QPMotionConstr.h"
 
 // includes
+// std
+#include <algorithm>
+
 // Eigen
 #include <unsupported/Eigen/Polynomials>
 
@@ -43,17 +46,29 @@ PositiveLambda::PositiveLambda():
 	lambdaBegin_(-1),
 	XL_(),
 	XU_(),
+	version_(newVersion()),
 	cont_()
 { }
 
 
+void PositiveLambda::registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+	SolverData& data)
+{
+	// a bound is added on each contact lambda
+	data.dependOnContacts();
+}
+
+
 void PositiveLambda::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
 	lambdaBegin_ = data.lambdaBegin();
 
-	XL_.setConstant(data.totalLambda(), 0.);
-	XU_.setConstant(data.totalLambda(), std::numeric_limits<double>::infinity());
+	// the bound cover the lambda capacity so a contact change don't resize it,
+	// the QP solvers ignore the bounds after SolverData::nrVars
+	int nrLambda = data.maxNrVars() - lambdaBegin_;
+	XL_.setConstant(nrLambda, 0.);
+	XU_.setConstant(nrLambda, std::numeric_limits<double>::infinity());
 
 	cont_.clear();
 	const std::vector<BilateralContact>& allC = data.allContacts();
@@ -62,7 +77,14 @@ void PositiveLambda::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 		cont_.push_back({allC[i].contactId,
 										data.lambdaBegin(int(i)),
 										allC[i].nrLambda()});
+		// wrench lambda are constrained by WrenchConeConstr
+		if(allC[i].model == ContactModel::Wrench)
+		{
+			XL_.segment(data.lambdaBegin(int(i)) - lambdaBegin_, allC[i].nrLambda()).
+				setConstant(-std::numeric_limits<double>::infinity());
+		}
 	}
+	version_ = newVersion();
 }
 
 
@@ -119,58 +141,248 @@ const Eigen::VectorXd& PositiveLambda::Upper() const
 }
 
 
+int PositiveLambda::versionBound() const
+{
+	return version_;
+}
+
+
+/**
+	*															WrenchConeConstr
+	*/
+
+
+WrenchConeConstr::WrenchConeConstr():
+	AInEq_(),
+	bInEq_(),
+	colBlocks_(),
+	version_(newVersion()),
+	cont_()
+{ }
+
+
+void WrenchConeConstr::registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+	SolverData& data)
+{
+	// a cone is added on each wrench contact
+	data.dependOnContacts();
+}
+
+
+void WrenchConeConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
+	const SolverData& data)
+{
+	cont_.clear();
+	int nrLines = 0;
+	const std::vector<BilateralContact>& allC = data.allContacts();
+	for(const BilateralContact& c: allC)
+	{
+		if(c.model == ContactModel::Wrench)
+		{
+			int cLines = int(c.r1WrenchCone.faces.rows());
+			cont_.push_back({c.contactId, nrLines, cLines});
+			nrLines += cLines;
+		}
+	}
+
+	// the wrench cone is constant in the lambda frame
+	AInEq_.setZero(nrLines, data.maxNrVars());
+	bInEq_.setZero(nrLines);
+	colBlocks_.clear();
+	int line = 0;
+	for(std::size_t i = 0; i < allC.size(); ++i)
+	{
+		const BilateralContact& c = allC[i];
+		if(c.model == ContactModel::Wrench)
+		{
+			const Eigen::MatrixXd& faces = c.r1WrenchCone.faces;
+			int col = data.lambdaBegin(int(i));
+			AInEq_.block(line, col, faces.rows(), faces.cols()) = -faces;
+			addColBlock(colBlocks_, col, int(faces.cols()));
+			line += int(faces.rows());
+		}
+	}
+	version_ = newVersion();
+}
+
+
+void WrenchConeConstr::update(const std::vector<rbd::MultiBody>& /* mbs */,
+	const std::vector<rbd::MultiBodyConfig>& /* mbc */,
+	const SolverData& /* data */)
+{ }
+
+
+std::string WrenchConeConstr::nameInEq() const
+{
+	return "WrenchConeConstr";
+}
+
+
+std::string WrenchConeConstr::descInEq(const std::vector<rbd::MultiBody>& mbs,
+	int line)
+{
+	std::ostringstream oss;
+
+	for(const ContactData& cd: cont_)
+	{
+		if(line >= cd.line && line < cd.line + cd.nrLines)
+		{
+			const rbd::MultiBody& mb1 = mbs[cd.cId.r1Index];
+			const rbd::MultiBody& mb2 = mbs[cd.cId.r2Index];
+			oss << "Body 1: " << mb1.body(mb1.bodyIndexById(cd.cId.r1BodyId)).name() << std::endl;
+			oss << "Body 2: " << mb2.body(mb2.bodyIndexById(cd.cId.r2BodyId)).name() << std::endl;
+			oss << "face: " << line - cd.line << std::endl;
+			break;
+		}
+	}
+
+	return oss.str();
+}
+
+
+int WrenchConeConstr::maxInEq() const
+{
+	return int(AInEq_.rows());
+}
+
+
+const Eigen::MatrixXd& WrenchConeConstr::AInEq() const
+{
+	return AInEq_;
+}
+
+
+const Eigen::VectorXd& WrenchConeConstr::bInEq() const
+{
+	return bInEq_;
+}
+
+
+const std::vector<ColBlock>& WrenchConeConstr::AInEqBlocks() const
+{
+	return colBlocks_;
+}
+
+
+int WrenchConeConstr::versionInEq() const
+{
+	return version_;
+}
+
+
 /**
 	*															MotionConstrCommon
 	*/
 
 
-MotionConstrCommon::ContactData::ContactData(const rbd::MultiBody& mb,
-	int bId, int lB,
-	std::vector<Eigen::Vector3d> pts,
-	const std::vector<FrictionCone>& cones):
-	bodyIndex(),
-	lambdaBegin(lB),
-	jac(mb, bId),
-	points(std::move(pts)),
-	minusGenerators(cones.size())
+std::vector<MotionConstrCommon::HBlock>
+MotionConstrCommon::computeHBlocks(const rbd::MultiBody& mb)
+{
+	std::vector<HBlock> blocks(mb.nrJoints());
+	for(int i = 0; i < mb.nrJoints(); ++i)
+	{
+		int pos = mb.jointPosInDof(i), dof = mb.joint(i).dof();
+		blocks[i].rows = ColBlock(pos, dof);
+		addColBlock(blocks[i].cols, pos, dof);
+		// the joint is on the branch of all its ancestors
+		for(int a = mb.parent(i); a != -1; a = mb.parent(a))
+		{
+			addColBlock(blocks[i].cols, mb.jointPosInDof(a), mb.joint(a).dof());
+			addColBlock(blocks[a].cols, pos, dof);
+		}
+	}
+
+	blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+		[](const HBlock& b) { return b.rows.size == 0; }),
+		blocks.end());
+	return blocks;
+}
+
+
+void MotionConstrCommon::ContactData::set(const rbd::MultiBody& mb,
+	const SolverData& data, int lB, int bJI,
+	const std::vector<Eigen::Vector3d>& points,
+	const std::vector<FrictionCone>& cones)
 {
-	bodyIndex = jac.jointsPath().back();
+	lambdaBegin = lB;
+	bodyJacIndex = bJI;
+	jointsColBlocks(mb, data.bodyJacobian(bodyJacIndex).jac().jointsPath(),
+		pathBlocks);
+	sharedLambda = false;
+
+	int nrLambda = 0;
+	for(const FrictionCone& fc: cones)
+	{
+		nrLambda += int(fc.generators.size());
+	}
+
+	// the jacobian at point p is J_p = J_v + J_w x p
+	// so J_p^T g = J_v^T g + J_w^T (p x g, g)
+	minusGenWrenches.resize(6, nrLambda);
+	int col = 0;
 	for(std::size_t i = 0; i < cones.size(); ++i)
 	{
-		minusGenerators[i].resize(3, cones[i].generators.size());
-		for(std::size_t j = 0; j < cones[i].generators.size(); ++j)
+		for(const Eigen::Vector3d& g: cones[i].generators)
 		{
-			minusGenerators[i].col(j) = -cones[i].generators[j];
+			minusGenWrenches.col(col).head<3>() = points[i].cross(-g);
+			minusGenWrenches.col(col).tail<3>() = -g;
+			++col;
 		}
 	}
 }
 
 
+void MotionConstrCommon::ContactData::set(const rbd::MultiBody& mb,
+	const SolverData& data, int lB, int bJI, const WrenchCone& wc)
+{
+	lambdaBegin = lB;
+	bodyJacIndex = bJI;
+	jointsColBlocks(mb, data.bodyJacobian(bodyJacIndex).jac().jointsPath(),
+		pathBlocks);
+	sharedLambda = false;
+
+	minusGenWrenches.resize(int(wc.wrenches.rows()), int(wc.wrenches.cols()));
+	minusGenWrenches = -wc.wrenches;
+}
+
+
 MotionConstrCommon::MotionConstrCommon(const std::vector<rbd::MultiBody>& mbs,
 	int robotIndex):
 	robotIndex_(robotIndex),
 	alphaDBegin_(-1),
 	nrDof_(mbs[robotIndex_].nrDof()),
 	lambdaBegin_(-1),
-	fd_(mbs[robotIndex_]),
-	fullJacLambda_(),
-	jacTrans_(6, nrDof_),
-	jacLambda_(),
+	hBlocks_(computeHBlocks(mbs[robotIndex_])),
+	robotDynIndex_(-1),
+	C_(Eigen::VectorXd::Zero(nrDof_)),
 	cont_(),
+	nrCont_(0),
 	curTorque_(nrDof_),
 	A_(),
 	AL_(nrDof_),
-	AU_(nrDof_)
+	AU_(nrDof_),
+	colBlocks_()
 {
 	assert(std::size_t(robotIndex_) < mbs.size() && robotIndex_ >= 0);
 }
 
 
-void MotionConstrCommon::computeTorque(const Eigen::VectorXd& alphaD, const Eigen::VectorXd& lambda)
+void MotionConstrCommon::computeTorque(const Eigen::Ref<const Eigen::VectorXd>& alphaD,
+	const Eigen::Ref<const Eigen::VectorXd>& lambda)
 {
-	curTorque_ = fd_.H()*alphaD.segment(alphaDBegin_, nrDof_);
-	curTorque_ += fd_.C();
-	curTorque_ += A_.block(0, lambdaBegin_, nrDof_, A_.cols() - lambdaBegin_)*lambda;
+	// A_ inertia matrix part is H
+	curTorque_ = C_;
+	for(const HBlock& hb: hBlocks_)
+	{
+		for(const ColBlock& cb: hb.cols)
+		{
+			curTorque_.segment(hb.rows.begin, hb.rows.size).noalias() +=
+				A_.block(hb.rows.begin, alphaDBegin_ + cb.begin, hb.rows.size, cb.size)*
+				alphaD.segment(alphaDBegin_ + cb.begin, cb.size);
+		}
+	}
+	curTorque_.noalias() +=
+		A_.block(0, lambdaBegin_, nrDof_, lambda.size())*lambda;
 }
 
 
@@ -198,6 +410,25 @@ void MotionConstrCommon::torque(const std::vector<rbd::MultiBody>& mbs,
 }
 
 
+void MotionConstrCommon::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	data.dependOnContacts();
+	data.addRobotDynamics(mbs, robotIndex_);
+	for(const BilateralContact& c: data.allContacts())
+	{
+		if(robotIndex_ == c.contactId.r1Index)
+		{
+			data.addBodyJacobian(mbs, robotIndex_, c.contactId.r1BodyId);
+		}
+		if(robotIndex_ == c.contactId.r2Index)
+		{
+			data.addBodyJacobian(mbs, robotIndex_, c.contactId.r2BodyId);
+		}
+	}
+}
+
+
 void MotionConstrCommon::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	const SolverData& data)
 {
@@ -205,80 +436,131 @@ void MotionConstrCommon::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 
 	alphaDBegin_ = data.alphaDBegin(robotIndex_);
 	lambdaBegin_ = data.lambdaBegin();
+	robotDynIndex_ = data.robotDynamicsIndex(robotIndex_);
 
-	cont_.clear();
+	// each contact lambda is used at most twice (self contact), contact data
+	// are preallocated for the lambda capacity and filled in place
 	const auto& cCont = data.allContacts();
+	cont_.reserve(std::max(std::size_t(data.maxNrVars() - data.lambdaBegin()),
+		2*cCont.size()));
+	nrCont_ = 0;
+	auto nextContact = [this]() -> ContactData&
+	{
+		if(nrCont_ == int(cont_.size()))
+		{
+			cont_.emplace_back();
+		}
+		return cont_[nrCont_++];
+	};
+
 	for(std::size_t i = 0; i < cCont.size(); ++i)
 	{
 		const BilateralContact& c = cCont[i];
+		bool wrench = c.model == ContactModel::Wrench;
 		if(robotIndex_ == c.contactId.r1Index)
 		{
-			cont_.emplace_back(mb, c.contactId.r1BodyId, data.lambdaBegin(int(i)),
-				c.r1Points, c.r1Cones);
+			int bodyJacIndex = data.bodyJacobianIndex(mbs, robotIndex_, c.contactId.r1BodyId);
+			if(wrench)
+			{
+				nextContact().set(mb, data, data.lambdaBegin(int(i)), bodyJacIndex,
+					c.r1WrenchCone);
+			}
+			else
+			{
+				nextContact().set(mb, data, data.lambdaBegin(int(i)), bodyJacIndex,
+					c.r1Points, c.r1Cones);
+			}
 		}
 		// we don't use else to manage self contact on the robot
 		if(robotIndex_ == c.contactId.r2Index)
 		{
-			cont_.emplace_back(mb, c.contactId.r2BodyId, data.lambdaBegin(int(i)),
-				c.r2Points, c.r2Cones);
+			int bodyJacIndex = data.bodyJacobianIndex(mbs, robotIndex_, c.contactId.r2BodyId);
+			if(wrench)
+			{
+				nextContact().set(mb, data, data.lambdaBegin(int(i)), bodyJacIndex,
+					c.r2WrenchCone);
+			}
+			else
+			{
+				nextContact().set(mb, data, data.lambdaBegin(int(i)), bodyJacIndex,
+					c.r2Points, c.r2Cones);
+			}
 		}
 	}
 
-	/// @todo don't use nrDof and totalLamdba but max dof of a jacobian
-	/// and max lambda of a contact.
-	A_.setZero(nrDof_, data.nrVars());
-	jacLambda_.resize(data.totalLambda(), nrDof_);
-	fullJacLambda_.resize(data.totalLambda(), nrDof_);
+	// inertia matrix columns and lambda of contacts on this robot
+	colBlocks_.clear();
+	addColBlock(colBlocks_, alphaDBegin_, nrDof_);
+	for(int i = 0; i < nrCont_; ++i)
+	{
+		ContactData& cd = cont_[i];
+		addColBlock(colBlocks_, cd.lambdaBegin, int(cd.minusGenWrenches.cols()));
+		cd.sharedLambda = i > 0 && cont_[i - 1].lambdaBegin == cd.lambdaBegin;
+	}
+
+	A_.setZero(nrDof_, data.maxNrVars());
 }
 
 
-void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody>& mbs,
-	const std::vector<rbd::MultiBodyConfig>& mbcs)
+void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody>& /* mbs */,
+	const std::vector<rbd::MultiBodyConfig>& /* mbcs */, const SolverData& data)
 {
 	using namespace Eigen;
 
-	const rbd::MultiBody& mb = mbs[robotIndex_];
-	const rbd::MultiBodyConfig& mbc = mbcs[robotIndex_];
-
-	fd_.computeH(mb, mbc);
-	fd_.computeC(mb, mbc);
+	const RobotDynamics& rd = data.robotDynamics(robotDynIndex_);
 
 	// tauMin -C <= H*alphaD - J^t G lambda <= tauMax - C
 
-	// fill inertia matrix part
-	A_.block(0, alphaDBegin_, nrDof_, nrDof_) = fd_.H();
+	// fill inertia matrix part, other H coefficients are always zero
+	const MatrixXd& H = rd.H();
+	for(const HBlock& hb: hBlocks_)
+	{
+		for(const ColBlock& cb: hb.cols)
+		{
+			A_.block(hb.rows.begin, alphaDBegin_ + cb.begin, hb.rows.size, cb.size) =
+				H.block(hb.rows.begin, cb.begin, hb.rows.size, cb.size);
+		}
+	}
+	C_ = rd.C();
+
+	// self contact lambda columns are the sum of both bodies J^T W,
+	// the bodies path can differ so the columns are reset first
+	for(int i = 0; i < nrCont_; ++i)
+	{
+		const ContactData& cd = cont_[i];
+		if(cd.sharedLambda)
+		{
+			A_.block(0, cd.lambdaBegin, nrDof_, cd.minusGenWrenches.cols()).setZero();
+		}
+	}
 
-	for(std::size_t i = 0; i < cont_.size(); ++i)
+	for(int i = 0; i < nrCont_; ++i)
 	{
-		const MatrixXd& jac = cont_[i].jac.bodyJacobian(mb, mbc);
+		const ContactData& cd = cont_[i];
+		const MatrixXd& jac = data.bodyJacobian(cd.bodyJacIndex).bodyJac();
+		const int nrLambda = int(cd.minusGenWrenches.cols());
 
-		ContactData& cd = cont_[i];
-		int lambdaOffset = 0;
-		for(std::size_t j = 0; j < cd.points.size(); ++j)
+		// lambda columns are J^T W on the body path dof, other lines stay zero
+		int jacCol = 0;
+		for(const ColBlock& pb: cd.pathBlocks)
 		{
-			int nrLambda = int(cd.minusGenerators[j].cols());
-			// we translate the jacobian to the contact point
-			// then we compute the jacobian against lambda J_l = J^T C
-			// to apply fullJacobian on it we must have robot dof on the column so
-			// J_l^T = (J^T C)^T = C^T J
-			cd.jac.translateBodyJacobian(jac, mbc, cd.points[j], jacTrans_);
-			jacLambda_.block(0, 0, nrLambda, cd.jac.dof()).noalias() =
-				(cd.minusGenerators[j].transpose()*jacTrans_.block(3, 0, 3, cd.jac.dof()));
-
-			cd.jac.fullJacobian(mb,
-				jacLambda_.block(0, 0, nrLambda, cd.jac.dof()),
-				fullJacLambda_);
-
-			A_.block(0, cd.lambdaBegin + lambdaOffset,
-				nrDof_, nrLambda).noalias() =
-					fullJacLambda_.block(0, 0, nrLambda, nrDof_).transpose();
-			lambdaOffset += nrLambda;
+			if(cd.sharedLambda)
+			{
+				A_.block(pb.begin, cd.lambdaBegin, pb.size, nrLambda).noalias() +=
+					jac.block(0, jacCol, 6, pb.size).transpose()*cd.minusGenWrenches;
+			}
+			else
+			{
+				A_.block(pb.begin, cd.lambdaBegin, pb.size, nrLambda).noalias() =
+					jac.block(0, jacCol, 6, pb.size).transpose()*cd.minusGenWrenches;
+			}
+			jacCol += pb.size;
 		}
 	}
 
 	// BEq = -C
-	AL_ = -fd_.C();
-	AU_ = -fd_.C();
+	AL_ = -C_;
+	AU_ = -C_;
 }
 
 
@@ -306,6 +588,12 @@ const Eigen::VectorXd& MotionConstrCommon::UpperGenInEq() const
 }
 
 
+const std::vector<ColBlock>& MotionConstrCommon::AGenInEqBlocks() const
+{
+	return colBlocks_;
+}
+
+
 std::string MotionConstrCommon::nameGenInEq() const
 {
 	return "MotionConstr";
@@ -338,9 +626,9 @@ MotionConstr::MotionConstr(const std::vector<rbd::MultiBody>& mbs,
 
 void MotionConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
-	const SolverData& /* data */)
+	const SolverData& data)
 {
-	computeMatrix(mbs, mbcs);
+	computeMatrix(mbs, mbcs, data);
 
 	AL_.head(torqueL_.rows()) += torqueL_;
 	AU_.head(torqueU_.rows()) += torqueU_;
@@ -370,11 +658,11 @@ MotionSpringConstr::MotionSpringConstr(
 
 void MotionSpringConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
-	const SolverData& /* data */)
+	const SolverData& data)
 {
 	const rbd::MultiBodyConfig& mbc = mbcs[robotIndex_];
 
-	computeMatrix(mbs, mbcs);
+	computeMatrix(mbs, mbcs, data);
 
 	for(const SpringJointData& sj: springs_)
 	{
@@ -416,12 +704,12 @@ MotionPolyConstr::MotionPolyConstr(const std::vector<rbd::MultiBody>& mbs,
 
 void MotionPolyConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
-	const SolverData& /* data */)
+	const SolverData& data)
 {
 	const rbd::MultiBody& mb = mbs[robotIndex_];
 	const rbd::MultiBodyConfig& mbc = mbcs[robotIndex_];
 
-	computeMatrix(mbs, mbcs);
+	computeMatrix(mbs, mbcs, data);
 
 	for(std::size_t i = 0; i < jointIndex_.size(); ++i)
 	{
@@ -23,7 +23,6 @@
 #include <Eigen/Core>
 
 // RBDyn
-#include <RBDyn/FD.h>
 #include <RBDyn/Jacobian.h>
 
 // Tasks
@@ -44,6 +43,8 @@ public:
 	PositiveLambda();
 
 	// Constraint
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
@@ -59,6 +60,7 @@ public:
 
 	virtual const Eigen::VectorXd& Lower() const;
 	virtual const Eigen::VectorXd& Upper() const;
+	virtual int versionBound() const;
 
 private:
 	struct ContactData
@@ -70,28 +72,83 @@ private:
 private:
 	int lambdaBegin_;
 	Eigen::VectorXd XL_, XU_;
+	int version_;
 
 	std::vector<ContactData> cont_; // only usefull for descBound
 };
 
 
+/**
+	* Constraint the lambda of the ContactModel::Wrench contacts to stay
+	* in their linearized contact wrench cone.
+	* \f[
+	* -F w \leq 0
+	* \f]
+	* with \f$ F \f$ the WrenchCone faces and \f$ w \f$ the contact lambda.
+	*/
+class WrenchConeConstr : public ConstraintFunction<Inequality>
+{
+public:
+	WrenchConeConstr();
+
+	// Constraint
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
+	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
+		const SolverData& data);
+	virtual void update(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbc,
+		const SolverData& data);
+
+	// Description
+	virtual std::string nameInEq() const;
+	virtual std::string descInEq(const std::vector<rbd::MultiBody>& mbs, int line);
+
+	// Inequality Constraint
+	virtual int maxInEq() const;
+
+	virtual const Eigen::MatrixXd& AInEq() const;
+	virtual const Eigen::VectorXd& bInEq() const;
+	virtual const std::vector<ColBlock>& AInEqBlocks() const;
+	virtual int versionInEq() const;
+
+private:
+	struct ContactData
+	{
+		ContactId cId;
+		int line, nrLines; // contact lines in AInEq
+	};
+
+private:
+	Eigen::MatrixXd AInEq_;
+	Eigen::VectorXd bInEq_;
+	std::vector<ColBlock> colBlocks_;
+	int version_;
+
+	std::vector<ContactData> cont_; // only usefull for descInEq
+};
+
+
 class MotionConstrCommon : public ConstraintFunction<GenInequality>
 {
 public:
 	MotionConstrCommon(const std::vector<rbd::MultiBody>& mbs, int robotIndex);
 
-	void computeTorque(const Eigen::VectorXd& alphaD,
-		const Eigen::VectorXd& lambda);
+	void computeTorque(const Eigen::Ref<const Eigen::VectorXd>& alphaD,
+		const Eigen::Ref<const Eigen::VectorXd>& lambda);
 	const Eigen::VectorXd& torque() const;
 	void torque(const std::vector<rbd::MultiBody>& mbs,
 		std::vector<rbd::MultiBodyConfig>& mbcs) const;
 
 	// Constraint
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
 	void computeMatrix(const std::vector<rbd::MultiBody>& mb,
-		const std::vector<rbd::MultiBodyConfig>& mbcs);
+		const std::vector<rbd::MultiBodyConfig>& mbcs,
+		const SolverData& data);
 
 	// Description
 	virtual std::string nameGenInEq() const;
@@ -103,35 +160,73 @@ public:
 	virtual const Eigen::MatrixXd& AGenInEq() const;
 	virtual const Eigen::VectorXd& LowerGenInEq() const;
 	virtual const Eigen::VectorXd& UpperGenInEq() const;
+	virtual const std::vector<ColBlock>& AGenInEqBlocks() const;
 
 protected:
+	/**
+		* Contact data are updated in place so a contact change keep
+		* the memory of the pathBlocks and minusGenWrenches.
+		*/
 	struct ContactData
 	{
-		ContactData() {}
-		ContactData(const rbd::MultiBody& mb,
-			int bodyId, int lambdaBegin,
-			std::vector<Eigen::Vector3d> points,
+		/**
+			* @param mb Robot of the contact body.
+			* @param data Solver data where the body jacobian is registered.
+			*/
+		void set(const rbd::MultiBody& mb, const SolverData& data,
+			int lambdaBegin, int bodyJacIndex,
+			const std::vector<Eigen::Vector3d>& points,
 			const std::vector<FrictionCone>& cones);
+		/// Contact with the ContactModel::Wrench model.
+		void set(const rbd::MultiBody& mb, const SolverData& data,
+			int lambdaBegin, int bodyJacIndex, const WrenchCone& wc);
+
+		int lambdaBegin;
+		int bodyJacIndex; ///< SolverData::bodyJacobian index
+		/// robot dof of the body jacobian columns
+		std::vector<ColBlock> pathBlocks;
+		/**
+			* Wrench at the body origin of each generator of each point
+			* (or of each surface wrench component),
+			* so the lambda columns are J^T W with J the body jacobian.
+			* BEWARE generator are minus to avoid one multiplication by -1 in the
+			* update method
+			*/
+		ReservedMatrix<Eigen::MatrixXd> minusGenWrenches;
+		/// another contact of the robot use the same lambda (self contact)
+		bool sharedLambda;
+	};
 
-
-		int bodyIndex, lambdaBegin;
-		rbd::Jacobian jac;
-		std::vector<Eigen::Vector3d> points;
-		// BEWARE generator are minus to avoid one multiplication by -1 in the
-		// update method
-		std::vector<Eigen::Matrix<double, 3, Eigen::Dynamic> > minusGenerators;
+	/**
+		* Non zero columns of the H lines of a joint.
+		* H(i, j) is non zero only if joint i and j are on the same branch
+		* (one is an ancestor of the other).
+		*/
+	struct HBlock
+	{
+		ColBlock rows; ///< joint dof
+		std::vector<ColBlock> cols; ///< dof of the joint ancestors and descendants
 	};
 
+protected:
+	/// H lines non zero columns of each joint with dof.
+	static std::vector<HBlock> computeHBlocks(const rbd::MultiBody& mb);
+
 protected:
 	int robotIndex_, alphaDBegin_, nrDof_, lambdaBegin_;
-	rbd::ForwardDynamics fd_;
-	Eigen::MatrixXd fullJacLambda_, jacTrans_, jacLambda_;
+	std::vector<HBlock> hBlocks_;
+	int robotDynIndex_; ///< SolverData::robotDynamics index
+	/// non linear effects of the last update, used by computeTorque
+	Eigen::VectorXd C_;
+	/// only the nrCont_ first are used, others keep their memory
 	std::vector<ContactData> cont_;
+	int nrCont_;
 
 	Eigen::VectorXd curTorque_;
 
 	Eigen::MatrixXd A_;
 	Eigen::VectorXd AL_, AU_;
+	std::vector<ColBlock> colBlocks_;
 };
 
 
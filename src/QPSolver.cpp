@@ -18,9 +18,13 @@
 
 // includes
 // std
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <limits>
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
 
 // RBDyn
 #include <RBDyn/MultiBody.h>
@@ -28,6 +32,7 @@
 
 // Tasks
 #include "GenQPSolver.h"
+#include "ThreadPool.h"
 
 
 namespace tasks
@@ -38,6 +43,85 @@ namespace qp
 
 
 
+/**
+	*													Version
+	*/
+
+
+
+int newVersion()
+{
+	static std::atomic<int> counter(0);
+	return counter++ & std::numeric_limits<int>::max();
+}
+
+
+
+/**
+	*													ColBlock
+	*/
+
+
+
+void addColBlock(std::vector<ColBlock>& blocks, int begin, int size)
+{
+	if(size <= 0)
+	{
+		return;
+	}
+
+	int end = begin + size;
+	auto it = blocks.begin();
+	// skip blocks that end before the new one
+	while(it != blocks.end() && (it->begin + it->size) < begin)
+	{
+		++it;
+	}
+
+	// merge all blocks that overlap or touch the new one
+	while(it != blocks.end() && it->begin <= end)
+	{
+		begin = std::min(begin, it->begin);
+		end = std::max(end, it->begin + it->size);
+		it = blocks.erase(it);
+	}
+
+	blocks.insert(it, ColBlock(begin, end - begin));
+}
+
+
+std::vector<ColBlock> jointsColBlocks(const rbd::MultiBody& mb,
+	const std::vector<int>& joints)
+{
+	std::vector<ColBlock> blocks;
+	jointsColBlocks(mb, joints, blocks);
+	return blocks;
+}
+
+
+void jointsColBlocks(const rbd::MultiBody& mb, const std::vector<int>& joints,
+	std::vector<ColBlock>& blocks)
+{
+	blocks.clear();
+	for(int j: joints)
+	{
+		addColBlock(blocks, mb.jointPosInDof(j), mb.joint(j).dof());
+	}
+}
+
+
+int colBlocksSize(const std::vector<ColBlock>& blocks)
+{
+	int size = 0;
+	for(const ColBlock& cb: blocks)
+	{
+		size += cb.size;
+	}
+	return size;
+}
+
+
+
 /**
 	*													QPSolver
 	*/
@@ -51,15 +135,37 @@ QPSolver::QPSolver():
 	genInEqConstr_(),
 	boundConstr_(),
 	tasks_(),
+	targetBuffers_(),
+	contactConstr_(),
+	contactTasks_(),
+	bodyJacsOutdated_(false),
+	taskGroups_(),
+	taskGroupBegin_(),
+	taskGroupsOutdated_(true),
+	reservedVars_(0),
+	reservedEq_(0),
+	reservedInEq_(0),
+	reservedGenInEq_(0),
+	lambdaCapacity_(0),
 	maxEqLines_(0),
 	maxInEqLines_(0),
 	maxGenInEqLines_(0),
-	solver_(createQPSolver(GenQPSolver::default_qp_solver))
+	solver_(createQPSolver(GenQPSolver::default_qp_solver)),
+	warmStart_(true),
+	pool_(),
+	timing_(false),
+	nrTicks_(1),
+	constrTimes_(),
+	taskTimes_(),
+	dataTime_(nrTicks_),
+	matrixTime_(nrTicks_),
+	qpTime_(nrTicks_),
+	totalTime_(nrTicks_)
 {
 }
 
 
-// must declare it in cpp because of GenQPSolver fwd declarition
+// must declare it in cpp because of GenQPSolver and ThreadPool fwd declarition
 QPSolver::~QPSolver()
 {}
 
@@ -78,22 +184,46 @@ bool QPSolver::solve(const std::vector<rbd::MultiBody>& mbs,
 bool QPSolver::solveNoMbcUpdate(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs)
 {
+	TimeRecord::Clock::time_point start;
+	if(timing_)
+	{
+		start = TimeRecord::Clock::now();
+	}
+
 	solverAndBuildTimer_.start();
 	preUpdate(mbs, mbcs);
 
+	TimeRecord::Clock::time_point qpStart;
+	if(timing_)
+	{
+		qpStart = TimeRecord::Clock::now();
+	}
+
 	solverTimer_.start();
 	bool success = solver_->solve();
 	solverTimer_.stop();
 
+	if(timing_)
+	{
+		qpTime_.add(qpStart);
+	}
+
 	if(!success)
 	{
 		solver_->errorMsg(mbs,
 										 tasks_, eqConstr_, inEqConstr_,
 										 genInEqConstr_, boundConstr_,
 										 std::cerr) << std::endl;
+		// don't start the next solve from a failed one
+		solver_->resetWarmStart();
 	}
 	solverAndBuildTimer_.stop();
 
+	if(timing_)
+	{
+		totalTime_.add(start);
+	}
+
 	return success;
 }
 
@@ -113,16 +243,123 @@ int accumMaxLines(int acc, T* constr)
 }
 
 
-void QPSolver::updateConstrSize()
+void QPSolver::computeMaxLines()
 {
 	maxEqLines_ = std::accumulate(eqConstr_.begin(), eqConstr_.end(), 0,
 		accumMaxLines<Equality>);
 	maxInEqLines_ = std::accumulate(inEqConstr_.begin(), inEqConstr_.end(), 0,
 		accumMaxLines<Inequality>);
-	maxGenInEqLines_ = std::accumulate(genInEqConstr_.begin(), genInEqConstr_.end(),
-		0, accumMaxLines<GenInequality>);
+	maxGenInEqLines_ = std::accumulate(genInEqConstr_.begin(),
+		genInEqConstr_.end(), 0, accumMaxLines<GenInequality>);
+}
 
-	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+
+void QPSolver::reserveSolver()
+{
+	solver_->reserve(data_.maxNrVars_, std::max(reservedEq_, maxEqLines_),
+		std::max(reservedInEq_, maxInEqLines_),
+		std::max(reservedGenInEq_, maxGenInEqLines_));
+}
+
+
+void QPSolver::updateConstrSize()
+{
+	int maxEqLines = maxEqLines_;
+	int maxInEqLines = maxInEqLines_;
+	int maxGenInEqLines = maxGenInEqLines_;
+	computeMaxLines();
+
+	// the QP solver can fill less lines than its maximum number of lines,
+	// so it's only resized when the maximum number of lines change
+	if(maxEqLines != maxEqLines_ || maxInEqLines != maxInEqLines_ ||
+		 maxGenInEqLines != maxGenInEqLines_)
+	{
+		reserveSolver();
+		solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_,
+			maxGenInEqLines_);
+	}
+	else
+	{
+		// constraints lines can have a different meaning
+		solver_->resetWarmStart();
+	}
+}
+
+
+/**
+	* Check that a ContactModel::Wrench contact has its wrench cones.
+	* @throw std::domain_error If a wrench cone is missing.
+	*/
+template<typename T>
+void checkContactModel(const T& c)
+{
+	auto validCone = [](const WrenchCone& wc)
+	{
+		return wc.wrenches.rows() == 6 && wc.wrenches.cols() == 6 &&
+			wc.faces.cols() == 6 && wc.faces.rows() > 0;
+	};
+
+	if(c.model == ContactModel::Wrench &&
+		 (!validCone(c.r1WrenchCone) || !validCone(c.r2WrenchCone)))
+	{
+		const ContactId& cId = c.contactId;
+		std::ostringstream str;
+		str << "The contact between the body " << cId.r1BodyId << " of the robot "
+				<< cId.r1Index << " and the body " << cId.r2BodyId << " of the robot "
+				<< cId.r2Index << " use the Wrench model without wrench cone";
+		throw std::domain_error(str.str());
+	}
+}
+
+
+/// Copy a contact in place, the vectors keep their memory if it's big enough.
+template<typename T>
+void assignContact(T& c, const T& value)
+{
+	c = value;
+}
+
+
+/// In place version of BilateralContact(const UnilateralContact&).
+void assignContact(BilateralContact& c, const UnilateralContact& value)
+{
+	c.contactId = value.contactId;
+	c.r1Points = value.r1Points;
+	c.r2Points = value.r2Points;
+	c.r1Cones.assign(value.r1Points.size(), value.r1Cone);
+	c.r2Cones.assign(value.r1Points.size(), value.r2Cone);
+	c.r1WrenchCone = value.r1WrenchCone;
+	c.r2WrenchCone = value.r2WrenchCone;
+	c.X_b1_b2 = value.X_b1_b2;
+	c.X_b1_cf = value.X_b1_cf;
+	c.model = value.model;
+}
+
+
+/**
+	* Insert a copy of value at index.
+	* The copy is made in a removed contact of spare to reuse its memory.
+	*/
+template<typename T, typename U>
+void insertContact(std::vector<T>& contacts, std::vector<T>& spare,
+	int index, const U& value)
+{
+	if(spare.empty())
+	{
+		spare.emplace_back();
+	}
+	assignContact(spare.back(), value);
+	contacts.insert(contacts.begin() + index, std::move(spare.back()));
+	spare.pop_back();
+}
+
+
+/// Remove the contact at index and keep its memory in spare.
+template<typename T>
+void eraseContact(std::vector<T>& contacts, std::vector<T>& spare, int index)
+{
+	spare.push_back(std::move(contacts[index]));
+	contacts.erase(contacts.begin() + index);
 }
 
 
@@ -130,16 +367,21 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 	std::vector<UnilateralContact> uni,
 	std::vector<BilateralContact> bi)
 {
+	for(const UnilateralContact& c: uni)
+	{
+		checkContactModel(c);
+	}
+	for(const BilateralContact& c: bi)
+	{
+		checkContactModel(c);
+	}
+
 	data_.alphaD_.resize(mbs.size());
 	data_.alphaDBegin_.resize(mbs.size());
 
 	data_.uniCont_ = std::move(uni);
 	data_.biCont_ = std::move(bi);
-
-	int nrContacts = data_.nrContacts();
-
-	data_.lambda_.resize(nrContacts);
-	data_.lambdaBegin_.resize(nrContacts);
+	reserveContacts();
 
 	data_.mobileRobotIndex_.clear();
 	data_.normalAccB_.resize(mbs.size());
@@ -160,88 +402,353 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 	}
 	data_.totalAlphaD_ = cumAlphaD;
 
-	int cumLambda = cumAlphaD;
-	int cIndex = 0;
 	data_.allCont_.clear();
+	for(const UnilateralContact& c: data_.uniCont_)
+	{
+		data_.allCont_.emplace_back(c);
+	}
+	for(const BilateralContact& c: data_.biCont_)
+	{
+		data_.allCont_.emplace_back(c);
+	}
+	data_.contactIndex_.clear();
+	updateContacts();
+
+	// tasks and constraints register the body jacobian
+	// and robot dynamics they need again
+	data_.bodyJacs_.clear();
+	data_.robotDyns_.clear();
+
+	updateNrVars(mbs);
+
+	computeMaxLines();
+	reserveSolver();
+	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+}
+
+
+int QPSolver::nrVars() const
+{
+	return data_.nrVars_;
+}
+
+
+void QPSolver::updateContacts()
+{
+	int nrContacts = data_.nrContacts();
+
+	data_.lambda_.resize(nrContacts);
+	data_.lambdaBegin_.resize(nrContacts);
+
+	int cumLambda = data_.totalAlphaD_;
+	int cIndex = 0;
 	// counting unilateral contact
 	for(const UnilateralContact& c: data_.uniCont_)
 	{
 		data_.lambdaBegin_[cIndex] = cumLambda;
-		int lambda = 0;
-		for(std::size_t p = 0; p < c.r1Points.size(); ++p)
-		{
-			lambda += c.nrLambda(int(p));
-		}
+		int lambda = c.nrLambda();
 		data_.lambda_[cIndex] = lambda;
 		cumLambda += lambda;
 		++cIndex;
-
-		data_.allCont_.emplace_back(c);
 	}
-	data_.nrUniLambda_ = cumLambda - cumAlphaD;
+	data_.nrUniLambda_ = cumLambda - data_.totalAlphaD_;
 
 	// counting bilateral contact
 	for(const BilateralContact& c: data_.biCont_)
 	{
 		data_.lambdaBegin_[cIndex] = cumLambda;
-		int lambda = 0;
-		for(std::size_t p = 0; p < c.r1Points.size(); ++p)
-		{
-			lambda += c.nrLambda(int(p));
-		}
+		int lambda = c.nrLambda();
 		data_.lambda_[cIndex] = lambda;
 		cumLambda += lambda;
 		++cIndex;
+	}
+	data_.nrBiLambda_ = cumLambda - data_.nrUniLambda_ - data_.totalAlphaD_;
 
-		data_.allCont_.emplace_back(c);
+	// ids are updated in place, removed contacts keep the -1 index
+	// and only new ids allocate a node
+	for(auto& ci: data_.contactIndex_)
+	{
+		ci.second = -1;
+	}
+	for(int i = 0; i < nrContacts; ++i)
+	{
+		const ContactId& cId = data_.allCont_[i].contactId;
+		auto it = data_.contactIndex_.find(cId);
+		if(it == data_.contactIndex_.end())
+		{
+			data_.contactIndex_.emplace(cId, i);
+		}
+		// keep the first contact if two contacts have the same id
+		else if(it->second == -1)
+		{
+			it->second = i;
+		}
 	}
-	data_.nrBiLambda_ = cumLambda - data_.nrUniLambda_ - cumAlphaD;
 
 	data_.totalLambda_ = data_.nrUniLambda_ + data_.nrBiLambda_;
 	data_.nrVars_ = data_.totalAlphaD_ + data_.totalLambda_;
+	// constraint matrices have columns up to the lambda capacity and the
+	// reserved number of variables so they are not resized by a contact change
+	data_.maxNrVars_ = std::max({data_.nrVars_,
+		data_.totalAlphaD_ + lambdaCapacity_, reservedVars_});
 
-	for(Task* t: tasks_)
+}
+
+
+bool QPSolver::addContact(const std::vector<rbd::MultiBody>& mbs,
+	const UnilateralContact& contact)
+{
+	checkContactModel(contact);
+	if(data_.contactIndex(contact.contactId) != -1)
 	{
-		t->updateNrVars(mbs, data_);
+		return false;
 	}
 
-	for(Constraint* c: constr_)
+	int nrUni = int(data_.uniCont_.size());
+	insertContact(data_.uniCont_, data_.uniSpare_, nrUni, contact);
+	// unilateral contacts come first in allCont_
+	insertContact(data_.allCont_, data_.allSpare_, nrUni, contact);
+	updateContactsNrVars(mbs);
+	return true;
+}
+
+
+bool QPSolver::addContact(const std::vector<rbd::MultiBody>& mbs,
+	const BilateralContact& contact)
+{
+	checkContactModel(contact);
+	if(data_.contactIndex(contact.contactId) != -1)
 	{
-		c->updateNrVars(mbs, data_);
+		return false;
 	}
 
-	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+	insertContact(data_.biCont_, data_.biSpare_, int(data_.biCont_.size()),
+		contact);
+	insertContact(data_.allCont_, data_.allSpare_, int(data_.allCont_.size()),
+		contact);
+	updateContactsNrVars(mbs);
+	return true;
 }
 
 
-int QPSolver::nrVars() const
+bool QPSolver::removeContact(const std::vector<rbd::MultiBody>& mbs,
+	const ContactId& contactId)
 {
-	return data_.nrVars_;
+	int index = data_.contactIndex(contactId);
+	if(index == -1)
+	{
+		return false;
+	}
+
+	int nrUni = int(data_.uniCont_.size());
+	if(index < nrUni)
+	{
+		eraseContact(data_.uniCont_, data_.uniSpare_, index);
+	}
+	else
+	{
+		eraseContact(data_.biCont_, data_.biSpare_, index - nrUni);
+	}
+	eraseContact(data_.allCont_, data_.allSpare_, index);
+	updateContactsNrVars(mbs);
+	return true;
+}
+
+
+void QPSolver::reserve(int maxVars, int maxEq, int maxInEq, int maxGenInEq)
+{
+	reservedVars_ = maxVars;
+	reservedEq_ = maxEq;
+	reservedInEq_ = maxInEq;
+	reservedGenInEq_ = maxGenInEq;
+}
+
+
+void QPSolver::lambdaCapacity(int capacity)
+{
+	lambdaCapacity_ = capacity;
+}
+
+
+int QPSolver::lambdaCapacity() const
+{
+	return lambdaCapacity_;
+}
+
+
+void QPSolver::reserveContacts()
+{
+	// each contact have at least one lambda
+	std::size_t capacity = std::max(std::size_t(lambdaCapacity_),
+		data_.uniCont_.size() + data_.biCont_.size());
+
+	data_.uniCont_.reserve(capacity);
+	data_.biCont_.reserve(capacity);
+	data_.allCont_.reserve(capacity);
+	data_.uniSpare_.reserve(capacity);
+	data_.biSpare_.reserve(capacity);
+	data_.allSpare_.reserve(capacity);
+	data_.lambda_.reserve(capacity);
+	data_.lambdaBegin_.reserve(capacity);
+	data_.contactIndex_.reserve(capacity);
+}
+
+
+void QPSolver::updateContactsNrVars(const std::vector<rbd::MultiBody>& mbs)
+{
+	int maxNrVars = data_.maxNrVars_;
+	updateContacts();
+
+	if(data_.maxNrVars_ != maxNrVars)
+	{
+		// the lambda capacity and the reserved number of variables
+		// are exceeded, all constraints matrices must be resized
+		updateNrVars(mbs);
+	}
+	else
+	{
+		// removed contacts body jacobians must not be computed anymore,
+		// the unregistered jacobians are kept for the next contacts.
+		// Robot dynamics registrations are kept, other users
+		// only need the index of their body jacobians
+		registerBodyJacobians(mbs);
+
+		for(Task* t: contactTasks_)
+		{
+			t->updateNrVars(mbs, data_);
+		}
+		for(Constraint* c: contactConstr_)
+		{
+			c->updateNrVars(mbs, data_);
+		}
+	}
+
+	// the QP solver only has the alphaD and lambda variables,
+	// its buffers are kept if they have been reserved
+	computeMaxLines();
+	reserveSolver();
+	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_,
+		maxGenInEqLines_);
 }
 
 
-void QPSolver::updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs) const
+template<typename T>
+void QPSolver::updateNrVars(const std::vector<rbd::MultiBody>& mbs, T* obj,
+	std::vector<T*>& users)
 {
+	data_.contactsUsed_ = false;
+	obj->registerData(mbs, data_);
+	obj->updateNrVars(mbs, data_);
+
+	auto it = std::find(users.begin(), users.end(), obj);
+	if(data_.contactsUsed_ && it == users.end())
+	{
+		users.push_back(obj);
+	}
+	else if(!data_.contactsUsed_ && it != users.end())
+	{
+		users.erase(it);
+	}
+}
+
+
+void QPSolver::registerBodyJacobians(const std::vector<rbd::MultiBody>& mbs)
+{
+	// registered jacobians keep their index
+	data_.unregisterBodyJacobians();
 	for(Task* t: tasks_)
 	{
-		t->updateNrVars(mbs, data_);
+		t->registerData(mbs, data_);
+	}
+	for(Constraint* c: constr_)
+	{
+		c->registerData(mbs, data_);
 	}
+	bodyJacsOutdated_ = false;
 }
 
 
-void QPSolver::updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs) const
+void QPSolver::updateTaskGroups()
+{
+	// label each task with the smallest task index of its group,
+	// tasks that reach the same high level task (directly or through
+	// JointsSelector like wrappers) are merged in the same group
+	std::vector<int> group(tasks_.size());
+	std::vector<std::pair<HighLevelTask*, int>> hlTasks;
+	for(int i = 0; i < int(tasks_.size()); ++i)
+	{
+		group[i] = i;
+		for(HighLevelTask* hl = tasks_[i]->highLevelTask(); hl != nullptr;
+				hl = hl->highLevelTask())
+		{
+			auto it = std::find_if(hlTasks.begin(), hlTasks.end(),
+				[hl](const std::pair<HighLevelTask*, int>& p)
+					{return p.first == hl;});
+			if(it == hlTasks.end())
+			{
+				hlTasks.emplace_back(hl, i);
+			}
+			else
+			{
+				const int from = std::max(group[i], group[it->second]);
+				const int to = std::min(group[i], group[it->second]);
+				std::replace(group.begin(), group.end(), from, to);
+			}
+		}
+	}
+
+	taskGroups_.clear();
+	taskGroupBegin_.clear();
+	for(int i = 0; i < int(tasks_.size()); ++i)
+	{
+		if(group[i] == i)
+		{
+			taskGroupBegin_.push_back(int(taskGroups_.size()));
+			for(int j = i; j < int(tasks_.size()); ++j)
+			{
+				if(group[j] == i)
+				{
+					taskGroups_.push_back(j);
+				}
+			}
+		}
+	}
+	taskGroupBegin_.push_back(int(taskGroups_.size()));
+	taskGroupsOutdated_ = false;
+}
+
+
+void QPSolver::updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs)
+{
+	for(Task* t: tasks_)
+	{
+		updateNrVars(mbs, t, contactTasks_);
+	}
+	registerBodyJacobians(mbs);
+}
+
+
+void QPSolver::updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs)
 {
 	for(Constraint* c: constr_)
 	{
-		c->updateNrVars(mbs, data_);
+		updateNrVars(mbs, c, contactConstr_);
 	}
+	registerBodyJacobians(mbs);
 }
 
 
-void QPSolver::updateNrVars(const std::vector<rbd::MultiBody>& mbs) const
+void QPSolver::updateNrVars(const std::vector<rbd::MultiBody>& mbs)
 {
-	updateTasksNrVars(mbs);
-	updateConstrsNrVars(mbs);
+	for(Task* t: tasks_)
+	{
+		updateNrVars(mbs, t, contactTasks_);
+	}
+	for(Constraint* c: constr_)
+	{
+		updateNrVars(mbs, c, contactConstr_);
+	}
+	registerBodyJacobians(mbs);
 }
 
 
@@ -322,6 +829,7 @@ void QPSolver::addConstraint(Constraint* co)
 	if(std::find(constr_.begin(), constr_.end(), co) == constr_.end())
 	{
 		constr_.push_back(co);
+		constrTimes_.emplace_back(nrTicks_);
 	}
 }
 
@@ -332,10 +840,11 @@ void QPSolver::addConstraint(const std::vector<rbd::MultiBody>& mbs,
 	if(std::find(constr_.begin(), constr_.end(), co) == constr_.end())
 	{
 		constr_.push_back(co);
+		constrTimes_.emplace_back(nrTicks_);
 		// check if nrVars has been call at least one
 		if(data_.nrVars_ > 0)
 		{
-			co->updateNrVars(mbs, data_);
+			updateNrVars(mbs, co, contactConstr_);
 		}
 	}
 }
@@ -346,7 +855,11 @@ void QPSolver::removeConstraint(Constraint* co)
 	auto it = std::find(constr_.begin(), constr_.end(), co);
 	if(it != constr_.end())
 	{
+		constrTimes_.erase(constrTimes_.begin() + (it - constr_.begin()));
 		constr_.erase(it);
+		contactConstr_.erase(std::remove(contactConstr_.begin(),
+			contactConstr_.end(), co), contactConstr_.end());
+		bodyJacsOutdated_ = true;
 	}
 }
 
@@ -361,6 +874,8 @@ void QPSolver::addTask(Task* task)
 	if(std::find(tasks_.begin(), tasks_.end(), task) == tasks_.end())
 	{
 		tasks_.push_back(task);
+		taskTimes_.emplace_back(nrTicks_);
+		taskGroupsOutdated_ = true;
 	}
 }
 
@@ -370,10 +885,12 @@ void QPSolver::addTask(const std::vector<rbd::MultiBody>& mbs, Task* task)
 	if(std::find(tasks_.begin(), tasks_.end(), task) == tasks_.end())
 	{
 		tasks_.push_back(task);
+		taskTimes_.emplace_back(nrTicks_);
+		taskGroupsOutdated_ = true;
 		// check if nrVars has been call at least one
 		if(data_.nrVars_ > 0)
 		{
-			task->updateNrVars(mbs, data_);
+			updateNrVars(mbs, task, contactTasks_);
 		}
 	}
 }
@@ -384,7 +901,12 @@ void QPSolver::removeTask(Task* task)
 	auto it = std::find(tasks_.begin(), tasks_.end(), task);
 	if(it != tasks_.end())
 	{
+		taskTimes_.erase(taskTimes_.begin() + (it - tasks_.begin()));
 		tasks_.erase(it);
+		contactTasks_.erase(std::remove(contactTasks_.begin(),
+			contactTasks_.end(), task), contactTasks_.end());
+		bodyJacsOutdated_ = true;
+		taskGroupsOutdated_ = true;
 	}
 }
 
@@ -395,16 +917,92 @@ int QPSolver::nrTasks() const
 }
 
 
+void QPSolver::addTargetBuffer(TargetBufferBase* buffer)
+{
+	if(std::find(targetBuffers_.begin(), targetBuffers_.end(), buffer) ==
+		 targetBuffers_.end())
+	{
+		targetBuffers_.push_back(buffer);
+	}
+}
+
+
+void QPSolver::removeTargetBuffer(TargetBufferBase* buffer)
+{
+	auto it = std::find(targetBuffers_.begin(), targetBuffers_.end(), buffer);
+	if(it != targetBuffers_.end())
+	{
+		targetBuffers_.erase(it);
+	}
+}
+
+
+int QPSolver::nrTargetBuffers() const
+{
+	return static_cast<int>(targetBuffers_.size());
+}
+
+
 void QPSolver::solver(const std::string& name)
 {
 	solver_ = std::unique_ptr<GenQPSolver>(createQPSolver(name));
+	solver_->warmStart(warmStart_);
+	reserveSolver();
 	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
 }
 
 
+void QPSolver::warmStart(bool warm)
+{
+	warmStart_ = warm;
+	solver_->warmStart(warm);
+}
+
+
+bool QPSolver::warmStart() const
+{
+	return warmStart_;
+}
+
+
+bool QPSolver::nextSolveWarm() const
+{
+	return solver_->nextSolveWarm();
+}
+
+
+void QPSolver::resetWarmStart()
+{
+	solver_->resetWarmStart();
+}
+
+
+void QPSolver::nrThreads(int nrThreads, const std::vector<int>& cpus)
+{
+	if(nrThreads > 1)
+	{
+		pool_.reset(new ThreadPool(nrThreads, cpus));
+	}
+	else
+	{
+		pool_.reset();
+	}
+}
+
+
+int QPSolver::nrThreads() const
+{
+	return pool_ ? pool_->nrThreads() : 1;
+}
+
+
 void QPSolver::resetTasks()
 {
 	tasks_.clear();
+	taskTimes_.clear();
+	contactTasks_.clear();
+	bodyJacsOutdated_ = true;
+	taskGroupsOutdated_ = true;
 }
 
 
@@ -420,32 +1018,32 @@ SolverData& QPSolver::data()
 }
 
 
-const Eigen::VectorXd& QPSolver::result() const
+Eigen::Ref<const Eigen::VectorXd> QPSolver::result() const
 {
 	return solver_->result();
 }
 
 
-Eigen::VectorXd QPSolver::alphaDVec() const
+Eigen::Ref<const Eigen::VectorXd> QPSolver::alphaDVec() const
 {
 	return solver_->result().head(data_.totalAlphaD_);
 }
 
 
-Eigen::VectorXd QPSolver::alphaDVec(int rIndex) const
+Eigen::Ref<const Eigen::VectorXd> QPSolver::alphaDVec(int rIndex) const
 {
 	return solver_->result().segment(data_.alphaDBegin_[rIndex],
 		data_.alphaD_[rIndex]);
 }
 
 
-Eigen::VectorXd QPSolver::lambdaVec() const
+Eigen::Ref<const Eigen::VectorXd> QPSolver::lambdaVec() const
 {
 	return solver_->result().segment(data_.lambdaBegin(), data_.totalLambda_);
 }
 
 
-Eigen::VectorXd QPSolver::lambdaVec(int cIndex) const
+Eigen::Ref<const Eigen::VectorXd> QPSolver::lambdaVec(int cIndex) const
 {
 	return solver_->result().segment(data_.lambdaBegin_[cIndex],
 		data_.lambda_[cIndex]);
@@ -454,53 +1052,234 @@ Eigen::VectorXd QPSolver::lambdaVec(int cIndex) const
 
 int QPSolver::contactLambdaPosition(const ContactId& cId) const
 {
-	int pos = 0;
+	int index = data_.contactIndex(cId);
+	return index != -1 ? data_.lambdaBegin(index) - data_.lambdaBegin() : -1;
+}
+
+
+boost::timer::cpu_times QPSolver::solveTime() const
+{
+	return solverTimer_.elapsed();
+}
 
-	for(const BilateralContact& bc: data_.allContacts())
+
+boost::timer::cpu_times QPSolver::solveAndBuildTime() const
+{
+	return solverAndBuildTimer_.elapsed();
+}
+
+
+void QPSolver::timing(bool enable, int nrTicks)
+{
+	timing_ = enable;
+	nrTicks_ = nrTicks;
+	for(TimeRecord& tr: constrTimes_)
 	{
-		if(bc.contactId == cId)
-		{
-			return pos;
-		}
+		tr.capacity(nrTicks_);
+	}
+	for(TimeRecord& tr: taskTimes_)
+	{
+		tr.capacity(nrTicks_);
+	}
+	for(TimeRecord* tr: {&dataTime_, &matrixTime_, &qpTime_, &totalTime_})
+	{
+		tr->capacity(nrTicks_);
+	}
+}
 
-		for(std::size_t i = 0; i < bc.r1Points.size(); ++i)
-		{
-			pos += bc.nrLambda(int(i));
-		}
+
+bool QPSolver::timing() const
+{
+	return timing_;
+}
+
+
+const TimeRecord& QPSolver::taskTime(Task* task) const
+{
+	auto it = std::find(tasks_.begin(), tasks_.end(), task);
+	if(it == tasks_.end())
+	{
+		throw std::domain_error("Task is not in the solver");
 	}
+	return taskTimes_[it - tasks_.begin()];
+}
 
-	return -1;
+
+const TimeRecord& QPSolver::constraintTime(Constraint* constr) const
+{
+	auto it = std::find(constr_.begin(), constr_.end(), constr);
+	if(it == constr_.end())
+	{
+		throw std::domain_error("Constraint is not in the solver");
+	}
+	return constrTimes_[it - constr_.begin()];
 }
 
 
-boost::timer::cpu_times QPSolver::solveTime() const
+const TimeRecord& QPSolver::dataTime() const
 {
-	return solverTimer_.elapsed();
+	return dataTime_;
 }
 
 
-boost::timer::cpu_times QPSolver::solveAndBuildTime() const
+const TimeRecord& QPSolver::matrixTime() const
 {
-	return solverAndBuildTimer_.elapsed();
+	return matrixTime_;
+}
+
+
+const TimeRecord& QPSolver::qpTime() const
+{
+	return qpTime_;
+}
+
+
+const TimeRecord& QPSolver::totalTime() const
+{
+	return totalTime_;
 }
 
 
 void QPSolver::preUpdate(const std::vector<rbd::MultiBody>& mbs,
 												const std::vector<rbd::MultiBodyConfig>& mbcs)
 {
-	data_.computeNormalAccB(mbs, mbcs);
-	for(std::size_t i = 0; i < constr_.size(); ++i)
+	TimeRecord::Clock::time_point start;
+	if(timing_)
 	{
-		constr_[i]->update(mbs, mbcs, data_);
+		start = TimeRecord::Clock::now();
 	}
 
-	for(std::size_t i = 0; i < tasks_.size(); ++i)
+	// apply the targets published since the last solve
+	for(TargetBufferBase* tb: targetBuffers_)
 	{
-		tasks_[i]->update(mbs, mbcs, data_);
+		tb->swap();
+	}
+
+	// removed tasks and constraints body jacobians are not computed anymore
+	if(bodyJacsOutdated_)
+	{
+		registerBodyJacobians(mbs);
+	}
+
+	if(pool_)
+	{
+		// each robot normal acceleration, body jacobian and robot dynamics
+		// only write its own data
+		const int nrNormalAcc = int(data_.mobileRobotIndex_.size());
+		const int nrBodyJacs = int(data_.bodyJacs_.size());
+		const int nrData = nrNormalAcc + nrBodyJacs + int(data_.robotDyns_.size());
+		auto updateData = [this, nrNormalAcc, nrBodyJacs, &mbs, &mbcs](int i)
+		{
+			if(i < nrNormalAcc)
+			{
+				data_.computeNormalAccB(mbs, mbcs, data_.mobileRobotIndex_[i]);
+			}
+			else if(i < nrNormalAcc + nrBodyJacs)
+			{
+				BodyJacobian& bj = data_.bodyJacs_[i - nrNormalAcc];
+				if(bj.registered())
+				{
+					bj.update(mbs[bj.robotIndex()], mbcs[bj.robotIndex()]);
+				}
+			}
+			else
+			{
+				RobotDynamics& rd = data_.robotDyns_[i - nrNormalAcc - nrBodyJacs];
+				rd.update(mbs[rd.robotIndex()], mbcs[rd.robotIndex()]);
+			}
+		};
+		pool_->parallelFor(nrData, updateData);
+	}
+	else
+	{
+		data_.computeNormalAccB(mbs, mbcs);
+		data_.computeBodyJacobians(mbs, mbcs);
+		data_.computeRobotDynamics(mbs, mbcs);
+	}
+
+	if(timing_)
+	{
+		dataTime_.add(start);
+	}
+
+	// constraints are updated first, then tasks
+	const int nrConstr = int(constr_.size());
+	const int nrUpdates = nrConstr + int(tasks_.size());
+	auto update = [this, nrConstr, &mbs, &mbcs](int i)
+	{
+		TimeRecord::Clock::time_point updateStart;
+		if(timing_)
+		{
+			updateStart = TimeRecord::Clock::now();
+		}
+
+		if(i < nrConstr)
+		{
+			constr_[i]->update(mbs, mbcs, data_);
+			if(timing_)
+			{
+				constrTimes_[i].add(updateStart);
+			}
+		}
+		else
+		{
+			tasks_[i - nrConstr]->update(mbs, mbcs, data_);
+			if(timing_)
+			{
+				taskTimes_[i - nrConstr].add(updateStart);
+			}
+		}
+	};
+
+	if(pool_)
+	{
+		if(taskGroupsOutdated_)
+		{
+			updateTaskGroups();
+		}
+
+		// constraints and task groups only write their own data (and time
+		// record) so the result don't depend of the update order,
+		// the tasks of a group are updated sequentially because they
+		// update the same high level task
+		const int nrGroups = int(taskGroupBegin_.size()) - 1;
+		auto updateGroup = [this, nrConstr, &update](int i)
+		{
+			if(i < nrConstr)
+			{
+				update(i);
+			}
+			else
+			{
+				const int g = i - nrConstr;
+				for(int t = taskGroupBegin_[g]; t < taskGroupBegin_[g + 1]; ++t)
+				{
+					update(nrConstr + taskGroups_[t]);
+				}
+			}
+		};
+		pool_->parallelFor(nrConstr + nrGroups, updateGroup);
+	}
+	else
+	{
+		for(int i = 0; i < nrUpdates; ++i)
+		{
+			update(i);
+		}
+	}
+
+	if(timing_)
+	{
+		start = TimeRecord::Clock::now();
 	}
 
 	solver_->updateMatrix(tasks_, eqConstr_, inEqConstr_, genInEqConstr_,
 		boundConstr_);
+
+	if(timing_)
+	{
+		matrixTime_.add(start);
+	}
 }
 
 
@@ -520,6 +1299,33 @@ void QPSolver::postUpdate(const std::vector<rbd::MultiBody>& /* mbs */,
 }
 
 
+
+/**
+	*													Task
+	*/
+
+
+Eigen::MatrixXd Task::denseQ() const
+{
+	const Eigen::MatrixXd& Qi = Q();
+	int size = static_cast<int>(C().rows());
+
+	switch(structureQ())
+	{
+		case QStructure::Lower:
+			return Eigen::MatrixXd(Qi.selfadjointView<Eigen::Lower>());
+		case QStructure::Diagonal:
+			return Eigen::MatrixXd(Qi.col(0).asDiagonal());
+		case QStructure::ScaledIdentity:
+			return Qi(0, 0)*Eigen::MatrixXd::Identity(size, size);
+		case QStructure::Factor:
+			return Qi.transpose()*Qi;
+		default:
+			return Qi;
+	}
+}
+
+
 } // namespace qp
 
 } // namespace tasks
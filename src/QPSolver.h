@@ -27,8 +27,11 @@
 #include <Eigen/Core>
 
 // Tasks
+#include "GenQPSolver.h"
 #include "QPSolverData.h"
 #include "QPContacts.h"
+#include "TargetBuffer.h"
+#include "TimeRecord.h"
 
 
 // forward declaration
@@ -42,6 +45,7 @@ class MultiBodyConfig;
 
 namespace tasks
 {
+class ThreadPool;
 
 namespace qp
 {
@@ -51,10 +55,65 @@ class Inequality;
 class GenInequality;
 class Bound;
 class Task;
+class HighLevelTask;
 class GenQPSolver;
 
 
 
+/**
+	* Add a column range to a column block list.
+	* The list is kept sorted and overlapping or adjacent blocks are merged.
+	* @param blocks Sorted column block list.
+	* @param begin First column of the range.
+	* @param size Number of columns of the range, ignored if null.
+	*/
+void addColBlock(std::vector<ColBlock>& blocks, int begin, int size);
+
+
+/**
+	* Column block list of the dof of some joints.
+	* Blocks are in the same order than the joints dof so a matrix with
+	* the columns of the joints concatenated (like rbd::Jacobian::jacobian)
+	* is the concatenation of the blocks.
+	* @param mb Robot.
+	* @param joints Joint indexes sorted by dof position
+	* (like rbd::Jacobian::jointsPath).
+	*/
+std::vector<ColBlock> jointsColBlocks(const rbd::MultiBody& mb,
+	const std::vector<int>& joints);
+/// Fill blocks in place with the joints column blocks (see above).
+void jointsColBlocks(const rbd::MultiBody& mb, const std::vector<int>& joints,
+	std::vector<ColBlock>& blocks);
+
+
+/// Sum of the column blocks size.
+int colBlocksSize(const std::vector<ColBlock>& blocks);
+
+
+/**
+	* Empty column block list.
+	* Returned by constraints that don't declare their structure,
+	* mean that all columns can be non zero.
+	*/
+inline const std::vector<ColBlock>& denseColBlocks()
+{
+	static const std::vector<ColBlock> blocks;
+	return blocks;
+}
+
+
+
+/**
+	* Generate a version number for Task::versionQ and the constraints
+	* version methods.
+	* Returned numbers are positive and unique across all tasks and constraints
+	* so an object deleted and replaced by another one at the same address
+	* cannot be mistaken for it.
+	*/
+int newVersion();
+
+
+
 class QPSolver
 {
 public:
@@ -62,6 +121,9 @@ public:
 	~QPSolver();
 
 	/** solve the problem
+		* Once a problem has been solved, solving it again don't allocate
+		* memory until the problem size, tasks or constraints change
+		* (except when the solve fail and the error message is built).
 		*  \param mbs current multibody
 		*  \param mbcs current state of the multibody and result of the solved problem
 		*/
@@ -84,17 +146,82 @@ public:
 
 	void updateConstrSize();
 
+	/**
+		* Set the robots and the contacts and update every task and constraint.
+		* @throw std::domain_error If a ContactModel::Wrench contact has no
+		* wrench cone.
+		*/
 	void nrVars(const std::vector<rbd::MultiBody>& mbs,
 		std::vector<UnilateralContact> uni,
 		std::vector<BilateralContact> bi);
 	int nrVars() const;
 
-	/// call updateNrVars on all tasks
-	void updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs) const;
-	/// call updateNrVars on all constraints
-	void updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs) const;
-	/// call updateNrVars on all tasks and constraints
-	void updateNrVars(const std::vector<rbd::MultiBody>& mbs) const;
+	/**
+		* Add a contact without calling nrVars.
+		* Lambda offsets are shifted and only the tasks and constraints that
+		* call SolverData::dependOnContacts in their registerData are notified.
+		* Other tasks and constraints only register their body jacobians again
+		* if the lambda capacity and the reserved number of variables are
+		* not exceeded, else they are all notified like in nrVars.
+		* The memory of removed contacts and their body jacobians is kept,
+		* so below the lambda capacity a contact switch doesn't allocate
+		* memory in QPSolver, MotionConstr and PositiveLambda once the
+		* switched contacts have been used (ContactConstr, WrenchConeConstr
+		* and the contact tasks still rebuild their data).
+		* nrVars must have been called once.
+		* @return false if a contact with the same id is already in the solver.
+		* @throw std::domain_error If a ContactModel::Wrench contact has no
+		* wrench cone.
+		*/
+	bool addContact(const std::vector<rbd::MultiBody>& mbs,
+		const UnilateralContact& contact);
+	bool addContact(const std::vector<rbd::MultiBody>& mbs,
+		const BilateralContact& contact);
+	/**
+		* Remove a contact without calling nrVars (see addContact).
+		* @return false if there is no contact with this id.
+		*/
+	bool removeContact(const std::vector<rbd::MultiBody>& mbs,
+		const ContactId& contactId);
+
+	/**
+		* Reserve the QP solver buffers for the largest expected problem
+		* (see GenQPSolver::reserve).
+		* The QP solver always has the size of the current problem, adding
+		* contacts or constraint lines below the reserved size only avoid
+		* the allocation of its buffers.
+		* Constraint matrices have maxVars columns (see SolverData::maxNrVars).
+		* Taken into account by the next nrVars and updateConstrSize calls.
+		* @param maxVars Maximum number of variables.
+		* @param maxEq Maximum number of equality lines.
+		* @param maxInEq Maximum number of inequality lines.
+		* @param maxGenInEq Maximum number of general inequality lines.
+		*/
+	void reserve(int maxVars, int maxEq, int maxInEq, int maxGenInEq);
+
+	/**
+		* Number of lambda variables reserved for the contacts.
+		* Constraint matrices and the QP solver buffers are sized for this
+		* number of lambda so they are not reallocated when contacts are
+		* added or removed below it. Unused lambda are not in the QP.
+		* Unlike reserve, the capacity doesn't depend on the robots dof.
+		* Taken into account by the next nrVars call.
+		*/
+	void lambdaCapacity(int capacity);
+	int lambdaCapacity() const;
+
+	/**
+		* Call registerData and updateNrVars on all tasks.
+		* The body jacobians registrations are then rebuilt from all tasks and
+		* constraints so the jacobians that are not used anymore are not
+		* computed (this is also done by the updateConstrsNrVars
+		* and updateNrVars calls).
+		*/
+	void updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs);
+	/// call registerData and updateNrVars on all constraints
+	void updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs);
+	/// call registerData and updateNrVars on all tasks and constraints
+	void updateNrVars(const std::vector<rbd::MultiBody>& mbs);
 
 	void addEqualityConstraint(Equality* co);
 	void removeEqualityConstraint(Equality* co);
@@ -114,32 +241,125 @@ public:
 
 	void addConstraint(Constraint* co);
 	void addConstraint(const std::vector<rbd::MultiBody>& mbs, Constraint* co);
+	/**
+		* Remove a constraint.
+		* The body jacobians registrations are rebuilt at the next solve,
+		* so the jacobians only used by this constraint are not computed anymore.
+		*/
 	void removeConstraint(Constraint* co);
 	int nrConstraints() const;
 
 	void addTask(Task* task);
 	void addTask(const std::vector<rbd::MultiBody>& mbs, Task* task);
+	/// Remove a task, see removeConstraint for the body jacobians.
 	void removeTask(Task* task);
 	void resetTasks();
 	int nrTasks() const;
 
+	/**
+		* Add a buffer swapped at the beginning of each solve, before
+		* any task or constraint update.
+		* Targets published from another thread in the buffer are applied
+		* in the solve thread so the solve don't have to be locked.
+		*/
+	void addTargetBuffer(TargetBufferBase* buffer);
+	void removeTargetBuffer(TargetBufferBase* buffer);
+	int nrTargetBuffers() const;
+
+	/**
+		* Change the QP solver.
+		* The warm start setting is kept by the new solver.
+		* @see createQPSolver
+		*/
 	void solver(const std::string& name);
 
+	/**
+		* Enable or disable the warm start of the QP solver.
+		* Only the LSSOL, GI and ADMM solvers use this setting, QLD is
+		* always cold started (see nextSolveWarm).
+		* The warm start is reset when the problem size change
+		* (QPSolver::nrVars and QPSolver::updateConstrSize) or when a solve fail.
+		* @see GenQPSolver::warmStart
+		*/
+	void warmStart(bool warm);
+	/// @return Warm start setting.
+	bool warmStart() const;
+	/**
+		* @return true if the next solve will be warm started,
+		* always false with a solver that don't support warm start (QLD).
+		*/
+	bool nextSolveWarm() const;
+	/// Cold start the next solve.
+	void resetWarmStart();
+
+	/**
+		* Update the body jacobians, robot dynamics, tasks and constraints
+		* in parallel.
+		* Threads are created here and reused at each solve.
+		* Each task and constraint update must only modify its own data,
+		* tasks that share a HighLevelTask (see Task::highLevelTask) are
+		* updated sequentially by the same thread.
+		* @param nrThreads Number of threads that update the tasks and
+		* constraints (including the calling thread), 1 to update them
+		* sequentially (default).
+		* @param cpus CPU of each created thread, empty to not pin them.
+		*/
+	void nrThreads(int nrThreads, const std::vector<int>& cpus=std::vector<int>());
+	int nrThreads() const;
+
 	const SolverData& data() const;
 	SolverData& data();
 
-	const Eigen::VectorXd& result() const;
-	Eigen::VectorXd alphaDVec() const;
-	Eigen::VectorXd alphaDVec(int rIndex) const;
-
-	Eigen::VectorXd lambdaVec() const;
-	Eigen::VectorXd lambdaVec(int cIndex) const;
+	/// @return View on the QP solution, alphaD then lambda (no copy).
+	Eigen::Ref<const Eigen::VectorXd> result() const;
+	/// @return View on the result part associated with alphaD (no copy).
+	Eigen::Ref<const Eigen::VectorXd> alphaDVec() const;
+	Eigen::Ref<const Eigen::VectorXd> alphaDVec(int rIndex) const;
+
+	/// @return View on the result part associated with lambda (no copy).
+	Eigen::Ref<const Eigen::VectorXd> lambdaVec() const;
+	/**
+		* @return View on the contact cIndex lambda (no copy).
+		* A ContactModel::Wrench contact lambda is the wrench at the contact
+		* surface center in the surface frame.
+		* @see UnilateralContact::wrench
+		*/
+	Eigen::Ref<const Eigen::VectorXd> lambdaVec(int cIndex) const;
 
 	int contactLambdaPosition(const ContactId& cId) const;
 
 	boost::timer::cpu_times solveTime() const;
 	boost::timer::cpu_times solveAndBuildTime() const;
 
+	/**
+		* Enable or disable the measure of each solve step.
+		* When enabled, each solve records the update time of each task and
+		* constraint and the time of each step of QPSolver::solveNoMbcUpdate.
+		* @param nrTicks Number of solves kept by each TimeRecord.
+		* Records are reset by this call.
+		*/
+	void timing(bool enable, int nrTicks=1000);
+	bool timing() const;
+
+	/**
+		* @return Task update time.
+		* @throw std::domain_error If task is not in the solver.
+		*/
+	const TimeRecord& taskTime(Task* task) const;
+	/**
+		* @return Constraint update time.
+		* @throw std::domain_error If constr is not in the solver.
+		*/
+	const TimeRecord& constraintTime(Constraint* constr) const;
+	/// SolverData update time (normal accelerations and body jacobians).
+	const TimeRecord& dataTime() const;
+	/// QP matrices construction time from tasks and constraints.
+	const TimeRecord& matrixTime() const;
+	/// Time of the QP solver (GenQPSolver::solve).
+	const TimeRecord& qpTime() const;
+	/// Time of the whole QPSolver::solveNoMbcUpdate.
+	const TimeRecord& totalTime() const;
+
 protected:
 	void preUpdate(const std::vector<rbd::MultiBody>& mbs,
 								const std::vector<rbd::MultiBodyConfig>& mbcs);
@@ -148,6 +368,27 @@ protected:
 		bool success);
 
 private:
+	/// compute lambda offsets, contact index and nrVars from the contacts
+	void updateContacts();
+	/// reserve the contacts storage for the lambda capacity
+	void reserveContacts();
+	/// update the contact users after a contact change
+	void updateContactsNrVars(const std::vector<rbd::MultiBody>& mbs);
+	/// register the body jacobians of all tasks and constraints again,
+	/// the others are unregistered
+	void registerBodyJacobians(const std::vector<rbd::MultiBody>& mbs);
+	/// group the tasks that share a high level task
+	void updateTaskGroups();
+	/// call registerData and updateNrVars on obj and record in users
+	/// if it depends on the contacts
+	template<typename T>
+	void updateNrVars(const std::vector<rbd::MultiBody>& mbs, T* obj,
+		std::vector<T*>& users);
+	/// compute the QP solver number of lines from the constraints
+	void computeMaxLines();
+	/// reserve the QP solver buffers for the reserved problem size
+	void reserveSolver();
+
 	std::vector<Constraint*> constr_;
 	std::vector<Equality*> eqConstr_;
 	std::vector<Inequality*> inEqConstr_;
@@ -156,13 +397,39 @@ private:
 
 	std::vector<Task*> tasks_;
 
+	std::vector<TargetBufferBase*> targetBuffers_;
+
+	/// tasks and constraints that depend on the contacts
+	std::vector<Constraint*> contactConstr_;
+	std::vector<Task*> contactTasks_;
+	/// a task or a constraint has been removed since the last registration
+	bool bodyJacsOutdated_;
+	/// tasks_ indices sorted by group, tasks that share a high level task
+	/// are in the same group
+	std::vector<int> taskGroups_;
+	/// taskGroups_ index of each group first task followed by its size
+	std::vector<int> taskGroupBegin_;
+	/// a task has been added or removed since the last grouping
+	bool taskGroupsOutdated_;
+
 	SolverData data_;
+	int reservedVars_, reservedEq_, reservedInEq_, reservedGenInEq_;
+	int lambdaCapacity_;
 
 	int maxEqLines_, maxInEqLines_, maxGenInEqLines_;
 
 	std::unique_ptr<GenQPSolver> solver_;
+	/// warm start setting, applied again when the solver change
+	bool warmStart_;
+	std::unique_ptr<ThreadPool> pool_;
 
 	boost::timer::cpu_timer solverTimer_, solverAndBuildTimer_;
+
+	bool timing_;
+	int nrTicks_;
+	/// update time of each element of constr_ and tasks_
+	std::vector<TimeRecord> constrTimes_, taskTimes_;
+	TimeRecord dataTime_, matrixTime_, qpTime_, totalTime_;
 };
 
 
@@ -171,6 +438,16 @@ class Constraint
 {
 public:
 	virtual ~Constraint() {}
+
+	/**
+		* Register the body jacobians and robot dynamics used by the
+		* constraint and its dependency on the contacts in data.
+		* Called by QPSolver before each updateNrVars call.
+		*/
+	virtual void registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+		SolverData& /* data */)
+	{}
+
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& msb,
 		const SolverData& data) = 0;
 
@@ -238,6 +515,28 @@ public:
 	virtual const Eigen::MatrixXd& AEq() const = 0;
 	virtual const Eigen::VectorXd& bEq() const = 0;
 
+	/**
+		* Columns of AEq that can be non zero, other columns are structural zeros
+		* and are not copied in the QP matrices.
+		* @return Sorted column block list or an empty list if all columns
+		* can be non zero.
+		*/
+	virtual const std::vector<ColBlock>& AEqBlocks() const
+	{
+		return denseColBlocks();
+	}
+
+	/**
+		* Version of AEq and bEq.
+		* The solver only copies the constraint again when the version change.
+		* @return A positive number that change each time AEq and bEq change
+		* or a negative number if they can change at each update (default).
+		*/
+	virtual int versionEq() const
+	{
+		return -1;
+	}
+
 	virtual std::string nameEq() const = 0;
 	virtual std::string descEq(const std::vector<rbd::MultiBody>& mbs,
 		int i) = 0;
@@ -265,6 +564,28 @@ public:
 	virtual const Eigen::MatrixXd& AInEq() const = 0;
 	virtual const Eigen::VectorXd& bInEq() const = 0;
 
+	/**
+		* Columns of AInEq that can be non zero, other columns are structural zeros
+		* and are not copied in the QP matrices.
+		* @return Sorted column block list or an empty list if all columns
+		* can be non zero.
+		*/
+	virtual const std::vector<ColBlock>& AInEqBlocks() const
+	{
+		return denseColBlocks();
+	}
+
+	/**
+		* Version of AInEq and bInEq.
+		* The solver only copies the constraint again when the version change.
+		* @return A positive number that change each time AInEq and bInEq change
+		* or a negative number if they can change at each update (default).
+		*/
+	virtual int versionInEq() const
+	{
+		return -1;
+	}
+
 	virtual std::string nameInEq() const = 0;
 	virtual std::string descInEq(const std::vector<rbd::MultiBody>& mbs,
 		int i) = 0;
@@ -293,6 +614,28 @@ public:
 	virtual const Eigen::VectorXd& LowerGenInEq() const = 0;
 	virtual const Eigen::VectorXd& UpperGenInEq() const = 0;
 
+	/**
+		* Columns of AGenInEq that can be non zero, other columns are structural zeros
+		* and are not copied in the QP matrices.
+		* @return Sorted column block list or an empty list if all columns
+		* can be non zero.
+		*/
+	virtual const std::vector<ColBlock>& AGenInEqBlocks() const
+	{
+		return denseColBlocks();
+	}
+
+	/**
+		* Version of AGenInEq, LowerGenInEq and UpperGenInEq.
+		* The solver only copies the constraint again when the version change.
+		* @return A positive number that change each time AGenInEq, LowerGenInEq and UpperGenInEq change
+		* or a negative number if they can change at each update (default).
+		*/
+	virtual int versionGenInEq() const
+	{
+		return -1;
+	}
+
 	virtual std::string nameGenInEq() const = 0;
 	virtual std::string descGenInEq(const std::vector<rbd::MultiBody>& mbs,
 		int i) = 0;
@@ -316,9 +659,25 @@ public:
 	virtual ~Bound() {}
 	virtual int beginVar() const = 0;
 
+	/**
+		* Bounds of the variables from beginVar.
+		* They can go up to SolverData::maxNrVars, the variables
+		* after SolverData::nrVars are ignored.
+		*/
 	virtual const Eigen::VectorXd& Lower() const = 0;
 	virtual const Eigen::VectorXd& Upper() const = 0;
 
+	/**
+		* Version of Lower and Upper.
+		* The solver only copies the constraint again when the version change.
+		* @return A positive number that change each time Lower and Upper change
+		* or a negative number if they can change at each update (default).
+		*/
+	virtual int versionBound() const
+	{
+		return -1;
+	}
+
 	virtual std::string nameBound() const = 0;
 	virtual std::string descBound(const std::vector<rbd::MultiBody>& mbs, int i) = 0;
 
@@ -335,6 +694,22 @@ public:
 
 
 
+/**
+	* Structure of the Q matrix of a Task.
+	* n is the task dimension (C size) and Task::Q return a matrix
+	* that depend on the structure.
+	*/
+enum class QStructure
+{
+	Dense, ///< Q is fully computed.
+	Lower, ///< Only the lower triangular part of Q is computed.
+	Diagonal, ///< Q is diagonal, Task::Q return its n×1 diagonal.
+	ScaledIdentity, ///< Q is s·I, Task::Q return the 1×1 matrix s.
+	Factor ///< Q is F^T·F, Task::Q return the m×n matrix F.
+};
+
+
+
 class Task
 {
 public:
@@ -355,15 +730,89 @@ public:
 
 	virtual std::pair<int, int> begin() const = 0;
 
+	/**
+		* Register the body jacobians and robot dynamics used by the
+		* task and its dependency on the contacts in data.
+		* Called by QPSolver before each updateNrVars call.
+		*/
+	virtual void registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+		SolverData& /* data */)
+	{}
+
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data) = 0;
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data) = 0;
 
+	/**
+		* High level task updated in update.
+		* Tasks that share a high level task are updated by the same thread
+		* when QPSolver update the tasks in parallel.
+		* @return nullptr if the task don't update a high level task (default).
+		*/
+	virtual HighLevelTask* highLevelTask() const
+	{
+		return nullptr;
+	}
+
+	/**
+		* Task matrix in the form given by structureQ, restricted to the
+		* QBlocks columns.
+		* The full task matrix is only the returned one when structureQ is
+		* QStructure::Dense and QBlocks is empty.
+		* Q must then always be read with structureQ and QBlocks,
+		* use denseQ to get the symmetric task matrix.
+		*/
 	virtual const Eigen::MatrixXd& Q() const = 0;
+	/// Task vector restricted to the QBlocks columns.
 	virtual const Eigen::VectorXd& C() const = 0;
 
+	/**
+		* Version of the Q matrix.
+		* Q of tasks with a positive version is summed once and only summed
+		* again when the version, the weight or the position of the task change.
+		* @return A positive number that change each time Q change
+		* or a negative number if Q can change at each update (default).
+		*/
+	virtual int versionQ() const
+	{
+		return -1;
+	}
+
+	/**
+		* Q must be symmetric and is placed on the diagonal of the QP \f$ Q \f$
+		* matrix so only its lower triangular part is summed.
+		* Diagonal, ScaledIdentity and Factor structures let the QP solvers
+		* sum Q without a dense n×n matrix.
+		* @return QStructure::Lower if the upper triangular part of Q
+		* is not computed.
+		*/
+	virtual QStructure structureQ() const
+	{
+		return QStructure::Dense;
+	}
+
+	/**
+		* Columns of the task variables (starting from begin) mapped by Q and C.
+		* Q and C are the concatenation of these blocks rows and columns,
+		* others are null.
+		* @return Sorted column block list or an empty list if Q and C
+		* map all the columns.
+		*/
+	virtual const std::vector<ColBlock>& QBlocks() const
+	{
+		return denseColBlocks();
+	}
+
+	/**
+		* Expand Q from structureQ into the full symmetric task matrix.
+		* The returned matrix is still restricted to the QBlocks columns.
+		* Allocate a n×n matrix, intended for inspection and bindings,
+		* the QP solvers read Q directly.
+		*/
+	Eigen::MatrixXd denseQ() const;
+
 private:
 	double weight_;
 };
@@ -377,14 +826,51 @@ public:
 
 	virtual int dim() = 0;
 
+	/**
+		* Register the body jacobians used by the high level task in data.
+		* Called by the Task that own it in its registerData.
+		*/
+	virtual void registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+		SolverData& /* data */)
+	{}
+
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data) = 0;
 
+	/**
+		* High level task updated in update (see Task::highLevelTask).
+		* @return nullptr if the task don't wrap a high level task (default).
+		*/
+	virtual HighLevelTask* highLevelTask() const
+	{
+		return nullptr;
+	}
+
 	virtual const Eigen::MatrixXd& jac() = 0;
 	virtual const Eigen::VectorXd& eval() = 0;
 	virtual const Eigen::VectorXd& speed() = 0;
 	virtual const Eigen::VectorXd& normalAcc() = 0;
+
+	/**
+		* Jacobian restricted to the robot dof in jacBlocks.
+		* @return jac() by default.
+		*/
+	virtual const Eigen::MatrixXd& shortJac()
+	{
+		return jac();
+	}
+
+	/**
+		* Robot dof mapped by shortJac columns.
+		* Must not change after construction.
+		* @return Sorted column block list or an empty list if shortJac
+		* is the full jacobian (default).
+		*/
+	virtual const std::vector<ColBlock>& jacBlocks()
+	{
+		return denseColBlocks();
+	}
 };
 
 
@@ -17,6 +17,10 @@
 #include "QPSolverData.h"
 
 // includes
+// std
+#include <sstream>
+#include <stdexcept>
+
 // RBDyn
 #include <RBDyn/MultiBody.h>
 #include <RBDyn/MultiBodyConfig.h>
@@ -28,6 +32,58 @@ namespace tasks
 namespace qp
 {
 
+
+/**
+	*													BodyJacobian
+	*/
+
+
+BodyJacobian::BodyJacobian(const rbd::MultiBody& mb, int robotIndex, int bodyId):
+	robotIndex_(robotIndex),
+	bodyIndex_(mb.bodyIndexById(bodyId)),
+	jac_(mb, bodyId),
+	bodyJac_(6, jac_.dof()),
+	registered_(true)
+{}
+
+
+void BodyJacobian::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc)
+{
+	bodyJac_ = jac_.bodyJacobian(mb, mbc);
+}
+
+
+/**
+	*													RobotDynamics
+	*/
+
+
+RobotDynamics::RobotDynamics(const rbd::MultiBody& mb, int robotIndex):
+	robotIndex_(robotIndex),
+	fd_(mb),
+	computeHLLT_(false),
+	HLLT_(mb.nrDof())
+{}
+
+
+void RobotDynamics::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc)
+{
+	fd_.computeH(mb, mbc);
+	fd_.computeC(mb, mbc);
+	if(computeHLLT_)
+	{
+		HLLT_.compute(fd_.H());
+	}
+}
+
+
+/**
+	*													SolverData
+	*/
+
+
 SolverData::SolverData():
 	alphaD_(),
 	alphaDBegin_(),
@@ -37,39 +93,176 @@ SolverData::SolverData():
 	nrUniLambda_(0),
 	nrBiLambda_(0),
 	nrVars_(0),
+	maxNrVars_(0),
 	uniCont_(),
 	biCont_(),
 	allCont_(),
+	uniSpare_(),
+	biSpare_(),
+	allSpare_(),
+	contactIndex_(),
 	mobileRobotIndex_(),
-	normalAccB_()
+	normalAccB_(),
+	bodyJacs_(),
+	robotDyns_(),
+	contactsUsed_(false)
 {}
 
 
+int SolverData::contactIndex(const ContactId& cId) const
+{
+	auto it = contactIndex_.find(cId);
+	return it != contactIndex_.end() ? it->second : -1;
+}
+
+
 void SolverData::computeNormalAccB(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs)
 {
 	// we just need to update mobile robot normal acceleration
 	for(int r: mobileRobotIndex_)
 	{
-		const rbd::MultiBody& mb = mbs[r];
-		const rbd::MultiBodyConfig& mbc = mbcs[r];
-		std::vector<sva::MotionVecd>& normalAccBr = normalAccB_[r];
+		computeNormalAccB(mbs, mbcs, r);
+	}
+}
+
+
+void SolverData::computeNormalAccB(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs, int robotIndex)
+{
+	const rbd::MultiBody& mb = mbs[robotIndex];
+	const rbd::MultiBodyConfig& mbc = mbcs[robotIndex];
+	std::vector<sva::MotionVecd>& normalAccBr = normalAccB_[robotIndex];
+
+	const std::vector<int>& pred = mb.predecessors();
+	const std::vector<int>& succ = mb.successors();
+
+	for(int i = 0; i < mb.nrJoints(); ++i)
+	{
+		const sva::PTransformd& X_p_i = mbc.parentToSon[i];
+		const sva::MotionVecd& vj_i = mbc.jointVelocity[i];
+		const sva::MotionVecd& vb_i = mbc.bodyVelB[i];
+
+		if(pred[i] != -1)
+			normalAccBr[succ[i]] = X_p_i*normalAccBr[pred[i]] + vb_i.cross(vj_i);
+		else
+			normalAccBr[succ[i]] = vb_i.cross(vj_i);
+	}
+}
 
-		const std::vector<int>& pred = mb.predecessors();
-		const std::vector<int>& succ = mb.successors();
 
-		for(int i = 0; i < mb.nrJoints(); ++i)
+int SolverData::addBodyJacobian(const std::vector<rbd::MultiBody>& mbs,
+	int robotIndex, int bodyId)
+{
+	int bodyIndex = mbs[robotIndex].bodyIndexById(bodyId);
+	for(std::size_t i = 0; i < bodyJacs_.size(); ++i)
+	{
+		if(bodyJacs_[i].robotIndex() == robotIndex &&
+			 bodyJacs_[i].bodyIndex() == bodyIndex)
 		{
-			const sva::PTransformd& X_p_i = mbc.parentToSon[i];
-			const sva::MotionVecd& vj_i = mbc.jointVelocity[i];
-			const sva::MotionVecd& vb_i = mbc.bodyVelB[i];
-
-			if(pred[i] != -1)
-				normalAccBr[succ[i]] = X_p_i*normalAccBr[pred[i]] + vb_i.cross(vj_i);
-			else
-				normalAccBr[succ[i]] = vb_i.cross(vj_i);
+			bodyJacs_[i].registered_ = true;
+			return int(i);
 		}
 	}
+
+	bodyJacs_.emplace_back(mbs[robotIndex], robotIndex, bodyId);
+	return int(bodyJacs_.size()) - 1;
+}
+
+
+int SolverData::bodyJacobianIndex(const std::vector<rbd::MultiBody>& mbs,
+	int robotIndex, int bodyId) const
+{
+	int bodyIndex = mbs[robotIndex].bodyIndexById(bodyId);
+	for(std::size_t i = 0; i < bodyJacs_.size(); ++i)
+	{
+		if(bodyJacs_[i].registered() &&
+			 bodyJacs_[i].robotIndex() == robotIndex &&
+			 bodyJacs_[i].bodyIndex() == bodyIndex)
+		{
+			return int(i);
+		}
+	}
+
+	std::ostringstream str;
+	str << "The jacobian of the body " << bodyId << " of the robot "
+			<< robotIndex << " is not registered";
+	throw std::domain_error(str.str());
+}
+
+
+void SolverData::computeBodyJacobians(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs)
+{
+	for(BodyJacobian& bj: bodyJacs_)
+	{
+		if(bj.registered())
+		{
+			bj.update(mbs[bj.robotIndex()], mbcs[bj.robotIndex()]);
+		}
+	}
+}
+
+
+void SolverData::unregisterBodyJacobians()
+{
+	for(BodyJacobian& bj: bodyJacs_)
+	{
+		bj.registered_ = false;
+	}
+}
+
+
+int SolverData::addRobotDynamics(const std::vector<rbd::MultiBody>& mbs,
+	int robotIndex, bool HLLT)
+{
+	int index = -1;
+	for(std::size_t i = 0; i < robotDyns_.size(); ++i)
+	{
+		if(robotDyns_[i].robotIndex() == robotIndex)
+		{
+			index = int(i);
+			break;
+		}
+	}
+
+	if(index == -1)
+	{
+		robotDyns_.emplace_back(mbs[robotIndex], robotIndex);
+		index = int(robotDyns_.size()) - 1;
+	}
+
+	if(HLLT)
+	{
+		robotDyns_[index].computeHLLT();
+	}
+	return index;
+}
+
+
+int SolverData::robotDynamicsIndex(int robotIndex) const
+{
+	for(std::size_t i = 0; i < robotDyns_.size(); ++i)
+	{
+		if(robotDyns_[i].robotIndex() == robotIndex)
+		{
+			return int(i);
+		}
+	}
+
+	std::ostringstream str;
+	str << "The dynamics of the robot " << robotIndex << " is not registered";
+	throw std::domain_error(str.str());
+}
+
+
+void SolverData::computeRobotDynamics(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs)
+{
+	for(RobotDynamics& rd: robotDyns_)
+	{
+		rd.update(mbs[rd.robotIndex()], mbcs[rd.robotIndex()]);
+	}
 }
 
 } // namespace qp
@@ -16,9 +16,19 @@
 #pragma once
 
 // includes
+// std
+#include <unordered_map>
+
+// Eigen
+#include <Eigen/Cholesky>
+
 // SpaceVecAlg
 #include <SpaceVecAlg/SpaceVecAlg>
 
+// RBDyn
+#include <RBDyn/FD.h>
+#include <RBDyn/Jacobian.h>
+
 // Tasks
 #include "QPContacts.h"
 
@@ -37,6 +47,120 @@ namespace qp
 {
 
 
+/**
+	* Jacobian of a body at its origin.
+	* Computed once at each QPSolver update and shared by all tasks
+	* and constraints that registered it with SolverData::addBodyJacobian
+	* in their registerData.
+	* The body velocity and normal acceleration are already shared by
+	* rbd::MultiBodyConfig::bodyVelB and SolverData::normalAccB,
+	* users only move them to their point.
+	*/
+class BodyJacobian
+{
+public:
+	friend class SolverData;
+
+	BodyJacobian(const rbd::MultiBody& mb, int robotIndex, int bodyId);
+
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
+
+	int robotIndex() const
+	{
+		return robotIndex_;
+	}
+
+	int bodyIndex() const
+	{
+		return bodyIndex_;
+	}
+
+	/// Jacobian object, give the joints path and fullJacobian.
+	const rbd::Jacobian& jac() const
+	{
+		return jac_;
+	}
+
+	/// Jacobian in body coordinates at the body origin.
+	const Eigen::MatrixXd& bodyJac() const
+	{
+		return bodyJac_;
+	}
+
+	/**
+		* false if no task or constraint registered this body at the last
+		* registration, the jacobian is then not computed anymore.
+		*/
+	bool registered() const
+	{
+		return registered_;
+	}
+
+private:
+	int robotIndex_, bodyIndex_;
+	rbd::Jacobian jac_;
+	Eigen::MatrixXd bodyJac_;
+	bool registered_;
+};
+
+
+
+/**
+	* Inertia matrix H and non linear effects vector C of a robot.
+	* Computed once at each QPSolver update and shared by all tasks
+	* and constraints that registered it with SolverData::addRobotDynamics
+	* in their registerData.
+	*/
+class RobotDynamics
+{
+public:
+	RobotDynamics(const rbd::MultiBody& mb, int robotIndex);
+
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
+
+	int robotIndex() const
+	{
+		return robotIndex_;
+	}
+
+	/// ForwardDynamics object, give the H and C matrix.
+	const rbd::ForwardDynamics& fd() const
+	{
+		return fd_;
+	}
+
+	const Eigen::MatrixXd& H() const
+	{
+		return fd_.H();
+	}
+
+	const Eigen::VectorXd& C() const
+	{
+		return fd_.C();
+	}
+
+	/// Compute the H Cholesky decomposition at each update.
+	void computeHLLT()
+	{
+		computeHLLT_ = true;
+	}
+
+	/// Cholesky decomposition of H, only computed if requested
+	/// with SolverData::addRobotDynamics.
+	const Eigen::LLT<Eigen::MatrixXd>& HLLT() const
+	{
+		return HLLT_;
+	}
+
+private:
+	int robotIndex_;
+	rbd::ForwardDynamics fd_;
+	bool computeHLLT_;
+	Eigen::LLT<Eigen::MatrixXd> HLLT_;
+};
+
+
+
 class SolverData
 {
 public:
@@ -49,6 +173,17 @@ public:
 		return nrVars_;
 	}
 
+	/**
+		* Number of columns of the constraint matrices.
+		* Columns after nrVars are always zero and are not copied in the QP,
+		* they let contacts be added up to QPSolver::lambdaCapacity
+		* without resizing the constraints (see QPSolver::reserve).
+		*/
+	int maxNrVars() const
+	{
+		return maxNrVars_;
+	}
+
 	int totalAlphaD() const
 	{
 		return totalAlphaD_;
@@ -106,7 +241,7 @@ public:
 
 	int bilateralBegin() const
 	{
-		return unilateralBegin() + nrUniLambda_;
+		return unilateralBegin() + nrUniLambda();
 	}
 
 	int nrContacts() const
@@ -129,6 +264,15 @@ public:
 		return allCont_;
 	}
 
+	/**
+		* @param cId Contact id.
+		* @return Index of the contact in allContacts (to give to lambda and
+		* lambdaBegin) or -1 if there is no contact with this id.
+		* Unilateral contacts come first so the contact is bilateral if its
+		* index is greater or equal to unilateralContacts size.
+		*/
+	int contactIndex(const ContactId& cId) const;
+
 	void computeNormalAccB(const std::vector<rbd::MultiBody>& mbs,
 												const std::vector<rbd::MultiBodyConfig>& mbcs);
 
@@ -142,6 +286,101 @@ public:
 		return normalAccB_[robotIndex];
 	}
 
+	/**
+		* Register a body so its jacobian is computed once at each update.
+		* Must be called in Task::registerData or Constraint::registerData,
+		* registrations are cleared by QPSolver::nrVars.
+		* QPSolver::addContact, QPSolver::removeContact, QPSolver::updateNrVars
+		* and the solve that follow a task or constraint removal unregister all
+		* the body jacobians before calling registerData again, the unregistered
+		* jacobians are kept in memory but are not computed anymore.
+		* @param robotIndex Index of the body robot.
+		* @param bodyId Body id.
+		* @return Index of the body jacobian to give to bodyJacobian.
+		*/
+	int addBodyJacobian(const std::vector<rbd::MultiBody>& mbs, int robotIndex,
+		int bodyId);
+
+	/**
+		* @return Index of a body jacobian registered with addBodyJacobian.
+		* @throw std::domain_error If the body jacobian is not registered
+		* or has been unregistered.
+		*/
+	int bodyJacobianIndex(const std::vector<rbd::MultiBody>& mbs, int robotIndex,
+		int bodyId) const;
+
+	const BodyJacobian& bodyJacobian(int index) const
+	{
+		return bodyJacs_[index];
+	}
+
+	/**
+		* @param index Index returned by addBodyJacobian.
+		* @return Body jacobian at index if it's the jacobian of the body
+		* bodyIndex of the robot robotIndex, nullptr otherwise
+		* (registered in another solver, unregistered or not registered at all).
+		*/
+	const BodyJacobian* bodyJacobian(int index, int robotIndex,
+		int bodyIndex) const
+	{
+		if(index >= 0 && index < int(bodyJacs_.size()) &&
+			 bodyJacs_[index].registered() &&
+			 bodyJacs_[index].robotIndex() == robotIndex &&
+			 bodyJacs_[index].bodyIndex() == bodyIndex)
+		{
+			return &bodyJacs_[index];
+		}
+		return nullptr;
+	}
+
+	void computeBodyJacobians(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs);
+
+	/**
+		* Register a robot so its inertia matrix and non linear effects
+		* are computed once at each update.
+		* Must be called in Task::registerData or Constraint::registerData,
+		* registrations are cleared by QPSolver::nrVars.
+		* @param robotIndex Index of the robot.
+		* @param HLLT Also compute the Cholesky decomposition of H.
+		* @return Index of the robot dynamics to give to robotDynamics.
+		*/
+	int addRobotDynamics(const std::vector<rbd::MultiBody>& mbs, int robotIndex,
+		bool HLLT=false);
+
+	/**
+		* @return Index of a robot dynamics registered with addRobotDynamics.
+		* @throw std::domain_error If the robot dynamics is not registered.
+		*/
+	int robotDynamicsIndex(int robotIndex) const;
+
+	const RobotDynamics& robotDynamics(int index) const
+	{
+		return robotDyns_[index];
+	}
+
+	void computeRobotDynamics(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs);
+
+	/**
+		* Declare that the caller updateNrVars read the contacts.
+		* Must be called in Task::registerData or Constraint::registerData
+		* so QPSolver::addContact and QPSolver::removeContact call
+		* its updateNrVars again.
+		*/
+	void dependOnContacts()
+	{
+		contactsUsed_ = true;
+	}
+
+private:
+	/// compute the normal acceleration of one mobile robot
+	void computeNormalAccB(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs, int robotIndex);
+	/// keep the body jacobians in memory but stop computing them
+	/// until they are registered again
+	void unregisterBodyJacobians();
+
 private:
 	std::vector<int> alphaD_; //< each robot alphaD vector size
 	std::vector<int> alphaDBegin_; //< each robot alphaD vector begin in x
@@ -150,14 +389,31 @@ private:
 	int totalAlphaD_, totalLambda_;
 	int nrUniLambda_, nrBiLambda_;
 	int nrVars_; //< total number of var
+	int maxNrVars_; //< number of columns of the constraint matrices
 
 	std::vector<UnilateralContact> uniCont_;
 	std::vector<BilateralContact> biCont_;
 	std::vector<BilateralContact> allCont_;
+	/// removed contacts, their memory is reused by QPSolver::addContact
+	std::vector<UnilateralContact> uniSpare_;
+	std::vector<BilateralContact> biSpare_, allSpare_;
+	/**
+		* allCont_ index of each contact id, built by QPSolver::nrVars.
+		* Ids of removed contacts are kept with the -1 index
+		* so they can be added again without allocating memory.
+		*/
+	std::unordered_map<ContactId, int> contactIndex_;
 
 	std::vector<int> mobileRobotIndex_; //< robot index with dof > 0
 	/// normal acceleration of each body of each robot
 	std::vector<std::vector<sva::MotionVecd>> normalAccB_;
+	/// body jacobians registered by registerData
+	std::vector<BodyJacobian> bodyJacs_;
+	/// robot dynamics registered by registerData
+	std::vector<RobotDynamics> robotDyns_;
+	/// reset by QPSolver before a registerData call to know if
+	/// the task or the constraint depend on the contacts
+	bool contactsUsed_;
 };
 
 
@@ -20,6 +20,7 @@
 // std
 #include <cmath>
 #include <set>
+#include <stdexcept>
 
 // Eigen
 #include <Eigen/Geometry>
@@ -35,6 +36,25 @@ namespace qp
 {
 
 
+/// Number of columns of the HighLevelTask short jacobian.
+static int shortJacCols(const rbd::MultiBody& mb, HighLevelTask* hlTask)
+{
+	const std::vector<ColBlock>& blocks = hlTask->jacBlocks();
+	return blocks.empty() ? mb.nrDof() : colBlocksSize(blocks);
+}
+
+
+/// Throw if a dimension weight is negative since its square root is used.
+static const Eigen::VectorXd& checkDimWeight(const Eigen::VectorXd& dimWeight)
+{
+	if((dimWeight.array() < 0.).any())
+	{
+		throw std::domain_error("dimWeight must not have negative entries");
+	}
+	return dimWeight;
+}
+
+
 /**
 	*														SetPointTaskCommon
 	*/
@@ -48,11 +68,12 @@ SetPointTaskCommon::SetPointTaskCommon(const std::vector<rbd::MultiBody>& mbs,
 	hlTask_(hlTask),
 	error_(hlTask->dim()),
 	dimWeight_(Eigen::VectorXd::Ones(hlTask->dim())),
+	dimWeightSqrt_(Eigen::VectorXd::Ones(hlTask->dim())),
 	robotIndex_(rI),
 	alphaDBegin_(0),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
-	C_(mbs[rI].nrDof()),
-	preQ_(hlTask->dim(), mbs[rI].nrDof()),
+	Q_(shortJacCols(mbs[rI], hlTask), shortJacCols(mbs[rI], hlTask)),
+	C_(shortJacCols(mbs[rI], hlTask)),
+	preQ_(hlTask->dim(), shortJacCols(mbs[rI], hlTask)),
 	preC_(hlTask->dim())
 {}
 
@@ -64,19 +85,28 @@ SetPointTaskCommon::SetPointTaskCommon(const std::vector<rbd::MultiBody>& mbs,
 	Task(weight),
 	hlTask_(hlTask),
 	error_(hlTask->dim()),
-	dimWeight_(dimWeight),
+	dimWeight_(checkDimWeight(dimWeight)),
+	dimWeightSqrt_(dimWeight.cwiseSqrt()),
 	robotIndex_(rI),
 	alphaDBegin_(0),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
-	C_(mbs[rI].nrDof()),
-	preQ_(hlTask->dim(), mbs[rI].nrDof()),
+	Q_(shortJacCols(mbs[rI], hlTask), shortJacCols(mbs[rI], hlTask)),
+	C_(shortJacCols(mbs[rI], hlTask)),
+	preQ_(hlTask->dim(), shortJacCols(mbs[rI], hlTask)),
 	preC_(hlTask->dim())
 {}
 
 
 void SetPointTaskCommon::dimWeight(const Eigen::VectorXd& dim)
 {
-	dimWeight_ = dim;
+	dimWeight_ = checkDimWeight(dim);
+	dimWeightSqrt_ = dim.cwiseSqrt();
+}
+
+
+void SetPointTaskCommon::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	hlTask_->registerData(mbs, data);
 }
 
 
@@ -89,15 +119,17 @@ void SetPointTaskCommon::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs
 
 void SetPointTaskCommon::computeQC(Eigen::VectorXd& error)
 {
-	const Eigen::MatrixXd& J = hlTask_->jac();
+	const Eigen::MatrixXd& J = hlTask_->shortJac();
 	const Eigen::VectorXd& normalAcc = hlTask_->normalAcc();
 
 	error.noalias() -= normalAcc;
 	preC_.noalias() = dimWeight_.asDiagonal()*error;
 	C_.noalias() = -J.transpose()*preC_;
 
-	preQ_.noalias() = dimWeight_.asDiagonal()*J;
-	Q_.noalias() = J.transpose()*preQ_;
+	// Q = J^T W J = (W^{1/2} J)^T (W^{1/2} J) as a rank k update
+	preQ_.noalias() = dimWeightSqrt_.asDiagonal()*J;
+	Q_.triangularView<Eigen::Lower>().setZero();
+	Q_.selfadjointView<Eigen::Lower>().rankUpdate(preQ_.transpose());
 }
 
 
@@ -113,6 +145,18 @@ const Eigen::VectorXd& SetPointTaskCommon::C() const
 }
 
 
+QStructure SetPointTaskCommon::structureQ() const
+{
+	return QStructure::Lower;
+}
+
+
+const std::vector<ColBlock>& SetPointTaskCommon::QBlocks() const
+{
+	return hlTask_->jacBlocks();
+}
+
+
 /**
 	*														SetPointTask
 	*/
@@ -407,13 +451,14 @@ TargetObjectiveTask::TargetObjectiveTask(const std::vector<rbd::MultiBody>& mbs,
 	dt_(timeStep),
 	objDot_(objDot),
 	dimWeight_(Eigen::VectorXd::Ones(hlTask->dim())),
+	dimWeightSqrt_(Eigen::VectorXd::Ones(hlTask->dim())),
 	robotIndex_(rI),
 	alphaDBegin_(0),
 	phi_(hlTask->dim()),
 	psi_(hlTask->dim()),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
-	C_(mbs[rI].nrDof()),
-	preQ_(hlTask->dim(), mbs[rI].nrDof()),
+	Q_(shortJacCols(mbs[rI], hlTask), shortJacCols(mbs[rI], hlTask)),
+	C_(shortJacCols(mbs[rI], hlTask)),
+	preQ_(hlTask->dim(), shortJacCols(mbs[rI], hlTask)),
 	CVecSum_(hlTask->dim()),
 	preC_(hlTask->dim())
 {
@@ -429,14 +474,15 @@ TargetObjectiveTask::TargetObjectiveTask(const std::vector<rbd::MultiBody>& mbs,
 	hlTask_(hlTask),
 	dt_(timeStep),
 	objDot_(objDot),
-	dimWeight_(dimWeight),
+	dimWeight_(checkDimWeight(dimWeight)),
+	dimWeightSqrt_(dimWeight.cwiseSqrt()),
 	robotIndex_(rI),
 	alphaDBegin_(0),
 	phi_(hlTask->dim()),
 	psi_(hlTask->dim()),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
-	C_(mbs[rI].nrDof()),
-	preQ_(hlTask->dim(), mbs[rI].nrDof()),
+	Q_(shortJacCols(mbs[rI], hlTask), shortJacCols(mbs[rI], hlTask)),
+	C_(shortJacCols(mbs[rI], hlTask)),
+	preQ_(hlTask->dim(), shortJacCols(mbs[rI], hlTask)),
 	CVecSum_(hlTask->dim()),
 	preC_(hlTask->dim())
 {
@@ -457,6 +503,20 @@ void TargetObjectiveTask::duration(double d)
 }
 
 
+void TargetObjectiveTask::dimWeight(const Eigen::VectorXd& dim)
+{
+	dimWeight_ = checkDimWeight(dim);
+	dimWeightSqrt_ = dim.cwiseSqrt();
+}
+
+
+void TargetObjectiveTask::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	hlTask_->registerData(mbs, data);
+}
+
+
 void TargetObjectiveTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
@@ -471,7 +531,7 @@ void TargetObjectiveTask::update(const std::vector<rbd::MultiBody>& mbs,
 
 	hlTask_->update(mbs, mbcs, data);
 
-	const MatrixXd& J = hlTask_->jac();
+	const MatrixXd& J = hlTask_->shortJac();
 	const VectorXd& err = hlTask_->eval();
 	const VectorXd& speed = hlTask_->speed();
 	const VectorXd& normalAcc = hlTask_->normalAcc();
@@ -519,8 +579,10 @@ void TargetObjectiveTask::update(const std::vector<rbd::MultiBody>& mbs,
 		psi_(i) = pp(1);
 	}
 
-	preQ_.noalias() = dimWeight_.asDiagonal()*J;
-	Q_.noalias() = J.transpose()*preQ_;
+	// Q = J^T W J = (W^{1/2} J)^T (W^{1/2} J) as a rank k update
+	preQ_.noalias() = dimWeightSqrt_.asDiagonal()*J;
+	Q_.triangularView<Eigen::Lower>().setZero();
+	Q_.selfadjointView<Eigen::Lower>().rankUpdate(preQ_.transpose());
 
 	CVecSum_.noalias() = phi_ - normalAcc;
 	preC_.noalias() = dimWeight_.asDiagonal()*CVecSum_;
@@ -542,6 +604,18 @@ const Eigen::VectorXd& TargetObjectiveTask::C() const
 }
 
 
+QStructure TargetObjectiveTask::structureQ() const
+{
+	return QStructure::Lower;
+}
+
+
+const std::vector<ColBlock>& TargetObjectiveTask::QBlocks() const
+{
+	return hlTask_->jacBlocks();
+}
+
+
 /**
 	*												JointsSelector
 	*/
@@ -605,6 +679,13 @@ int JointsSelector::dim()
 }
 
 
+void JointsSelector::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	hl_->registerData(mbs, data);
+}
+
+
 void JointsSelector::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
@@ -659,9 +740,10 @@ PostureTask::PostureTask(const std::vector<rbd::MultiBody>& mbs,
 	robotIndex_(rI),
 	alphaDBegin_(0),
 	jointDatas_(),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
+	Q_(pt_.jac().diagonal()),
 	C_(mbs[rI].nrDof()),
-	alphaVec_(mbs[rI].nrDof())
+	alphaVec_(mbs[rI].nrDof()),
+	versionQ_(newVersion())
 {}
 
 
@@ -731,7 +813,7 @@ void PostureTask::update(const std::vector<rbd::MultiBody>& mbs,
 	pt_.update(mb, mbc);
 	rbd::paramToVector(mbc.alpha, alphaVec_);
 
-	Q_ = pt_.jac();
+	// Q_ is the constant posture jacobian diagonal set in the constructor
 	C_.setZero();
 
 	int deb = mb.jointPosInDof(1);
@@ -758,6 +840,16 @@ const Eigen::VectorXd& PostureTask::C() const
 	return C_;
 }
 
+int PostureTask::versionQ() const
+{
+	return versionQ_;
+}
+
+QStructure PostureTask::structureQ() const
+{
+	return QStructure::Diagonal;
+}
+
 const Eigen::VectorXd& PostureTask::eval() const
 {
 	return pt_.eval();
@@ -772,7 +864,11 @@ const Eigen::VectorXd& PostureTask::eval() const
 PositionTask::PositionTask(const std::vector<rbd::MultiBody>& mbs, int rI,
 	int bodyId, const Eigen::Vector3d& pos, const Eigen::Vector3d& bodyPoint):
 	pt_(mbs[rI], bodyId, pos, bodyPoint),
-	robotIndex_(rI)
+	robotIndex_(rI),
+	bodyId_(bodyId),
+	bodyIndex_(mbs[rI].bodyIndexById(bodyId)),
+	bodyJacIndex_(-1),
+	jacBlocks_(jointsColBlocks(mbs[rI], pt_.jointsPath()))
 {
 }
 
@@ -783,11 +879,28 @@ int PositionTask::dim()
 }
 
 
+void PositionTask::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	bodyJacIndex_ = data.addBodyJacobian(mbs, robotIndex_, bodyId_);
+}
+
+
 void PositionTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	const BodyJacobian* bodyJac =
+		data.bodyJacobian(bodyJacIndex_, robotIndex_, bodyIndex_);
+	if(bodyJac)
+	{
+		pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			bodyJac->bodyJac());
+	}
+	else
+	{
+		pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -815,6 +928,18 @@ const Eigen::VectorXd& PositionTask::normalAcc()
 }
 
 
+const Eigen::MatrixXd& PositionTask::shortJac()
+{
+	return pt_.shortJac();
+}
+
+
+const std::vector<ColBlock>& PositionTask::jacBlocks()
+{
+	return jacBlocks_;
+}
+
+
 /**
 	*																OrientationTask
 	*/
@@ -824,7 +949,11 @@ OrientationTask::OrientationTask(const std::vector<rbd::MultiBody>& mbs,
 	int rI, int bodyId,
 	const Eigen::Quaterniond& ori):
 	ot_(mbs[rI], bodyId, ori),
-	robotIndex_(rI)
+	robotIndex_(rI),
+	bodyId_(bodyId),
+	bodyIndex_(mbs[rI].bodyIndexById(bodyId)),
+	bodyJacIndex_(-1),
+	jacBlocks_(jointsColBlocks(mbs[rI], ot_.jointsPath()))
 {}
 
 
@@ -832,7 +961,11 @@ OrientationTask::OrientationTask(const std::vector<rbd::MultiBody>& mbs,
 	int rI, int bodyId,
 	const Eigen::Matrix3d& ori):
 	ot_(mbs[rI], bodyId, ori),
-	robotIndex_(rI)
+	robotIndex_(rI),
+	bodyId_(bodyId),
+	bodyIndex_(mbs[rI].bodyIndexById(bodyId)),
+	bodyJacIndex_(-1),
+	jacBlocks_(jointsColBlocks(mbs[rI], ot_.jointsPath()))
 {}
 
 
@@ -842,11 +975,28 @@ int OrientationTask::dim()
 }
 
 
+void OrientationTask::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	bodyJacIndex_ = data.addBodyJacobian(mbs, robotIndex_, bodyId_);
+}
+
+
 void OrientationTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	const BodyJacobian* bodyJac =
+		data.bodyJacobian(bodyJacIndex_, robotIndex_, bodyIndex_);
+	if(bodyJac)
+	{
+		ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			bodyJac->bodyJac());
+	}
+	else
+	{
+		ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -874,6 +1024,18 @@ const Eigen::VectorXd& OrientationTask::normalAcc()
 }
 
 
+const Eigen::MatrixXd& OrientationTask::shortJac()
+{
+	return ot_.shortJac();
+}
+
+
+const std::vector<ColBlock>& OrientationTask::jacBlocks()
+{
+	return jacBlocks_;
+}
+
+
 /**
 	*											TransformTaskCommon
 	*/
@@ -884,7 +1046,11 @@ TransformTaskCommon<transform_task_t>::TransformTaskCommon(
 		const std::vector<rbd::MultiBody>& mbs, int rI,
 	int bodyId, const sva::PTransformd& X_0_t, const sva::PTransformd& X_b_p):
 	tt_(mbs[rI], bodyId, X_0_t, X_b_p),
-	robotIndex_(rI)
+	robotIndex_(rI),
+	bodyId_(bodyId),
+	bodyIndex_(mbs[rI].bodyIndexById(bodyId)),
+	bodyJacIndex_(-1),
+	jacBlocks_(jointsColBlocks(mbs[rI], tt_.jointsPath()))
 {
 }
 
@@ -896,6 +1062,14 @@ int TransformTaskCommon<transform_task_t>::dim()
 }
 
 
+template <typename transform_task_t>
+void TransformTaskCommon<transform_task_t>::registerData(
+	const std::vector<rbd::MultiBody>& mbs, SolverData& data)
+{
+	bodyJacIndex_ = data.addBodyJacobian(mbs, robotIndex_, bodyId_);
+}
+
+
 template <typename transform_task_t>
 const Eigen::MatrixXd& TransformTaskCommon<transform_task_t>::jac()
 {
@@ -924,6 +1098,20 @@ const Eigen::VectorXd& TransformTaskCommon<transform_task_t>::normalAcc()
 }
 
 
+template <typename transform_task_t>
+const Eigen::MatrixXd& TransformTaskCommon<transform_task_t>::shortJac()
+{
+	return tt_.shortJac();
+}
+
+
+template <typename transform_task_t>
+const std::vector<ColBlock>& TransformTaskCommon<transform_task_t>::jacBlocks()
+{
+	return jacBlocks_;
+}
+
+
 /**
 	*											SurfaceTransformTask
 	*/
@@ -942,7 +1130,17 @@ void SurfaceTransformTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	const BodyJacobian* bodyJac =
+		data.bodyJacobian(bodyJacIndex_, robotIndex_, bodyIndex_);
+	if(bodyJac)
+	{
+		tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			bodyJac->bodyJac());
+	}
+	else
+	{
+		tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -976,7 +1174,17 @@ void TransformTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	const BodyJacobian* bodyJac =
+		data.bodyJacobian(bodyJacIndex_, robotIndex_, bodyIndex_);
+	if(bodyJac)
+	{
+		tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			bodyJac->bodyJac());
+	}
+	else
+	{
+		tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -989,7 +1197,11 @@ SurfaceOrientationTask::SurfaceOrientationTask(const std::vector<rbd::MultiBody>
 	int rI, int bodyId,
 	const Eigen::Quaterniond& ori, const sva::PTransformd& X_b_s):
 	ot_(mbs[rI], bodyId, ori, X_b_s),
-	robotIndex_(rI)
+	robotIndex_(rI),
+	bodyId_(bodyId),
+	bodyIndex_(mbs[rI].bodyIndexById(bodyId)),
+	bodyJacIndex_(-1),
+	jacBlocks_(jointsColBlocks(mbs[rI], ot_.jointsPath()))
 {}
 
 
@@ -997,7 +1209,11 @@ SurfaceOrientationTask::SurfaceOrientationTask(const std::vector<rbd::MultiBody>
 	int rI, int bodyId,
 	const Eigen::Matrix3d& ori, const sva::PTransformd& X_b_s):
 	ot_(mbs[rI], bodyId, ori, X_b_s),
-	robotIndex_(rI)
+	robotIndex_(rI),
+	bodyId_(bodyId),
+	bodyIndex_(mbs[rI].bodyIndexById(bodyId)),
+	bodyJacIndex_(-1),
+	jacBlocks_(jointsColBlocks(mbs[rI], ot_.jointsPath()))
 {}
 
 
@@ -1007,11 +1223,28 @@ int SurfaceOrientationTask::dim()
 }
 
 
+void SurfaceOrientationTask::registerData(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	bodyJacIndex_ = data.addBodyJacobian(mbs, robotIndex_, bodyId_);
+}
+
+
 void SurfaceOrientationTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	const BodyJacobian* bodyJac =
+		data.bodyJacobian(bodyJacIndex_, robotIndex_, bodyIndex_);
+	if(bodyJac)
+	{
+		ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			bodyJac->bodyJac());
+	}
+	else
+	{
+		ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -1039,6 +1272,18 @@ const Eigen::VectorXd& SurfaceOrientationTask::normalAcc()
 }
 
 
+const Eigen::MatrixXd& SurfaceOrientationTask::shortJac()
+{
+	return ot_.shortJac();
+}
+
+
+const std::vector<ColBlock>& SurfaceOrientationTask::jacBlocks()
+{
+	return jacBlocks_;
+}
+
+
 /**
 	*																GazeTask
 	*/
@@ -1257,6 +1502,8 @@ void MultiCoMTask::update(const std::vector<rbd::MultiBody>& mbs,
 	CSum_ = stiffness_*mct_.eval();
 	CSum_ -= stiffnessSqrt_*mct_.speed();
 	CSum_ -= mct_.normalAcc();
+	// W*CSum is computed once to avoid a temporary matrix J^T*W in the loop
+	const Eigen::Vector3d preC = dimWeight_.asDiagonal()*CSum_;
 	for(int i = 0; i < int(posInQ_.size()); ++i)
 	{
 		int r = mct_.robotIndexes()[i];
@@ -1268,7 +1515,7 @@ void MultiCoMTask::update(const std::vector<rbd::MultiBody>& mbs,
 
 		Q_.block(begin, begin, dof, dof).noalias() =
 			J.transpose()*preQ_.block(0, 0, 3, dof);
-		C_.segment(begin, dof).noalias() = -J.transpose()*dimWeight_.asDiagonal()*CSum_;
+		C_.segment(begin, dof).noalias() = -J.transpose()*preC;
 	}
 }
 
@@ -1406,6 +1653,8 @@ void MultiRobotTransformTask::update(const std::vector<rbd::MultiBody>& mbs,
 	CSum_.noalias() = stiffness_*mrtt_.eval();
 	CSum_.noalias() -= stiffnessSqrt_*mrtt_.speed();
 	CSum_.noalias() -= mrtt_.normalAcc();
+	// W*CSum is computed once to avoid a temporary matrix J^T*W in the loop
+	const Eigen::Vector6d preC = dimWeight_.asDiagonal()*CSum_;
 
 	// first we set to zero used part of Q and C
 	for(int i = 0; i < int(posInQ_.size()); ++i)
@@ -1430,7 +1679,7 @@ void MultiRobotTransformTask::update(const std::vector<rbd::MultiBody>& mbs,
 		// we had to increment the Q and C matrix
 		Q_.block(begin, begin, dof, dof).noalias() +=
 			J.transpose()*preQ_.block(0, 0, 6, dof);
-		C_.segment(begin, dof).noalias() -= J.transpose()*dimWeight_.asDiagonal()*CSum_;
+		C_.segment(begin, dof).noalias() -= J.transpose()*preC;
 	}
 }
 
@@ -1526,35 +1775,44 @@ void ContactTask::errorD(const Eigen::Vector3d& errorD)
 }
 
 
+void ContactTask::registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+	SolverData& data)
+{
+	// the task lambda come from its contact
+	data.dependOnContacts();
+}
+
+
 void ContactTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
 	int nrLambda = 0;
-	begin_ = data.lambdaBegin();
+	begin_ = data.lambdaBegin() + data.totalLambda();
 	std::vector<FrictionCone> cones;
+	const WrenchCone* wrenchCone = nullptr;
 
-	if(nrLambda == 0)
+	int cIndex = data.contactIndex(contactId_);
+	if(cIndex != -1)
 	{
-		for(const BilateralContact& uc: data.allContacts())
+		const BilateralContact& bc = data.allContacts()[cIndex];
+		nrLambda = data.lambda(cIndex);
+		begin_ = data.lambdaBegin(cIndex);
+		if(bc.model == ContactModel::Wrench)
 		{
-			int curLambda = 0;
-			for(std::size_t i = 0; i < uc.r1Points.size(); ++i)
-			{
-				curLambda += uc.nrLambda(static_cast<int>(i));
-			}
-
-			if(uc.contactId == contactId_)
-			{
-				nrLambda = curLambda;
-				cones = uc.r1Cones;
-				break;
-			}
-
-			begin_ += curLambda;
+			wrenchCone = &bc.r1WrenchCone;
+		}
+		else
+		{
+			cones = bc.r1Cones;
 		}
 	}
 
 	conesJac_.resize(3, nrLambda);
+	if(wrenchCone)
+	{
+		// force part of the wrench applied on the body
+		conesJac_ = wrenchCone->wrenches.bottomRows<3>();
+	}
 	int index = 0;
 	for(const FrictionCone& fc: cones)
 	{
@@ -1565,9 +1823,8 @@ void ContactTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 		}
 	}
 
-	Q_.resize(nrLambda, nrLambda);
-	Q_.noalias() = conesJac_.transpose()*conesJac_;
 	C_.setZero(nrLambda);
+	versionQ_ = newVersion();
 }
 
 
@@ -1582,7 +1839,7 @@ void ContactTask::update(const std::vector<rbd::MultiBody>& /* mbs */,
 
 const Eigen::MatrixXd& ContactTask::Q() const
 {
-	return Q_;
+	return conesJac_;
 }
 
 
@@ -1592,52 +1849,65 @@ const Eigen::VectorXd& ContactTask::C() const
 }
 
 
+int ContactTask::versionQ() const
+{
+	return versionQ_;
+}
+
+
+QStructure ContactTask::structureQ() const
+{
+	return QStructure::Factor;
+}
+
+
 /**
 	*														GripperTorqueTask
 	*/
 
 
+void GripperTorqueTask::registerData(const std::vector<rbd::MultiBody>& /* mbs */,
+	SolverData& data)
+{
+	// the gripper lambda come from the bilateral contacts
+	data.dependOnContacts();
+}
+
+
 void GripperTorqueTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
 	using namespace Eigen;
 	bool found = false;
 
-	begin_ = data.bilateralBegin();
-	for(const BilateralContact& bc: data.bilateralContacts())
+	int index = data.contactIndex(contactId_);
+	// only bilateral contacts are grippers, the ContactModel::Wrench
+	// lambda are not generators so they are not supported
+	if(index >= int(data.unilateralContacts().size()) &&
+		 data.allContacts()[index].model == ContactModel::Generators)
 	{
-		int curLambda = 0;
-		// compute the number of lambda needed by the current bilateral
-		for(std::size_t i = 0; i < bc.r1Points.size(); ++i)
-		{
-			curLambda += bc.nrLambda(static_cast<int>(i));
-		}
+		const BilateralContact& bc = data.allContacts()[index];
+		int nrLambda = data.lambda(index);
+
+		found = true;
+		begin_ = data.lambdaBegin(index);
+		C_.resize(nrLambda);
 
-		if(bc.contactId == contactId_)
+		int pos = 0;
+		// minimize Torque applied on the gripper motor
+		// min Sum_i^nrF  T_i·( p_i^T_o x f_i)
+		for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
 		{
-			found = true;
-			Q_.setZero(curLambda, curLambda);
-			C_.resize(curLambda);
-
-			int pos = 0;
-			// minimize Torque applied on the gripper motor
-			// min Sum_i^nrF  T_i·( p_i^T_o x f_i)
-			for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
+			Vector3d T_o_p = bc.r1Points[i] - origin_;
+			for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
 			{
-				Vector3d T_o_p = bc.r1Points[i] - origin_;
-				for(std::size_t j = 0; j < bc.r1Cones[i].generators.size(); ++j)
-				{
-					// we use abs because the contact force cannot apply
-					// negative torque on the gripper
-					C_(pos) = std::abs(
-						axis_.transpose()*(T_o_p.cross(bc.r1Cones[i].generators[j])));
-					++pos;
-				}
+				// we use abs because the contact force cannot apply
+				// negative torque on the gripper
+				C_(pos) = std::abs(
+					axis_.transpose()*(T_o_p.cross(bc.r1Cones[i].generators[j])));
+				++pos;
 			}
-			break;
 		}
-
-		begin_ += curLambda;
 	}
 
 	// if no contact was found we don't activate the task
@@ -1645,9 +1915,9 @@ void GripperTorqueTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs *
 	if(!found)
 	{
 		begin_ = 0;
-		Q_.resize(0, 0);
 		C_.resize(0);
 	}
+	versionQ_ = newVersion();
 }
 
 
@@ -1669,6 +1939,18 @@ const Eigen::VectorXd& GripperTorqueTask::C() const
 }
 
 
+int GripperTorqueTask::versionQ() const
+{
+	return versionQ_;
+}
+
+
+QStructure GripperTorqueTask::structureQ() const
+{
+	return QStructure::ScaledIdentity;
+}
+
+
 /**
 	*											LinVelocityTask
 	*/
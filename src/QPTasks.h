@@ -52,6 +52,7 @@ public:
 		return std::make_pair(alphaDBegin_, alphaDBegin_);
 	}
 
+	/// @throw std::domain_error If an entry of dim is negative.
 	void dimWeight(const Eigen::VectorXd& dim);
 
 	const Eigen::VectorXd& dimWeight() const
@@ -59,11 +60,25 @@ public:
 		return dimWeight_;
 	}
 
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
+	virtual HighLevelTask* highLevelTask() const
+	{
+		return hlTask_;
+	}
+
+	/**
+		* Only the lower triangular part of Q is computed.
+		* Q and C are restricted to the robot dof of the HighLevelTask
+		* short jacobian.
+		*/
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	virtual QStructure structureQ() const;
+	virtual const std::vector<ColBlock>& QBlocks() const;
 
 protected:
 	void computeQC(Eigen::VectorXd& error);
@@ -73,7 +88,7 @@ protected:
 	Eigen::VectorXd error_;
 
 private:
-	Eigen::VectorXd dimWeight_;
+	Eigen::VectorXd dimWeight_, dimWeightSqrt_;
 	int robotIndex_, alphaDBegin_;
 
 	Eigen::MatrixXd Q_;
@@ -240,10 +255,8 @@ public:
 	{
 		return dimWeight_;
 	}
-	void dimWeight(const Eigen::VectorXd& o)
-	{
-		dimWeight_ = o;
-	}
+	/// @throw std::domain_error If an entry of dim is negative.
+	void dimWeight(const Eigen::VectorXd& dim);
 
 	const Eigen::VectorXd& phi() const
 	{
@@ -260,14 +273,28 @@ public:
 		return std::make_pair(alphaDBegin_, alphaDBegin_);
 	}
 
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
 
+	virtual HighLevelTask* highLevelTask() const
+	{
+		return hlTask_;
+	}
+
+	/**
+		* Only the lower triangular part of Q is computed.
+		* Q and C are restricted to the robot dof of the HighLevelTask
+		* short jacobian.
+		*/
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	virtual QStructure structureQ() const;
+	virtual const std::vector<ColBlock>& QBlocks() const;
 
 private:
 	HighLevelTask* hlTask_;
@@ -275,7 +302,7 @@ private:
 	int iter_, nrIter_;
 	double dt_;
 	Eigen::VectorXd objDot_;
-	Eigen::VectorXd dimWeight_;
+	Eigen::VectorXd dimWeight_, dimWeightSqrt_;
 	int robotIndex_, alphaDBegin_;
 
 	Eigen::VectorXd phi_, psi_;
@@ -313,6 +340,8 @@ public:
 	}
 
 	virtual int dim();
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
@@ -322,6 +351,11 @@ public:
 	virtual const Eigen::VectorXd& speed();
 	virtual const Eigen::VectorXd& normalAcc();
 
+	virtual HighLevelTask* highLevelTask() const
+	{
+		return hl_;
+	}
+
 private:
 	Eigen::MatrixXd jac_;
 	std::vector<SelectedData> selectedJoints_;
@@ -381,12 +415,18 @@ public:
 		return pt_;
 	}
 
-	void posture(std::vector<std::vector<double> > q)
+	void posture(const std::vector<std::vector<double> >& q)
 	{
 		pt_.posture(q);
 	}
 
-	const std::vector<std::vector<double> > posture() const
+	const std::vector<std::vector<double> >& posture() const
+	{
+		return pt_.posture();
+	}
+
+	/// Target posture, can be modified in place (see TargetBuffer).
+	std::vector<std::vector<double> >& posture()
 	{
 		return pt_.posture();
 	}
@@ -423,8 +463,11 @@ public:
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
 
+	/// Q is the diagonal of the posture jacobian.
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	virtual int versionQ() const;
+	virtual QStructure structureQ() const;
 
 	const Eigen::VectorXd& eval() const;
 
@@ -447,6 +490,7 @@ private:
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
 	Eigen::VectorXd alphaVec_;
+	int versionQ_;
 };
 
 
@@ -484,6 +528,8 @@ public:
 	}
 
 	virtual int dim();
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mb,
 		const std::vector<rbd::MultiBodyConfig>& mbc,
 		const SolverData& data);
@@ -492,10 +538,16 @@ public:
 	virtual const Eigen::VectorXd& eval();
 	virtual const Eigen::VectorXd& speed();
 	virtual const Eigen::VectorXd& normalAcc();
+	virtual const Eigen::MatrixXd& shortJac();
+	virtual const std::vector<ColBlock>& jacBlocks();
 
 private:
 	tasks::PositionTask pt_;
 	int robotIndex_;
+	int bodyId_, bodyIndex_;
+	/// SolverData::bodyJacobian index, -1 if not registered
+	int bodyJacIndex_;
+	std::vector<ColBlock> jacBlocks_;
 };
 
 
@@ -529,6 +581,8 @@ public:
 	}
 
 	virtual int dim();
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
@@ -537,10 +591,16 @@ public:
 	virtual const Eigen::VectorXd& eval();
 	virtual const Eigen::VectorXd& speed();
 	virtual const Eigen::VectorXd& normalAcc();
+	virtual const Eigen::MatrixXd& shortJac();
+	virtual const std::vector<ColBlock>& jacBlocks();
 
 private:
 	tasks::OrientationTask ot_;
 	int robotIndex_;
+	int bodyId_, bodyIndex_;
+	/// SolverData::bodyJacobian index, -1 if not registered
+	int bodyJacIndex_;
+	std::vector<ColBlock> jacBlocks_;
 };
 
 
@@ -579,15 +639,23 @@ public:
 	}
 
 	virtual int dim();
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 
 	virtual const Eigen::MatrixXd& jac();
 	virtual const Eigen::VectorXd& eval();
 	virtual const Eigen::VectorXd& speed();
 	virtual const Eigen::VectorXd& normalAcc();
+	virtual const Eigen::MatrixXd& shortJac();
+	virtual const std::vector<ColBlock>& jacBlocks();
 
 protected:
 	transform_task_t tt_;
 	int robotIndex_;
+	int bodyId_, bodyIndex_;
+	/// SolverData::bodyJacobian index, -1 if not registered
+	int bodyJacIndex_;
+	std::vector<ColBlock> jacBlocks_;
 };
 
 
@@ -655,6 +723,8 @@ public:
 	}
 
 	virtual int dim();
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+			SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 			const std::vector<rbd::MultiBodyConfig>& mbcs,
 			const SolverData& data);
@@ -663,10 +733,16 @@ public:
 	virtual const Eigen::VectorXd& eval();
 	virtual const Eigen::VectorXd& speed();
 	virtual const Eigen::VectorXd& normalAcc();
+	virtual const Eigen::MatrixXd& shortJac();
+	virtual const std::vector<ColBlock>& jacBlocks();
 
 private:
 	tasks::SurfaceOrientationTask ot_;
 	int robotIndex_;
+	int bodyId_, bodyIndex_;
+	/// SolverData::bodyJacobian index, -1 if not registered
+	int bodyJacIndex_;
+	std::vector<ColBlock> jacBlocks_;
 };
 
 
@@ -944,8 +1020,8 @@ public:
 		conesJac_(),
 		error_(Eigen::Vector3d::Zero()),
 		errorD_(Eigen::Vector3d::Zero()),
-		Q_(),
-		C_()
+		C_(),
+		versionQ_(newVersion())
 	{}
 
 	virtual std::pair<int, int> begin() const
@@ -956,14 +1032,22 @@ public:
 	void error(const Eigen::Vector3d& error);
 	void errorD(const Eigen::Vector3d& errorD);
 
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
 
+	/**
+		* Q is the cones generators matrix G (the surface wrench to force
+		* matrix with the ContactModel::Wrench model), the task Q is G^T·G.
+		*/
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	virtual int versionQ() const;
+	virtual QStructure structureQ() const;
 
 private:
 	ContactId contactId_;
@@ -973,8 +1057,8 @@ private:
 	Eigen::MatrixXd conesJac_;
 	Eigen::Vector3d error_, errorD_;
 
-	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
+	int versionQ_;
 };
 
 
@@ -989,8 +1073,9 @@ public:
 		origin_(origin),
 		axis_(axis),
 		begin_(0),
-		Q_(),
-		C_()
+		Q_(Eigen::MatrixXd::Zero(1, 1)),
+		C_(),
+		versionQ_(newVersion())
 	{}
 
 	virtual std::pair<int, int> begin() const
@@ -998,14 +1083,19 @@ public:
 		return std::make_pair(begin_, begin_);
 	}
 
+	virtual void registerData(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
 
+	/// The task is linear, Q is the 1×1 null scale.
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	virtual int versionQ() const;
+	virtual QStructure structureQ() const;
 
 private:
 	ContactId contactId_;
@@ -1015,6 +1105,7 @@ private:
 
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
+	int versionQ_;
 };
 
 
@@ -0,0 +1,129 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <atomic>
+
+
+namespace tasks
+{
+
+
+/**
+	* Consumer side of a TargetBuffer.
+	* QPSolver swap all its buffers at the beginning of each solve.
+	*/
+class TargetBufferBase
+{
+public:
+	virtual ~TargetBufferBase() {}
+
+	/**
+		* Apply the last published value if a new one has been published
+		* since the previous swap.
+		* Must only be called by the consumer thread.
+		* @return true if a value has been applied.
+		*/
+	virtual bool swap() = 0;
+};
+
+
+/**
+	* Lock-free single producer, single consumer buffer of a task target.
+	* The producer thread (a planner) publishes values without waiting
+	* and the consumer thread (the control loop) applies the last published
+	* value with TargetBuffer::swap. Intermediate values can be skipped.
+	* Three slots are used so the producer never writes the slot the
+	* consumer is applying and no value copy is done under a lock.
+	* Values are copied by assignment in the preallocated slots and then
+	* in the target so publishing and swapping don't allocate if T copy
+	* assignment doesn't (same size vectors).
+	*/
+template<typename T>
+class TargetBuffer : public TargetBufferBase
+{
+public:
+	/**
+		* @param target Value assigned by swap, usually a task target
+		* returned by reference (like qp::PostureTask::posture).
+		* Must outlive the buffer. Its current value preallocate the slots.
+		*/
+	explicit TargetBuffer(T& target):
+		target_(target),
+		slots_{target, target, target},
+		back_(0),
+		state_(1),
+		front_(2)
+	{}
+
+	TargetBuffer(const TargetBuffer&) = delete;
+	TargetBuffer& operator=(const TargetBuffer&) = delete;
+
+	/// Copy value in the back slot and publish it (producer thread).
+	void write(const T& value)
+	{
+		slots_[back_] = value;
+		publish();
+	}
+
+	/**
+		* Back slot, can be modified in place before calling publish
+		* (producer thread).
+		*/
+	T& back()
+	{
+		return slots_[back_];
+	}
+
+	/// Publish the back slot (producer thread).
+	void publish()
+	{
+		// the back slot become the middle one and
+		// the previous middle slot is the new back slot
+		back_ = state_.exchange(back_ | newBit, std::memory_order_acq_rel) & indexMask;
+	}
+
+	virtual bool swap()
+	{
+		if(!(state_.load(std::memory_order_relaxed) & newBit))
+		{
+			return false;
+		}
+
+		front_ = state_.exchange(front_, std::memory_order_acq_rel) & indexMask;
+		target_ = slots_[front_];
+		return true;
+	}
+
+private:
+	static const int indexMask = 3;
+	static const int newBit = 4;
+
+private:
+	T& target_;
+	T slots_[3];
+	/// slot written by the producer
+	int back_;
+	/// middle slot index and newBit if it hold a value not applied yet
+	std::atomic<int> state_;
+	/// slot applied by the consumer
+	int front_;
+};
+
+
+} // namespace tasks
@@ -29,6 +29,41 @@ namespace tasks
 {
 
 
+/**
+	*													FullJacobian
+	*/
+
+
+FullJacobian::FullJacobian(const rbd::MultiBody& mb, const rbd::Jacobian& jac,
+	int rows):
+	dofBlocks_(),
+	full_(Eigen::MatrixXd::Zero(rows, mb.nrDof())),
+	valid_(false)
+{
+	for(int i: jac.jointsPath())
+	{
+		dofBlocks_.emplace_back(mb.jointPosInDof(i), mb.joint(i).dof());
+	}
+}
+
+
+const Eigen::MatrixXd& FullJacobian::get(const Eigen::MatrixXd& shortJac) const
+{
+	if(!valid_)
+	{
+		// columns of the dof outside the joints path are always null
+		int shortCol = 0;
+		for(const std::pair<int, int>& b: dofBlocks_)
+		{
+			full_.middleCols(b.first, b.second) = shortJac.middleCols(shortCol, b.second);
+			shortCol += b.second;
+		}
+		valid_ = true;
+	}
+	return full_;
+}
+
+
 /**
 	*													PositionTask
 	*/
@@ -43,7 +78,8 @@ PositionTask::PositionTask(const rbd::MultiBody& mb, int bodyId,
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
-	jacMat_(3, mb.nrDof()),
+	shortJacMat_(3, jac_.dof()),
+	jacMat_(mb, jac_, 3),
 	jacDotMat_(3, mb.nrDof())
 {
 }
@@ -79,9 +115,9 @@ void PositionTask::update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig&
 	speed_ = jac_.velocity(mb, mbc).linear();
 	normalAcc_ = jac_.normalAcceleration(mb, mbc).linear();
 
-	const auto& shortJacMat =
+	shortJacMat_ =
 		jac_.jacobian(mb, mbc).block(3, 0, 3, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	jacMat_.invalidate();
 }
 
 
@@ -92,9 +128,27 @@ void PositionTask::update(const rbd::MultiBody& mb,
 	speed_ = jac_.velocity(mb, mbc).linear();
 	normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).linear();
 
-	const auto& shortJacMat =
+	shortJacMat_ =
 		jac_.jacobian(mb, mbc).block(3, 0, 3, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	jacMat_.invalidate();
+}
+
+
+void PositionTask::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB,
+	const Eigen::MatrixXd& bodyJac)
+{
+	const sva::PTransformd& X_0_b = mbc.bodyPosW[bodyIndex_];
+	sva::PTransformd X_0_p(Eigen::Vector3d((point_*X_0_b).translation()));
+
+	eval_ = pos_ - X_0_p.translation();
+	speed_ = jac_.velocity(mb, mbc).linear();
+	normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).linear();
+
+	// linear part of the body jacobian moved at the point in world orientation
+	Eigen::Matrix6d X_b_p = (X_0_p*X_0_b.inv()).matrix();
+	shortJacMat_.noalias() = X_b_p.bottomRows<3>()*bodyJac;
+	jacMat_.invalidate();
 }
 
 
@@ -126,7 +180,19 @@ const Eigen::VectorXd& PositionTask::normalAcc() const
 
 const Eigen::MatrixXd& PositionTask::jac() const
 {
-	return jacMat_;
+	return jacMat_.get(shortJacMat_);
+}
+
+
+const Eigen::MatrixXd& PositionTask::shortJac() const
+{
+	return shortJacMat_;
+}
+
+
+const std::vector<int>& PositionTask::jointsPath() const
+{
+	return jac_.jointsPath();
 }
 
 
@@ -148,7 +214,8 @@ OrientationTask::OrientationTask(const rbd::MultiBody& mb, int bodyId, const Eig
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
-	jacMat_(3, mb.nrDof()),
+	shortJacMat_(3, jac_.dof()),
+	jacMat_(mb, jac_, 3),
 	jacDotMat_(3, mb.nrDof())
 {
 }
@@ -161,7 +228,8 @@ OrientationTask::OrientationTask(const rbd::MultiBody& mb, int bodyId, const Eig
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
-	jacMat_(3, mb.nrDof()),
+	shortJacMat_(3, jac_.dof()),
+	jacMat_(mb, jac_, 3),
 	jacDotMat_(3, mb.nrDof())
 {
 }
@@ -191,20 +259,30 @@ void OrientationTask::update(const rbd::MultiBody& mb, const rbd::MultiBodyConfi
 	speed_ = jac_.velocity(mb, mbc).angular();
 	normalAcc_ = jac_.normalAcceleration(mb, mbc).angular();
 
-	const auto& shortJacMat = jac_.jacobian(mb, mbc).block(0, 0, 3, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	shortJacMat_ = jac_.jacobian(mb, mbc).block(0, 0, 3, jac_.dof());
+	jacMat_.invalidate();
 }
 
 
 void OrientationTask::update(const rbd::MultiBody& mb,
 	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB)
 {
-	eval_ = sva::rotationError(mbc.bodyPosW[bodyIndex_].rotation(), ori_, 1e-7);
+	update(mb, mbc, normalAccB, jac_.bodyJacobian(mb, mbc));
+}
+
+
+void OrientationTask::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB,
+	const Eigen::MatrixXd& bodyJac)
+{
+	const Eigen::Matrix3d& E_0_b = mbc.bodyPosW[bodyIndex_].rotation();
+	eval_ = sva::rotationError(E_0_b, ori_, 1e-7);
 	speed_ = jac_.velocity(mb, mbc).angular();
 	normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).angular();
 
-	const auto& shortJacMat = jac_.jacobian(mb, mbc).block(0, 0, 3, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	// angular part of the body jacobian in world orientation
+	shortJacMat_.noalias() = E_0_b.transpose()*bodyJac.topRows<3>();
+	jacMat_.invalidate();
 }
 
 
@@ -235,7 +313,19 @@ const Eigen::VectorXd& OrientationTask::normalAcc() const
 
 const Eigen::MatrixXd& OrientationTask::jac() const
 {
-	return jacMat_;
+	return jacMat_.get(shortJacMat_);
+}
+
+
+const Eigen::MatrixXd& OrientationTask::shortJac() const
+{
+	return shortJacMat_;
+}
+
+
+const std::vector<int>& OrientationTask::jointsPath() const
+{
+	return jac_.jointsPath();
 }
 
 
@@ -259,7 +349,8 @@ TransformTaskCommon::TransformTaskCommon(const rbd::MultiBody& mb, int bodyId,
 	eval_(6),
 	speed_(6),
 	normalAcc_(6),
-	jacMat_(6, mb.nrDof())
+	shortJacMat_(6, jac_.dof()),
+	jacMat_(mb, jac_, 6)
 {
 }
 
@@ -308,7 +399,19 @@ const Eigen::VectorXd& TransformTaskCommon::normalAcc() const
 
 const Eigen::MatrixXd& TransformTaskCommon::jac() const
 {
-	return jacMat_;
+	return jacMat_.get(shortJacMat_);
+}
+
+
+const Eigen::MatrixXd& TransformTaskCommon::shortJac() const
+{
+	return shortJacMat_;
+}
+
+
+const std::vector<int>& TransformTaskCommon::jointsPath() const
+{
+	return jac_.jointsPath();
 }
 
 
@@ -319,14 +422,21 @@ const Eigen::MatrixXd& TransformTaskCommon::jac() const
 
 SurfaceTransformTask::SurfaceTransformTask(const rbd::MultiBody& mb, int bodyId,
 		const sva::PTransformd& X_0_t, const sva::PTransformd& X_b_p):
-	TransformTaskCommon(mb, bodyId, X_0_t, X_b_p),
-	jacMatTmp_(6, jac_.dof())
+	TransformTaskCommon(mb, bodyId, X_0_t, X_b_p)
 {
 }
 
 
 void SurfaceTransformTask::update(const rbd::MultiBody& mb,
 	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB)
+{
+	update(mb, mbc, normalAccB, jac_.bodyJacobian(mb, mbc));
+}
+
+
+void SurfaceTransformTask::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB,
+	const Eigen::MatrixXd& bodyJac)
 {
 	sva::PTransformd X_0_p = X_b_p_*mbc.bodyPosW[bodyIndex_];
 	sva::PTransformd X_p_t = X_0_t_*X_0_p.inv();
@@ -343,15 +453,16 @@ void SurfaceTransformTask::update(const rbd::MultiBody& mb,
 	speed_ = -V_err_p.vector();
 	normalAcc_ = -(V_err_p.cross(w_0_p) + err_p.cross(wAN_0_p) - AN_0_p).vector();
 
-	jacMatTmp_ = jac_.jacobian(mb, mbc, X_0_p);
+	// body jacobian moved in the 'p' frame
+	shortJacMat_.noalias() = X_b_p_.matrix()*bodyJac;
 
 	for(int i = 0; i < jac_.dof(); ++i)
 	{
-		jacMatTmp_.col(i).head<6>() -= err_p.cross(
-			sva::MotionVecd(jacMatTmp_.col(i).head<3>(), Eigen::Vector3d::Zero())).vector();
+		shortJacMat_.col(i).head<6>() -= err_p.cross(
+			sva::MotionVecd(shortJacMat_.col(i).head<3>(), Eigen::Vector3d::Zero())).vector();
 	}
 
-	jac_.fullJacobian(mb, jacMatTmp_, jacMat_);
+	jacMat_.invalidate();
 }
 
 
@@ -383,6 +494,14 @@ const Eigen::Matrix3d& TransformTask::E_0_c() const
 
 void TransformTask::update(const rbd::MultiBody& mb,
 	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB)
+{
+	update(mb, mbc, normalAccB, jac_.bodyJacobian(mb, mbc));
+}
+
+
+void TransformTask::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB,
+	const Eigen::MatrixXd& bodyJac)
 {
 	sva::PTransformd X_0_p(X_b_p_*mbc.bodyPosW[bodyIndex_]);
 	sva::PTransformd E_p_c(Eigen::Matrix3d(E_0_c_*X_0_p.rotation().transpose()));
@@ -393,9 +512,10 @@ void TransformTask::update(const rbd::MultiBody& mb,
 	eval_ = (sva::PTransformd(E_0_c_)*sva::transformError(X_0_p, X_0_t_, 1e-7)).vector();
 	speed_ = V_p_c.vector();
 	normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB, X_b_p_c, w_p_c).vector();
-	const auto& shortJacMat = jac_.jacobian(mb, mbc, E_p_c*X_0_p);
+	// body jacobian moved in the 'p' frame with the 'c' orientation
+	shortJacMat_.noalias() = X_b_p_c.matrix()*bodyJac;
 
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	jacMat_.invalidate();
 }
 
 
@@ -558,7 +678,8 @@ SurfaceOrientationTask::SurfaceOrientationTask(const rbd::MultiBody& mb,
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
-	jacMat_(3, mb.nrDof()),
+	shortJacMat_(3, jac_.dof()),
+	jacMat_(mb, jac_, 3),
 	jacDotMat_(3, mb.nrDof())
 {
 }
@@ -573,7 +694,8 @@ SurfaceOrientationTask::SurfaceOrientationTask(const rbd::MultiBody& mb,
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
-	jacMat_(3, mb.nrDof()),
+	shortJacMat_(3, jac_.dof()),
+	jacMat_(mb, jac_, 3),
 	jacDotMat_(3, mb.nrDof())
 {
 }
@@ -608,15 +730,24 @@ void SurfaceOrientationTask::update(const rbd::MultiBody& mb,
 	normalAcc_ = jac_.normalAcceleration(mb, mbc, X_b_s_,
 		sva::MotionVecd(Eigen::Vector6d::Zero())).angular();
 
-	const auto& shortJacMat =
+	shortJacMat_ =
 		jac_.jacobian(mb, mbc, X_b_s_*mbc.bodyPosW[bodyIndex_]).block(0, 0, 3, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	jacMat_.invalidate();
 }
 
 
 void SurfaceOrientationTask::update(const rbd::MultiBody& mb,
 																	const rbd::MultiBodyConfig& mbc,
 																	const std::vector<sva::MotionVecd>& normalAccB)
+{
+	update(mb, mbc, normalAccB, jac_.bodyJacobian(mb, mbc));
+}
+
+
+void SurfaceOrientationTask::update(const rbd::MultiBody& mb,
+																	const rbd::MultiBodyConfig& mbc,
+																	const std::vector<sva::MotionVecd>& normalAccB,
+																	const Eigen::MatrixXd& bodyJac)
 {
 	eval_ = sva::rotationVelocity<double>
 		(ori_*mbc.bodyPosW[bodyIndex_].rotation().transpose()*X_b_s_.rotation().transpose(), 1e-7);
@@ -626,9 +757,9 @@ void SurfaceOrientationTask::update(const rbd::MultiBody& mb,
 	normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB, X_b_s_,
 		sva::MotionVecd(Eigen::Vector6d::Zero())).angular();
 
-	const auto& shortJacMat =
-		jac_.jacobian(mb, mbc, X_b_s_*mbc.bodyPosW[bodyIndex_]).block(0, 0, 3, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	// angular part of the body jacobian in the surface frame
+	shortJacMat_.noalias() = X_b_s_.rotation()*bodyJac.topRows<3>();
+	jacMat_.invalidate();
 }
 
 
@@ -660,7 +791,19 @@ const Eigen::VectorXd& SurfaceOrientationTask::normalAcc() const
 
 const Eigen::MatrixXd& SurfaceOrientationTask::jac() const
 {
-	return jacMat_;
+	return jacMat_.get(shortJacMat_);
+}
+
+
+const Eigen::MatrixXd& SurfaceOrientationTask::shortJac() const
+{
+	return shortJacMat_;
+}
+
+
+const std::vector<int>& SurfaceOrientationTask::jointsPath() const
+{
+	return jac_.jointsPath();
 }
 
 
@@ -687,8 +830,9 @@ GazeTask::GazeTask(const rbd::MultiBody &mb, int bodyId,
 	eval_(2),
 	speed_(2),
 	normalAcc_(2),
-	jacMat_(2, mb.nrDof()),
-	jacDotMat_(2, mb.nrDof())
+	jacMat_(mb, jac_, 2),
+	jacDotMat_(2, mb.nrDof()),
+	shortJacMat_(2, jac_.dof())
 {
 }
 
@@ -703,8 +847,9 @@ GazeTask::GazeTask(const rbd::MultiBody &mb, int bodyId,
 	eval_(2),
 	speed_(2),
 	normalAcc_(2),
-	jacMat_(2, mb.nrDof()),
-	jacDotMat_(2, mb.nrDof())
+	jacMat_(mb, jac_, 2),
+	jacDotMat_(2, mb.nrDof()),
+	shortJacMat_(2, jac_.dof())
 {
 	point2d_ << point3d[0]/point3d[2], point3d[1]/point3d[2];
 	depthEstimate_ = point3d[2];
@@ -738,8 +883,9 @@ void GazeTask::update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 	normalAcc_ = L_img_*(jac_.normalAcceleration(mb, mbc, normalAccB, X_b_gaze_,
 		sva::MotionVecd(Eigen::Vector6d::Zero()))).vector();
 
-	Eigen::MatrixXd shortJacMat = L_img_*jac_.jacobian(mb, mbc, X_0_gaze).block(0, 0, 6, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	shortJacMat_.noalias() =
+		L_img_*jac_.jacobian(mb, mbc, X_0_gaze).block(0, 0, 6, jac_.dof());
+	jacMat_.invalidate();
 }
 
 
@@ -763,7 +909,7 @@ const Eigen::VectorXd& GazeTask::normalAcc() const
 
 const Eigen::MatrixXd& GazeTask::jac() const
 {
-	return jacMat_;
+	return jacMat_.get(shortJacMat_);
 }
 
 
@@ -798,13 +944,19 @@ PostureTask::PostureTask(const rbd::MultiBody& mb, std::vector<std::vector<doubl
 }
 
 
-void PostureTask::posture(std::vector<std::vector<double> > q)
+void PostureTask::posture(const std::vector<std::vector<double> >& q)
 {
 	q_ = q;
 }
 
 
-const std::vector<std::vector<double> > PostureTask::posture() const
+const std::vector<std::vector<double> >& PostureTask::posture() const
+{
+	return q_;
+}
+
+
+std::vector<std::vector<double> >& PostureTask::posture()
 {
 	return q_;
 }
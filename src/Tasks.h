@@ -37,6 +37,33 @@ namespace tasks
 {
 
 
+/**
+	* Full jacobian of a rbd::Jacobian built from its short jacobian only
+	* when it's asked since the QP tasks only use the short one.
+	*/
+class FullJacobian
+{
+public:
+	FullJacobian(const rbd::MultiBody& mb, const rbd::Jacobian& jac, int rows);
+
+	/// Must be called each time the short jacobian change.
+	void invalidate()
+	{
+		valid_ = false;
+	}
+
+	/// @return The full jacobian of shortJac.
+	const Eigen::MatrixXd& get(const Eigen::MatrixXd& shortJac) const;
+
+private:
+	/// position in dof of the jacobian joints path and their number of dof
+	std::vector<std::pair<int, int>> dofBlocks_;
+	mutable Eigen::MatrixXd full_;
+	mutable bool valid_;
+};
+
+
+
 class PositionTask
 {
 public:
@@ -52,6 +79,12 @@ public:
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		const std::vector<sva::MotionVecd>& normalAccB);
+	/**
+		* Same as update but with the body jacobian at the body origin in body
+		* coordinates (rbd::Jacobian::bodyJacobian) computed elsewhere.
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB, const Eigen::MatrixXd& bodyJac);
 	void updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 
 	const Eigen::VectorXd& eval() const;
@@ -59,6 +92,9 @@ public:
 	const Eigen::VectorXd& normalAcc() const;
 
 	const Eigen::MatrixXd& jac() const;
+	/// Jacobian restricted to the dof of the joints in jointsPath.
+	const Eigen::MatrixXd& shortJac() const;
+	const std::vector<int>& jointsPath() const;
 	const Eigen::MatrixXd& jacDot() const;
 
 private:
@@ -70,7 +106,8 @@ private:
 	Eigen::VectorXd eval_;
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
-	Eigen::MatrixXd jacMat_;
+	Eigen::MatrixXd shortJacMat_;
+	FullJacobian jacMat_;
 	Eigen::MatrixXd jacDotMat_;
 };
 
@@ -89,6 +126,12 @@ public:
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		const std::vector<sva::MotionVecd>& normalAccB);
+	/**
+		* Same as update but with the body jacobian at the body origin in body
+		* coordinates (rbd::Jacobian::bodyJacobian) computed elsewhere.
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB, const Eigen::MatrixXd& bodyJac);
 	void updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 
 	const Eigen::VectorXd& eval() const;
@@ -96,6 +139,9 @@ public:
 	const Eigen::VectorXd& normalAcc() const;
 
 	const Eigen::MatrixXd& jac() const;
+	/// Jacobian restricted to the dof of the joints in jointsPath.
+	const Eigen::MatrixXd& shortJac() const;
+	const std::vector<int>& jointsPath() const;
 	const Eigen::MatrixXd& jacDot() const;
 
 private:
@@ -106,7 +152,8 @@ private:
 	Eigen::VectorXd eval_;
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
-	Eigen::MatrixXd jacMat_;
+	Eigen::MatrixXd shortJacMat_;
+	FullJacobian jacMat_;
 	Eigen::MatrixXd jacDotMat_;
 };
 
@@ -130,6 +177,9 @@ public:
 	const Eigen::VectorXd& normalAcc() const;
 
 	const Eigen::MatrixXd& jac() const;
+	/// Jacobian restricted to the dof of the joints in jointsPath.
+	const Eigen::MatrixXd& shortJac() const;
+	const std::vector<int>& jointsPath() const;
 
 protected:
 	sva::PTransformd X_0_t_;
@@ -140,7 +190,8 @@ protected:
 	Eigen::VectorXd eval_;
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
-	Eigen::MatrixXd jacMat_;
+	Eigen::MatrixXd shortJacMat_;
+	FullJacobian jacMat_;
 };
 
 
@@ -157,9 +208,12 @@ public:
 
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		const std::vector<sva::MotionVecd>& normalAccB);
-
-protected:
-	Eigen::MatrixXd jacMatTmp_;
+	/**
+		* Same as update but with the body jacobian at the body origin in body
+		* coordinates (rbd::Jacobian::bodyJacobian) computed elsewhere.
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB, const Eigen::MatrixXd& bodyJac);
 };
 
 
@@ -182,6 +236,12 @@ public:
 
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		const std::vector<sva::MotionVecd>& normalAccB);
+	/**
+		* Same as update but with the body jacobian at the body origin in body
+		* coordinates (rbd::Jacobian::bodyJacobian) computed elsewhere.
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB, const Eigen::MatrixXd& bodyJac);
 
 private:
 	Eigen::Matrix3d E_0_c_;
@@ -245,6 +305,12 @@ public:
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 			const std::vector<sva::MotionVecd>& normalAccB);
+	/**
+		* Same as update but with the body jacobian at the body origin in body
+		* coordinates (rbd::Jacobian::bodyJacobian) computed elsewhere.
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB, const Eigen::MatrixXd& bodyJac);
 	void updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 
 	const Eigen::VectorXd& eval() const;
@@ -252,6 +318,9 @@ public:
 	const Eigen::VectorXd& normalAcc() const;
 
 	const Eigen::MatrixXd& jac() const;
+	/// Jacobian restricted to the dof of the joints in jointsPath.
+	const Eigen::MatrixXd& shortJac() const;
+	const std::vector<int>& jointsPath() const;
 	const Eigen::MatrixXd& jacDot() const;
 
 private:
@@ -263,7 +332,8 @@ private:
 	Eigen::VectorXd eval_;
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
-	Eigen::MatrixXd jacMat_;
+	Eigen::MatrixXd shortJacMat_;
+	FullJacobian jacMat_;
 	Eigen::MatrixXd jacDotMat_;
 };
 
@@ -306,9 +376,10 @@ private:
 	Eigen::VectorXd eval_;
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
-	Eigen::MatrixXd jacMat_;
+	FullJacobian jacMat_;
 	Eigen::MatrixXd jacDotMat_;
 	Eigen::MatrixXd interactionMat_;
+	Eigen::MatrixXd shortJacMat_;
 };
 
 
@@ -318,8 +389,11 @@ class PostureTask
 public:
 	PostureTask(const rbd::MultiBody& mb, std::vector<std::vector<double> > q);
 
-	void posture(std::vector<std::vector<double> > q);
-	const std::vector<std::vector<double> > posture() const;
+	/// Copy q in the target posture, don't allocate if q has its sizes.
+	void posture(const std::vector<std::vector<double> >& q);
+	const std::vector<std::vector<double> >& posture() const;
+	/// Target posture, can be modified in place (see TargetBuffer).
+	std::vector<std::vector<double> >& posture();
 
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 	void updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
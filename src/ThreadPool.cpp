@@ -0,0 +1,175 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "ThreadPool.h"
+
+// includes
+// std
+#include <algorithm>
+
+// pthread
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+
+namespace tasks
+{
+
+
+ThreadPool::ThreadPool(int nrThreads, const std::vector<int>& cpus):
+	workers_(),
+	mutex_(),
+	start_(),
+	done_(),
+	generation_(0),
+	nrRunning_(0),
+	stop_(false),
+	fn_(nullptr),
+	context_(nullptr),
+	nrJobs_(0),
+	nextJob_(0),
+	error_()
+{
+	int nrWorkers = std::max(nrThreads - 1, 0);
+	workers_.reserve(nrWorkers);
+	for(int i = 0; i < nrWorkers; ++i)
+	{
+		workers_.emplace_back(&ThreadPool::workerLoop, this);
+#ifdef __linux__
+		if(std::size_t(i) < cpus.size() && cpus[i] >= 0)
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpus[i], &set);
+			pthread_setaffinity_np(workers_.back().native_handle(),
+				sizeof(cpu_set_t), &set);
+		}
+#endif
+	}
+#ifndef __linux__
+	static_cast<void>(cpus);
+#endif
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	start_.notify_all();
+
+	for(std::thread& t: workers_)
+	{
+		t.join();
+	}
+}
+
+
+int ThreadPool::nrThreads() const
+{
+	return int(workers_.size()) + 1;
+}
+
+
+void ThreadPool::run(int nrJobs, JobFunction fn, void* context)
+{
+	if(workers_.empty() || nrJobs <= 1)
+	{
+		for(int i = 0; i < nrJobs; ++i)
+		{
+			fn(context, i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		fn_ = fn;
+		context_ = context;
+		nrJobs_ = nrJobs;
+		nextJob_ = 0;
+		error_ = nullptr;
+		nrRunning_ = int(workers_.size());
+		++generation_;
+	}
+	start_.notify_all();
+
+	work();
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this]{ return nrRunning_ == 0; });
+
+	if(error_)
+	{
+		std::exception_ptr error = error_;
+		error_ = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+
+void ThreadPool::workerLoop()
+{
+	unsigned int generation = 0;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_.wait(lock, [this, generation]
+				{ return stop_ || generation_ != generation; });
+			if(stop_)
+			{
+				return;
+			}
+			generation = generation_;
+		}
+
+		work();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			--nrRunning_;
+		}
+		done_.notify_one();
+	}
+}
+
+
+void ThreadPool::work()
+{
+	int job;
+	while((job = nextJob_++) < nrJobs_)
+	{
+		try
+		{
+			fn_(context_, job);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if(!error_)
+			{
+				error_ = std::current_exception();
+			}
+		}
+	}
+}
+
+
+} // namespace tasks
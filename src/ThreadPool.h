@@ -0,0 +1,104 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace tasks
+{
+
+
+/**
+	* Pool of persistent worker threads that execute independent jobs.
+	* Workers are created once and wait between two ThreadPool::parallelFor
+	* calls so no thread is created at each call.
+	*/
+class ThreadPool
+{
+public:
+	typedef void (*JobFunction)(void* context, int job);
+
+public:
+	/**
+		* @param nrThreads Number of threads that execute the jobs, the calling
+		* thread is one of them so nrThreads - 1 workers are created.
+		* @param cpus CPU of each worker. Workers without CPU are not pinned.
+		* Ignored on systems without thread affinity.
+		*/
+	ThreadPool(int nrThreads, const std::vector<int>& cpus=std::vector<int>());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// Number of threads that execute the jobs (workers and calling thread).
+	int nrThreads() const;
+
+	/**
+		* Call fn(context, i) for i in [0, nrJobs) and wait for all jobs to end.
+		* Jobs are executed in any order and must not depend on each other.
+		* The first exception thrown by a job is rethrown.
+		*/
+	void run(int nrJobs, JobFunction fn, void* context);
+
+	/**
+		* Call f(i) for i in [0, nrJobs) and wait for all jobs to end.
+		* @see run
+		*/
+	template<typename Function>
+	void parallelFor(int nrJobs, Function& f)
+	{
+		run(nrJobs, &callFunction<Function>, &f);
+	}
+
+private:
+	template<typename Function>
+	static void callFunction(void* context, int job)
+	{
+		(*static_cast<Function*>(context))(job);
+	}
+
+	void workerLoop();
+	/// Execute jobs until there is no more.
+	void work();
+
+private:
+	std::vector<std::thread> workers_;
+
+	std::mutex mutex_;
+	std::condition_variable start_, done_;
+	/// incremented at each run to wake up the workers
+	unsigned int generation_;
+	int nrRunning_;
+	bool stop_;
+
+	JobFunction fn_;
+	void* context_;
+	int nrJobs_;
+	std::atomic<int> nextJob_;
+	std::exception_ptr error_;
+};
+
+
+} // namespace tasks
@@ -0,0 +1,140 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "TimeRecord.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+
+namespace tasks
+{
+
+
+TimeRecord::TimeRecord(int capacity):
+	times_(std::max(capacity, 1), 0.),
+	size_(0),
+	next_(0)
+{}
+
+
+void TimeRecord::capacity(int capacity)
+{
+	times_.assign(std::max(capacity, 1), 0.);
+	reset();
+}
+
+
+int TimeRecord::capacity() const
+{
+	return int(times_.size());
+}
+
+
+void TimeRecord::reset()
+{
+	size_ = 0;
+	next_ = 0;
+}
+
+
+void TimeRecord::add(double time)
+{
+	times_[next_] = time;
+	next_ = (next_ + 1) % int(times_.size());
+	size_ = std::min(size_ + 1, int(times_.size()));
+}
+
+
+int TimeRecord::size() const
+{
+	return size_;
+}
+
+
+std::vector<double> TimeRecord::times() const
+{
+	std::vector<double> times;
+	times.reserve(size_);
+	// the oldest duration is at next_ when the buffer is full
+	int first = size_ == int(times_.size()) ? next_ : 0;
+	for(int i = 0; i < size_; ++i)
+	{
+		times.push_back(times_[(first + i) % times_.size()]);
+	}
+	return times;
+}
+
+
+double TimeRecord::last() const
+{
+	if(size_ == 0)
+	{
+		return 0.;
+	}
+	return times_[(next_ + times_.size() - 1) % times_.size()];
+}
+
+
+double TimeRecord::min() const
+{
+	if(size_ == 0)
+	{
+		return 0.;
+	}
+	return *std::min_element(times_.begin(), times_.begin() + size_);
+}
+
+
+double TimeRecord::max() const
+{
+	if(size_ == 0)
+	{
+		return 0.;
+	}
+	return *std::max_element(times_.begin(), times_.begin() + size_);
+}
+
+
+double TimeRecord::mean() const
+{
+	if(size_ == 0)
+	{
+		return 0.;
+	}
+	return std::accumulate(times_.begin(), times_.begin() + size_, 0.)/size_;
+}
+
+
+double TimeRecord::percentile(double percent) const
+{
+	if(size_ == 0)
+	{
+		return 0.;
+	}
+
+	std::vector<double> sorted(times_.begin(), times_.begin() + size_);
+	double rank = std::ceil(std::min(std::max(percent, 0.), 100.)*size_/100.);
+	auto nth = sorted.begin() + std::max(int(rank) - 1, 0);
+	std::nth_element(sorted.begin(), nth, sorted.end());
+	return *nth;
+}
+
+
+} // namespace tasks
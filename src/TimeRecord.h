@@ -0,0 +1,83 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <chrono>
+#include <vector>
+
+
+namespace tasks
+{
+
+
+/**
+	* Ring buffer of the last measured durations of an operation.
+	* Adding a time never allocate memory so records can be filled
+	* in the control loop.
+	*/
+class TimeRecord
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+public:
+	/// @param capacity Number of durations kept, older ones are overwritten.
+	TimeRecord(int capacity=1000);
+
+	/// Change the number of durations kept and remove all durations.
+	void capacity(int capacity);
+	int capacity() const;
+
+	/// Remove all durations.
+	void reset();
+
+	/// Add a duration in seconds.
+	void add(double time);
+	/// Add the duration elapsed since start.
+	void add(Clock::time_point start)
+	{
+		add(std::chrono::duration<double>(Clock::now() - start).count());
+	}
+
+	/// Number of durations kept.
+	int size() const;
+
+	/// Durations in seconds from the oldest to the newest.
+	std::vector<double> times() const;
+
+	/// All statistics are in seconds and are 0 if the record is empty.
+	double last() const;
+	double min() const;
+	double max() const;
+	double mean() const;
+	/**
+		* @param percent Percentage in [0, 100].
+		* @return Smallest kept duration with at least percent % of the
+		* durations lower or equal to it (100 is max).
+		*/
+	double percentile(double percent) const;
+
+private:
+	std::vector<double> times_;
+	int size_;
+	/// index of the next added duration
+	int next_;
+};
+
+
+} // namespace tasks
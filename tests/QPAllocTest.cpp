@@ -0,0 +1,540 @@
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// includes
+// std
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <tuple>
+
+// boost
+#define BOOST_TEST_MODULE QPAllocTest
+#include <boost/test/unit_test.hpp>
+#include <boost/math/constants/constants.hpp>
+
+// SpaceVecAlg
+#include <SpaceVecAlg/SpaceVecAlg>
+
+// RBDyn
+#include <RBDyn/EulerIntegration.h>
+#include <RBDyn/FK.h>
+#include <RBDyn/FV.h>
+
+// sch
+#include <sch/S_Object/S_Sphere.h>
+#include <sch/CD/CD_Pair.h>
+
+// Tasks
+#include "Bounds.h"
+#include "QPConstr.h"
+#include "QPContactConstr.h"
+#include "QPMotionConstr.h"
+#include "QPSolver.h"
+#include "QPTasks.h"
+
+// Arms
+#include "arms.h"
+
+
+
+/**
+	*													Allocation counter
+	*/
+
+
+
+namespace
+{
+
+std::atomic<bool> countAlloc(false);
+std::atomic<int> nrAlloc(0);
+
+void newAlloc()
+{
+	if(countAlloc.load(std::memory_order_relaxed))
+	{
+		nrAlloc.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/// Count the heap allocations made by all threads until stop is called.
+struct AllocCounter
+{
+	AllocCounter()
+	{
+		nrAlloc = 0;
+		countAlloc = true;
+	}
+
+	~AllocCounter()
+	{
+		stop();
+	}
+
+	int stop()
+	{
+		countAlloc = false;
+		return nrAlloc;
+	}
+};
+
+} // anonymous namespace
+
+
+#ifdef __GLIBC__
+// the executable malloc family is used by all the shared libraries
+// (Tasks, RBDyn, Eigen, libstdc++ operator new...)
+// so we count the allocations and forward them to the glibc allocator
+extern "C"
+{
+
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t nmemb, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+
+void* malloc(std::size_t size)
+{
+	newAlloc();
+	return __libc_malloc(size);
+}
+
+
+void* calloc(std::size_t nmemb, std::size_t size)
+{
+	newAlloc();
+	return __libc_calloc(nmemb, size);
+}
+
+
+void* realloc(void* ptr, std::size_t size)
+{
+	newAlloc();
+	return __libc_realloc(ptr, size);
+}
+
+
+void* memalign(std::size_t alignment, std::size_t size)
+{
+	newAlloc();
+	return __libc_memalign(alignment, size);
+}
+
+
+void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+	newAlloc();
+	return __libc_memalign(alignment, size);
+}
+
+
+int posix_memalign(void** memptr, std::size_t alignment, std::size_t size)
+{
+	newAlloc();
+	*memptr = __libc_memalign(alignment, size);
+	return *memptr ? 0 : ENOMEM;
+}
+
+} // extern "C"
+#endif
+
+
+
+BOOST_AUTO_TEST_CASE(AllocCounterTest)
+{
+#ifndef __GLIBC__
+	BOOST_TEST_MESSAGE("Allocation counter need glibc, test skipped");
+	return;
+#endif
+
+	// check that the counter see the allocations of a temporary vector
+	Eigen::MatrixXd mat(Eigen::MatrixXd::Random(6, 6));
+	Eigen::VectorXd vec(Eigen::VectorXd::Random(6));
+	Eigen::VectorXd res(6);
+
+	int nrNoAlias = 0, nrTmp = 0;
+	{
+		AllocCounter count;
+		res.noalias() = mat*vec;
+		nrNoAlias = count.stop();
+	}
+	{
+		AllocCounter count;
+		Eigen::VectorXd tmp(mat*vec);
+		res = tmp;
+		nrTmp = count.stop();
+	}
+
+	BOOST_CHECK_EQUAL(nrNoAlias, 0);
+	BOOST_CHECK_GT(nrTmp, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(QPNoAllocTest)
+{
+#ifndef __GLIBC__
+	BOOST_TEST_MESSAGE("Allocation counter need glibc, test skipped");
+	return;
+#endif
+
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+
+	// solver name and number of update threads
+	std::vector<std::tuple<std::string, int>> configs =
+		{std::make_tuple("QLD", 1), std::make_tuple("GI", 1),
+		 std::make_tuple("ADMM", 1), std::make_tuple("QLD", 2)};
+
+	for(const auto& config: configs)
+	{
+		BOOST_TEST_MESSAGE(std::get<0>(config) << " " << std::get<1>(config));
+
+		std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+		qp::QPSolver solver;
+		solver.solver(std::get<0>(config));
+		solver.nrThreads(std::get<1>(config));
+
+		ZXZArmProblem arm(mbs, mbcInit);
+		arm.addToSolver(mbs, solver);
+
+		// posture targets published at each solve are copied in place
+		typedef std::vector<std::vector<double>> Posture;
+		TargetBuffer<Posture> postureBuffer(arm.postureTask.posture());
+		solver.addTargetBuffer(&postureBuffer);
+		Posture posture = arm.postureTask.posture();
+
+		for(int i = 0; i < 200; ++i)
+		{
+			posture[1][0] = 0.001*i;
+
+			// first solve can allocate
+			AllocCounter count;
+			postureBuffer.write(posture);
+			bool success = solver.solve(mbs, mbcs);
+			arm.motionCstr.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+			int nrSolveAlloc = count.stop();
+
+			BOOST_REQUIRE(success);
+			BOOST_REQUIRE_EQUAL(arm.postureTask.posture()[1][0], posture[1][0]);
+			if(i > 0)
+			{
+				BOOST_REQUIRE_EQUAL(nrSolveAlloc, 0);
+			}
+
+			eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+			forwardKinematics(mbs[0], mbcs[0]);
+			forwardVelocity(mbs[0], mbcs[0]);
+		}
+	}
+}
+
+
+// Two arms linked by a contact with a self collision on the first one,
+// like QPNoAllocTest with the contact, lambda and collision paths.
+BOOST_AUTO_TEST_CASE(QPContactCollNoAllocTest)
+{
+#ifndef __GLIBC__
+	BOOST_TEST_MESSAGE("Allocation counter need glibc, test skipped");
+	return;
+#endif
+
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb1, mb2;
+	MultiBodyConfig mbc1Init, mbc2Init;
+
+	std::tie(mb1, mbc1Init) = makeZXZArm();
+	std::tie(mb2, mbc2Init) = makeZXZArm();
+
+	forwardKinematics(mb1, mbc1Init);
+	forwardVelocity(mb1, mbc1Init);
+	forwardKinematics(mb2, mbc2Init);
+	forwardVelocity(mb2, mbc2Init);
+
+	sva::PTransformd X_b1_b2(mbc2Init.bodyPosW.back()*mbc1Init.bodyPosW.back().inv());
+
+	std::vector<MultiBody> mbs = {mb1, mb2};
+
+	std::vector<qp::UnilateralContact> contVec =
+		{qp::UnilateralContact(0, 1, 3, 3,
+			{Vector3d::Zero()}, RotX(cst::pi<double>()/2.), X_b1_b2,
+			3, std::tan(cst::pi<double>()/4.))};
+
+	TorqueBound tBound({{}, {-30.}, {-30.}, {-30.}}, {{}, {30.}, {30.}, {30.}});
+
+	// solver name, number of update threads and number of collision threads
+	std::vector<std::tuple<std::string, int, int>> configs =
+		{std::make_tuple("QLD", 1, 1), std::make_tuple("GI", 1, 1),
+		 std::make_tuple("ADMM", 1, 1), std::make_tuple("QLD", 2, 2)};
+
+	for(const auto& config: configs)
+	{
+		BOOST_TEST_MESSAGE(std::get<0>(config) << " " << std::get<1>(config) <<
+			" " << std::get<2>(config));
+
+		std::vector<MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+		qp::QPSolver solver;
+		solver.solver(std::get<0>(config));
+		solver.nrThreads(std::get<1>(config));
+
+		qp::PositionTask posTask(mbs, 1, 3, mbc2Init.bodyPosW.back().translation());
+		qp::SetPointTask posTaskSp(mbs, 1, &posTask, 50., 1.);
+
+		qp::ContactAccConstr contCstrAcc;
+		qp::PositiveLambda lambdaCstr;
+		qp::MotionConstr motion1(mbs, 0, tBound);
+		qp::MotionConstr motion2(mbs, 1, tBound);
+
+		sch::S_Sphere b0(0.25), b3(0.25);
+		PTransformd I = PTransformd::Identity();
+		qp::CollisionConstr collCstr(mbs, 0.001);
+		collCstr.nrThreads(std::get<2>(config));
+		collCstr.addCollision(mbs, 10, 0, 0, &b0, I, 0, 3, &b3, I, 0.1, 0.01, 0.);
+
+		contCstrAcc.addToSolver(solver);
+		lambdaCstr.addToSolver(solver);
+		motion1.addToSolver(solver);
+		motion2.addToSolver(solver);
+		collCstr.addToSolver(solver);
+		solver.addTask(&posTaskSp);
+
+		solver.nrVars(mbs, contVec, {});
+		solver.updateConstrSize();
+
+		for(int i = 0; i < 200; ++i)
+		{
+			posTask.position(RotX(0.01)*posTask.position());
+
+			// first solve can allocate
+			AllocCounter count;
+			bool success = solver.solve(mbs, mbcs);
+			motion1.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+			motion2.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+			int nrSolveAlloc = count.stop();
+
+			BOOST_REQUIRE(success);
+			if(i > 0)
+			{
+				BOOST_REQUIRE_EQUAL(nrSolveAlloc, 0);
+			}
+
+			for(std::size_t r = 0; r < mbs.size(); ++r)
+			{
+				eulerIntegration(mbs[r], mbcs[r], 0.001);
+
+				forwardKinematics(mbs[r], mbcs[r]);
+				forwardVelocity(mbs[r], mbcs[r]);
+			}
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(QPReserveNoAllocTest)
+{
+#ifndef __GLIBC__
+	BOOST_TEST_MESSAGE("Allocation counter need glibc, test skipped");
+	return;
+#endif
+
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	std::vector<std::vector<double> > lTBound = {{}, {-30.}, {-30.}, {-30.}};
+	std::vector<std::vector<double> > uTBound = {{}, {30.}, {30.}, {30.}};
+
+	// only the GI solver keep its reserved buffers (see GenQPSolver::reserve)
+	for(const char* name: {"GI"})
+	{
+		BOOST_TEST_MESSAGE(name);
+
+		qp::QPSolver solver;
+		solver.solver(name);
+		// 3 torque lines of the motion constraint
+		solver.reserve(0, 0, 0, 3);
+
+		qp::PostureTask postureTask(mbs, 0, {{}, {0.2}, {0.2}, {0.2}}, 1., 0.01);
+		qp::MotionConstr motionCstr(mbs, 0, {lTBound, uTBound});
+
+		solver.addTask(&postureTask);
+		solver.nrVars(mbs, {}, {});
+		solver.updateConstrSize();
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+		// adding and removing the motion constraint keep the QP solver size
+		for(int i = 0; i < 10; ++i)
+		{
+			if(i%2 == 0)
+			{
+				motionCstr.addToSolver(mbs, solver);
+			}
+			else
+			{
+				motionCstr.removeFromSolver(solver);
+			}
+
+			// first solve with the constraint can allocate its matrices
+			AllocCounter count;
+			solver.updateConstrSize();
+			bool success = solver.solve(mbs, mbcs);
+			int nrSolveAlloc = count.stop();
+
+			BOOST_REQUIRE(success);
+			if(i > 1)
+			{
+				BOOST_REQUIRE_EQUAL(nrSolveAlloc, 0);
+			}
+		}
+	}
+}
+
+
+// One arm in contact with a second fixed arm, a contact and a collision pair
+// are added and removed below the lambda capacity and the reserved sizes.
+BOOST_AUTO_TEST_CASE(QPContactSwitchNoAllocTest)
+{
+#ifndef __GLIBC__
+	BOOST_TEST_MESSAGE("Allocation counter need glibc, test skipped");
+	return;
+#endif
+
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb1, mb2;
+	MultiBodyConfig mbc1Init, mbc2Init;
+
+	std::tie(mb1, mbc1Init) = makeZXZArm();
+	std::tie(mb2, mbc2Init) = makeZXZArm();
+
+	forwardKinematics(mb1, mbc1Init);
+	forwardVelocity(mb1, mbc1Init);
+	forwardKinematics(mb2, mbc2Init);
+	forwardVelocity(mb2, mbc2Init);
+
+	std::vector<MultiBody> mbs = {mb1, mb2};
+	std::vector<MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+	sva::PTransformd X_b1_b2(mbc2Init.bodyPosW[3]*mbc1Init.bodyPosW[3].inv());
+	sva::PTransformd X_b1_b2_2(mbc2Init.bodyPosW[2]*mbc1Init.bodyPosW[2].inv());
+
+	qp::UnilateralContact contact3(0, 1, 3, 3,
+		{Vector3d::Zero()}, RotX(cst::pi<double>()/2.), X_b1_b2,
+		3, std::tan(cst::pi<double>()/4.));
+	qp::UnilateralContact contact2(0, 1, 2, 2,
+		{Vector3d::Zero()}, RotX(cst::pi<double>()/2.), X_b1_b2_2,
+		3, std::tan(cst::pi<double>()/4.));
+
+	TorqueBound tBound({{}, {-30.}, {-30.}, {-30.}}, {{}, {30.}, {30.}, {30.}});
+
+	qp::QPSolver solver;
+	// only the GI solver keep its reserved buffers (see GenQPSolver::reserve)
+	solver.solver("GI");
+	solver.lambdaCapacity(3 + 3);
+	// one collision line
+	solver.reserve(0, 0, 1, 0);
+
+	qp::PositionTask posTask(mbs, 0, 3, mbc1Init.bodyPosW[3].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+
+	qp::PositiveLambda lambdaCstr;
+	qp::MotionConstr motion1(mbs, 0, tBound);
+
+	sch::S_Sphere b0(0.25), b3(0.25);
+	PTransformd I = PTransformd::Identity();
+	qp::CollisionConstr collCstr(mbs, 0.001);
+	collCstr.reserve(1);
+
+	lambdaCstr.addToSolver(solver);
+	motion1.addToSolver(solver);
+	collCstr.addToSolver(solver);
+	solver.addTask(&posTaskSp);
+
+	solver.nrVars(mbs, {contact3}, {});
+	solver.updateConstrSize();
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+	for(int i = 0; i < 20; ++i)
+	{
+		// addCollision build the pair body jacobians, the CD_Pair memory
+		// and the constraint lines are reserved
+		if(i%2 == 0)
+		{
+			collCstr.addCollision(mbs, 10, 0, 0, &b0, I, 0, 3, &b3, I, 0.1, 0.01, 0.);
+		}
+		else
+		{
+			BOOST_REQUIRE(collCstr.rmCollision(10));
+		}
+
+		// first cycle can allocate the contact memory and the constraints caches
+		AllocCounter count;
+		bool switched = i%2 == 0 ? solver.addContact(mbs, contact2) :
+			solver.removeContact(mbs, contact2.contactId);
+		collCstr.updateNrCollisions();
+		solver.updateConstrSize();
+		bool success = solver.solve(mbs, mbcs);
+		motion1.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+		int nrSwitchAlloc = count.stop();
+
+		BOOST_REQUIRE(switched);
+		BOOST_REQUIRE(success);
+		BOOST_REQUIRE_EQUAL(solver.nrVars(), 3 + 3 + 3 + (i%2 == 0 ? 3 : 0));
+		if(i > 1)
+		{
+			BOOST_REQUIRE_EQUAL(nrSwitchAlloc, 0);
+		}
+	}
+}
@@ -102,6 +102,12 @@ BOOST_AUTO_TEST_CASE(TwoArmContactTest)
 	// 3 dof + 3 dof + 3 lambda
 	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3 + 3);
 
+	// contacts are indexed by their id
+	BOOST_CHECK_EQUAL(solver.data().contactIndex(qp::ContactId(0, 1, 3, 3)), 0);
+	BOOST_CHECK_EQUAL(solver.data().contactIndex(qp::ContactId(1, 0, 3, 3)), -1);
+	BOOST_CHECK_EQUAL(solver.contactLambdaPosition(qp::ContactId(0, 1, 3, 3)), 0);
+	BOOST_CHECK_EQUAL(solver.contactLambdaPosition(qp::ContactId(1, 0, 3, 3)), -1);
+
 	for(int i = 0; i < 1000; ++i)
 	{
 		BOOST_REQUIRE(solver.solve(mbs, mbcs));
@@ -160,6 +166,378 @@ BOOST_AUTO_TEST_CASE(TwoArmContactTest)
 }
 
 
+// Test that adding and removing a contact with addContact and removeContact
+// give the same problem than a call to nrVars with the new contact set.
+BOOST_AUTO_TEST_CASE(TwoArmIncrementalContactTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb1, mb2;
+	MultiBodyConfig mbc1Init, mbc2Init;
+
+	std::tie(mb1, mbc1Init) = makeZXZArm();
+	std::tie(mb2, mbc2Init) = makeZXZArm();
+
+	forwardKinematics(mb1, mbc1Init);
+	forwardVelocity(mb1, mbc1Init);
+	forwardKinematics(mb2, mbc2Init);
+	forwardVelocity(mb2, mbc2Init);
+
+	sva::PTransformd X_0_b1(mbc1Init.bodyPosW.back());
+	sva::PTransformd X_0_b2(mbc2Init.bodyPosW.back());
+	sva::PTransformd X_b1_b2(X_0_b2*X_0_b1.inv());
+
+	std::vector<MultiBody> mbs = {mb1, mb2};
+	std::vector<MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+	qp::UnilateralContact contact(0, 1, 3, 3,
+		{Vector3d::Zero()}, RotX(cst::pi<double>()/2.), X_b1_b2,
+		3, std::tan(cst::pi<double>()/4.));
+
+	Matrix3d oriD = RotZ(cst::pi<double>()/4.);
+	Vector3d posD(oriD*mbc2Init.bodyPosW.back().translation());
+	qp::PositionTask posTask(mbs, 1, 3, posD);
+	qp::SetPointTask posTaskSp(mbs, 1, &posTask, 1000., 1.);
+
+	// incremental solver start without contact
+	qp::QPSolver solver;
+	qp::ContactAccConstr contCstr;
+	contCstr.addToSolver(solver);
+	solver.addTask(&posTaskSp);
+
+	solver.reserve(3 + 3 + 3, 0, 0, 0);
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	// unused lambda are reserved in the constraints but not in the QP
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().maxNrVars(), 3 + 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().totalLambda(), 0);
+
+	// reference solver
+	qp::QPSolver solverRef;
+	qp::ContactAccConstr contCstrRef;
+	contCstrRef.addToSolver(solverRef);
+	solverRef.addTask(&posTaskSp);
+
+	solverRef.nrVars(mbs, {contact}, {});
+	solverRef.updateConstrSize();
+
+	BOOST_REQUIRE(solver.addContact(mbs, contact));
+	BOOST_CHECK(!solver.addContact(mbs, contact));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().maxNrVars(), 3 + 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().totalLambda(), 3);
+	BOOST_CHECK_EQUAL(solver.data().contactIndex(contact.contactId), 0);
+
+	std::vector<MultiBodyConfig> mbcsRef = mbcs;
+	for(int i = 0; i < 100; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_REQUIRE(solverRef.solve(mbs, mbcsRef));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - solverRef.alphaDVec()).norm(), 1e-6);
+		BOOST_CHECK_SMALL((solver.lambdaVec() - solverRef.lambdaVec()).norm(), 1e-6);
+		for(std::size_t r = 0; r < mbs.size(); ++r)
+		{
+			eulerIntegration(mbs[r], mbcs[r], 0.001);
+
+			forwardKinematics(mbs[r], mbcs[r]);
+			forwardVelocity(mbs[r], mbcs[r]);
+
+			mbcsRef[r] = mbcs[r];
+		}
+	}
+
+	// removing the contact release the link
+	solverRef.nrVars(mbs, {}, {});
+	solverRef.updateConstrSize();
+
+	BOOST_REQUIRE(solver.removeContact(mbs, contact.contactId));
+	BOOST_CHECK(!solver.removeContact(mbs, contact.contactId));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().maxNrVars(), 3 + 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().totalLambda(), 0);
+	BOOST_CHECK_EQUAL(solver.data().contactIndex(contact.contactId), -1);
+
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+	BOOST_REQUIRE(solverRef.solve(mbs, mbcsRef));
+	BOOST_CHECK_SMALL((solver.alphaDVec() - solverRef.alphaDVec()).norm(), 1e-6);
+
+	// without reserved variables the constraints grow
+	solver.reserve(0, 0, 0, 0);
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().maxNrVars(), 3 + 3);
+	BOOST_REQUIRE(solver.addContact(mbs, contact));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().maxNrVars(), 3 + 3 + 3);
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+	// the lambda capacity reserve lambda columns
+	solver.lambdaCapacity(3);
+	BOOST_CHECK_EQUAL(solver.lambdaCapacity(), 3);
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().maxNrVars(), 3 + 3 + 3);
+	BOOST_REQUIRE(solver.addContact(mbs, contact));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().totalLambda(), 3);
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+	// contact change inside the lambda capacity with a motion constraint,
+	// its lines don't move so the removed contact columns must be cleared
+	std::vector<std::vector<double>> torqueMin = {{},{-1.},{-1.},{-1.}};
+	std::vector<std::vector<double>> torqueMax = {{},{1.},{1.},{1.}};
+	qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstr;
+	motionCstr.addToSolver(solver);
+	plCstr.addToSolver(solver);
+	solver.nrVars(mbs, {contact}, {});
+	solver.updateConstrSize();
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+	qp::MotionConstr motionCstrRef(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstrRef;
+	motionCstrRef.addToSolver(solverRef);
+	plCstrRef.addToSolver(solverRef);
+	solverRef.nrVars(mbs, {}, {});
+	solverRef.updateConstrSize();
+
+	BOOST_REQUIRE(solver.removeContact(mbs, contact.contactId));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3);
+	BOOST_CHECK_EQUAL(solver.data().totalLambda(), 0);
+
+	mbcsRef = mbcs;
+	for(int i = 0; i < 10; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_REQUIRE(solverRef.solve(mbs, mbcsRef));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - solverRef.alphaDVec()).norm(), 1e-6);
+		// the removed lambda are not in the QP
+		BOOST_CHECK_EQUAL(solver.result().size(), 3 + 3);
+		for(std::size_t r = 0; r < mbs.size(); ++r)
+		{
+			eulerIntegration(mbs[r], mbcs[r], 0.001);
+
+			forwardKinematics(mbs[r], mbcs[r]);
+			forwardVelocity(mbs[r], mbcs[r]);
+
+			mbcsRef[r] = mbcs[r];
+		}
+	}
+
+	// adding it back inside the capacity give the nrVars solution
+	solverRef.nrVars(mbs, {contact}, {});
+	solverRef.updateConstrSize();
+
+	BOOST_REQUIRE(solver.addContact(mbs, contact));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3 + 3);
+
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+	BOOST_REQUIRE(solverRef.solve(mbs, mbcsRef));
+	BOOST_CHECK_SMALL((solver.alphaDVec() - solverRef.alphaDVec()).norm(), 1e-6);
+	BOOST_CHECK_SMALL((solver.lambdaVec() - solverRef.lambdaVec()).norm(), 1e-6);
+}
+
+
+// Test that addContact resize the QP solver when the number of variables
+// exceed the reserved one and the constraints lines don't change.
+BOOST_AUTO_TEST_CASE(IncrementalContactResizeTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+	qp::UnilateralContact contact(0, 1, 3, 0,
+		{Vector3d::Zero()}, RotX(cst::pi<double>()/2.),
+		mbcInit.bodyPosW.back().inv(), 3, std::tan(cst::pi<double>()/4.));
+
+	int bodyI = mb.bodyIndexById(3);
+	qp::PositionTask posTask(mbs, 0, 3,
+		RotX(0.1)*mbcInit.bodyPosW[bodyI].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+
+	double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin = {{},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax = {{},{Inf},{Inf},{Inf}};
+
+	// MotionConstr and PositiveLambda lines don't depend on the contacts
+	qp::QPSolver solver;
+	qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstr;
+	motionCstr.addToSolver(solver);
+	plCstr.addToSolver(solver);
+	solver.addTask(&posTaskSp);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+	qp::QPSolver solverRef;
+	qp::MotionConstr motionCstrRef(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstrRef;
+	motionCstrRef.addToSolver(solverRef);
+	plCstrRef.addToSolver(solverRef);
+	solverRef.addTask(&posTaskSp);
+
+	solverRef.nrVars(mbs, {contact}, {});
+	solverRef.updateConstrSize();
+
+	BOOST_REQUIRE(solver.addContact(mbs, contact));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3);
+
+	std::vector<MultiBodyConfig> mbcsRef = mbcs;
+	for(int i = 0; i < 10; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_REQUIRE(solverRef.solve(mbs, mbcsRef));
+		BOOST_REQUIRE_EQUAL(solver.lambdaVec().size(), 3);
+		BOOST_CHECK_SMALL((solver.alphaDVec() - solverRef.alphaDVec()).norm(), 1e-6);
+		BOOST_CHECK_SMALL((solver.lambdaVec() - solverRef.lambdaVec()).norm(), 1e-6);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+
+		mbcsRef[0] = mbcs[0];
+	}
+
+	// removing the contact shrink the problem again
+	BOOST_REQUIRE(solver.removeContact(mbs, contact.contactId));
+	BOOST_CHECK_EQUAL(solver.nrVars(), 3);
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+}
+
+
+// Test that removeContact inside the lambda capacity clear the lambda columns
+// of the removed contact in the MotionConstr lines.
+// The first contact is removed so the second contact lambda are shifted
+// and its old columns must be cleared too.
+BOOST_AUTO_TEST_CASE(IncrementalContactCapacityTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+
+	int body2I = mb.bodyIndexById(2);
+	int body3I = mb.bodyIndexById(3);
+	qp::UnilateralContact contact2(0, 1, 2, 0,
+		{Vector3d::Zero()}, RotX(cst::pi<double>()/2.),
+		mbcInit.bodyPosW[body2I].inv(), 3, std::tan(cst::pi<double>()/4.));
+	qp::UnilateralContact contact3(0, 1, 3, 0,
+		{Vector3d::Zero()}, RotX(cst::pi<double>()/2.),
+		mbcInit.bodyPosW[body3I].inv(), 3, std::tan(cst::pi<double>()/4.));
+
+	qp::PositionTask posTask(mbs, 0, 3,
+		RotX(0.1)*mbcInit.bodyPosW[body3I].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+
+	// the torque can't hold the arm so the contact forces
+	// change the motion
+	std::vector<std::vector<double>> torqueMin = {{},{-1.},{-1.},{-1.}};
+	std::vector<std::vector<double>> torqueMax = {{},{1.},{1.},{1.}};
+
+	for(const char* name: {"QLD", "GI"})
+	{
+		BOOST_TEST_MESSAGE(name);
+		std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+		qp::QPSolver solver;
+		solver.solver(name);
+		qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+		qp::PositiveLambda plCstr;
+		motionCstr.addToSolver(solver);
+		plCstr.addToSolver(solver);
+		solver.addTask(&posTaskSp);
+
+		solver.lambdaCapacity(3 + 3);
+		solver.nrVars(mbs, {contact2, contact3}, {});
+		solver.updateConstrSize();
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+		// reference solver built with nrVars
+		qp::QPSolver solverRef;
+		solverRef.solver(name);
+		qp::MotionConstr motionCstrRef(mbs, 0, {torqueMin, torqueMax});
+		qp::PositiveLambda plCstrRef;
+		motionCstrRef.addToSolver(solverRef);
+		plCstrRef.addToSolver(solverRef);
+		solverRef.addTask(&posTaskSp);
+
+		solverRef.nrVars(mbs, {contact3}, {});
+		solverRef.updateConstrSize();
+
+		BOOST_CHECK_NO_THROW(solver.data().bodyJacobianIndex(mbs, 0, 2));
+		BOOST_REQUIRE(solver.removeContact(mbs, contact2.contactId));
+		BOOST_CHECK_EQUAL(solver.nrVars(), 3 + 3);
+		BOOST_CHECK_EQUAL(solver.data().maxNrVars(), 3 + 3 + 3);
+		BOOST_CHECK_EQUAL(solver.data().totalLambda(), 3);
+		// the removed contact body jacobian is not computed anymore
+		BOOST_CHECK_THROW(solver.data().bodyJacobianIndex(mbs, 0, 2),
+			std::domain_error);
+		BOOST_CHECK_NO_THROW(solver.data().bodyJacobianIndex(mbs, 0, 3));
+
+		std::vector<MultiBodyConfig> mbcsRef = mbcs;
+		for(int i = 0; i < 10; ++i)
+		{
+			BOOST_REQUIRE(solver.solve(mbs, mbcs));
+			BOOST_REQUIRE(solverRef.solve(mbs, mbcsRef));
+			BOOST_CHECK_SMALL((solver.alphaDVec() - solverRef.alphaDVec()).norm(),
+				1e-6);
+			BOOST_CHECK_SMALL((solver.lambdaVec() - solverRef.lambdaVec()).norm(),
+				1e-6);
+			// unused lambda are not in the QP
+			BOOST_CHECK_EQUAL(solver.result().size(), 3 + 3);
+
+			eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+			forwardKinematics(mbs[0], mbcs[0]);
+			forwardVelocity(mbs[0], mbcs[0]);
+
+			mbcsRef[0] = mbcs[0];
+		}
+	}
+}
+
+
 // Test Motion constraint
 // We setup two arm, one with a fixed base and the second
 // with a freebase put on the body b3 of the first robot.
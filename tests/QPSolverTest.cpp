@@ -17,6 +17,7 @@
 // std
 #include <fstream>
 #include <iostream>
+#include <thread>
 #include <tuple>
 
 // boost
@@ -32,6 +33,7 @@
 
 // RBDyn
 #include <RBDyn/EulerIntegration.h>
+#include <RBDyn/FD.h>
 #include <RBDyn/FK.h>
 #include <RBDyn/FV.h>
 #include <RBDyn/ID.h>
@@ -43,6 +45,8 @@
 
 // Tasks
 #include "Bounds.h"
+#include "GenQPSolver.h"
+#include "GenQPUtils.h"
 #include "QPConstr.h"
 #include "QPContactConstr.h"
 #include "QPMotionConstr.h"
@@ -121,6 +125,14 @@ BOOST_AUTO_TEST_CASE(QPTaskTest)
 	qp::PositionTask posTask(mbs, 0, 3, posD);
 	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
 
+	// negative dimension weights are rejected
+	qp::TargetObjectiveTask posTaskTo(mbs, 0, &posTask, 0.001, 1.,
+		Vector3d::Zero(), 1.);
+	BOOST_CHECK_THROW(posTaskSp.dimWeight(Vector3d(1., -1., 1.)),
+		std::domain_error);
+	BOOST_CHECK_THROW(posTaskTo.dimWeight(Vector3d(1., -1., 1.)),
+		std::domain_error);
+
 	// Test addTask
 	solver.addTask(&posTaskSp);
 	BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
@@ -792,6 +804,201 @@ BOOST_AUTO_TEST_CASE(QPTorqueLimitsTest)
 
 
 
+// MotionConstr on the same robot share the SolverData inertia matrix.
+BOOST_AUTO_TEST_CASE(QPMotionConstrDynamicsTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeBranchedArm(false);
+
+	// non zero velocity so C is not only the gravity
+	for(int i = 0; i < mb.nrJoints(); ++i)
+	{
+		for(int j = 0; j < mb.joint(i).dof(); ++j)
+		{
+			mbcInit.alpha[i][j] = 0.1*(i + j + 1);
+		}
+	}
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<MultiBody> mbs = {mb};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::QPSolver solver;
+
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 1.);
+
+	std::vector<std::vector<double>> torqueMin(mb.nrJoints()), torqueMax(mb.nrJoints());
+	for(int i = 0; i < mb.nrJoints(); ++i)
+	{
+		torqueMin[i].assign(mb.joint(i).dof(), -100.);
+		torqueMax[i].assign(mb.joint(i).dof(), 100.);
+	}
+	qp::MotionConstr motion1(mbs, 0, {torqueMin, torqueMax});
+	qp::MotionConstr motion2(mbs, 0, {torqueMin, torqueMax});
+
+	motion1.addToSolver(solver);
+	motion2.addToSolver(solver);
+	solver.addTask(&postureTask);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	ForwardDynamics fd(mb);
+	int nrDof = mb.nrDof();
+	for(int i = 0; i < 10; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+		fd.computeH(mb, mbcs[0]);
+		fd.computeC(mb, mbcs[0]);
+		for(const qp::MotionConstr* motion: {&motion1, &motion2})
+		{
+			BOOST_CHECK_SMALL((motion->AGenInEq().block(0, 0, nrDof, nrDof) -
+				fd.H()).norm(), 1e-8);
+			// torque bounds are symmetric
+			BOOST_CHECK_SMALL(((motion->LowerGenInEq() +
+				motion->UpperGenInEq())/2. + fd.C()).norm(), 1e-8);
+		}
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+}
+
+
+
+// MotionConstr only fill the non zero H and J^T G blocks,
+// check them against the dense assembly.
+BOOST_AUTO_TEST_CASE(QPMotionConstrDenseTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeBranchedArm(false);
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	for(int i = 1; i < mb.nrJoints(); ++i)
+	{
+		mbcInit.q[i][0] = 0.2*i;
+	}
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+	qp::QPSolver solver;
+
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 1.);
+
+	std::vector<std::vector<double>> torqueMin(mb.nrJoints()), torqueMax(mb.nrJoints());
+	for(int i = 0; i < mb.nrJoints(); ++i)
+	{
+		torqueMin[i].assign(mb.joint(i).dof(), -100.);
+		torqueMax[i].assign(mb.joint(i).dof(), 100.);
+	}
+	qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstr;
+
+	motionCstr.addToSolver(solver);
+	plCstr.addToSolver(solver);
+	solver.addTask(&postureTask);
+
+	// multi points contact between b2 and the environment and self contact
+	// between the two branches end, the self contact lambda are shared
+	// by b2 and b4 that have different paths
+	std::vector<Vector3d> points =
+		{Vector3d(0.1, 0., 0.1), Vector3d(-0.1, 0., 0.1), Vector3d(0., 0.1, -0.1)};
+	std::vector<qp::UnilateralContact> contVec =
+		{qp::UnilateralContact(0, 1, 2, 0, points, RotX(cst::pi<double>()/2.),
+			PTransformd::Identity(), 3, 0.7),
+		 qp::UnilateralContact(0, 0, 2, 4, points, Matrix3d::Identity(),
+			PTransformd(Vector3d(0., 1., 0.)), 4, 0.5)};
+
+	solver.nrVars(mbs, contVec, {});
+	solver.updateConstrSize();
+
+	ForwardDynamics fd(mb);
+	int nrDof = mb.nrDof();
+	int nrLambda = solver.data().totalLambda();
+	int lambdaBegin = solver.data().lambdaBegin();
+	MatrixXd denseLambda(nrDof, nrLambda), fullJac;
+	for(int i = 0; i < 10; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		const MultiBodyConfig& mbc = mbcs[0];
+
+		// lambda columns are -sum J_p^T g of each side of each contact
+		denseLambda.setZero();
+		for(int ci = 0; ci < int(solver.data().allContacts().size()); ++ci)
+		{
+			const qp::BilateralContact& c = solver.data().allContacts()[ci];
+			const qp::ContactId& cId = c.contactId;
+			for(int side = 0; side < 2; ++side)
+			{
+				if((side == 0 ? cId.r1Index : cId.r2Index) != 0)
+				{
+					continue;
+				}
+				int bodyId = side == 0 ? cId.r1BodyId : cId.r2BodyId;
+				const std::vector<Vector3d>& cPoints = side == 0 ? c.r1Points : c.r2Points;
+				const std::vector<qp::FrictionCone>& cones = side == 0 ? c.r1Cones : c.r2Cones;
+				int col = solver.data().lambdaBegin(ci) - lambdaBegin;
+				for(std::size_t pi = 0; pi < cPoints.size(); ++pi)
+				{
+					Jacobian jac(mb, bodyId, cPoints[pi]);
+					MatrixXd linJac = jac.bodyJacobian(mb, mbc).bottomRows<3>();
+					jac.fullJacobian(mb, linJac, fullJac);
+					for(const Vector3d& g: cones[pi].generators)
+					{
+						denseLambda.col(col++) -= fullJac.transpose()*g;
+					}
+				}
+			}
+		}
+
+		fd.computeH(mb, mbc);
+		fd.computeC(mb, mbc);
+		const MatrixXd& A = motionCstr.AGenInEq();
+		BOOST_CHECK_SMALL((A.block(0, 0, nrDof, nrDof) - fd.H()).norm(), 1e-8);
+		BOOST_CHECK_SMALL((A.block(0, lambdaBegin, nrDof, nrLambda) -
+			denseLambda).norm(), 1e-8);
+
+		VectorXd alphaD(VectorXd::Random(solver.data().nrVars()));
+		VectorXd lambda(VectorXd::Random(nrLambda));
+		motionCstr.computeTorque(alphaD, lambda);
+		VectorXd torque = fd.H()*alphaD.head(nrDof) + fd.C() + denseLambda*lambda;
+		BOOST_CHECK_SMALL((motionCstr.torque() - torque).norm(), 1e-8);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+}
+
+
+
 BOOST_AUTO_TEST_CASE(QPAutoCollTest)
 {
 	using namespace Eigen;
@@ -908,6 +1115,109 @@ BOOST_AUTO_TEST_CASE(QPAutoCollTest)
 }
 
 
+// The pairs skipped by CollisionConstr must not change the constraint.
+BOOST_AUTO_TEST_CASE(QPCollSkipTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<MultiBody> mbs = {mb};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::QPSolver solver;
+
+	int bodyI = mb.bodyIndexById(3);
+	qp::PositionTask posTask(mbs, 0, 3, mbcInit.bodyPosW[bodyI].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 50., 1.);
+
+	sch::S_Sphere b0(0.25), b3(0.25);
+
+	// same pair with and without skipping, di is crossed during the motion
+	PTransformd I = PTransformd::Identity();
+	qp::CollisionConstr skipCollConstr(mbs, 0.001);
+	qp::CollisionConstr allCollConstr(mbs, 0.001);
+	allCollConstr.skipFarPairs(false);
+	BOOST_CHECK(skipCollConstr.skipFarPairs());
+	BOOST_CHECK(!allCollConstr.skipFarPairs());
+	for(qp::CollisionConstr* cc: {&skipCollConstr, &allCollConstr})
+	{
+		cc->addCollision(mbs, 10,
+			0, 0, &b0, I,
+			0, 3, &b3, I,
+			0.1, 0.01, 0., 0.1);
+		cc->addToSolver(solver);
+	}
+	solver.addTask(&posTaskSp);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	// same pair only evaluated at the activation, outside the solver,
+	// its distance vector direction derivative is null
+	qp::CollisionConstr firstCollConstr(mbs, 0.001);
+	firstCollConstr.skipFarPairs(false);
+	firstCollConstr.addCollision(mbs, 10,
+		0, 0, &b0, I,
+		0, 3, &b3, I,
+		0.1, 0.01, 0., 0.1);
+	firstCollConstr.updateNrVars(mbs, solver.data());
+
+	int nrActive = 0;
+	int nrActivation = 0;
+	bool wasActive = false;
+	for(int i = 0; i < 1000; ++i)
+	{
+		posTask.position(RotX(0.01)*posTask.position());
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+		int nrInEq = skipCollConstr.nrInEq();
+		BOOST_REQUIRE_EQUAL(nrInEq, allCollConstr.nrInEq());
+		if(nrInEq > 0)
+		{
+			// the pair is evaluated with and without skipping before being
+			// activated so both use the last distance vector direction
+			BOOST_CHECK_SMALL((skipCollConstr.AInEq().topRows(nrInEq) -
+				allCollConstr.AInEq().topRows(nrInEq)).norm(), 1e-10);
+			BOOST_CHECK_SMALL((skipCollConstr.bInEq().head(nrInEq) -
+				allCollConstr.bInEq().head(nrInEq)).norm(), 1e-10);
+			++nrActive;
+
+			if(!wasActive && nrActivation++ == 0)
+			{
+				// mbcs positions and velocities are the ones used by solve
+				firstCollConstr.update(mbs, mbcs, solver.data());
+				BOOST_REQUIRE_EQUAL(firstCollConstr.nrInEq(), nrInEq);
+				BOOST_CHECK_SMALL((firstCollConstr.AInEq().topRows(nrInEq) -
+					allCollConstr.AInEq().topRows(nrInEq)).norm(), 1e-10);
+				BOOST_CHECK_GT((firstCollConstr.bInEq().head(nrInEq) -
+					allCollConstr.bInEq().head(nrInEq)).norm(), 1e-10);
+			}
+		}
+		wasActive = nrInEq > 0;
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+
+	// the pair must have been activated but not from the start
+	BOOST_CHECK_GT(nrActive, 0);
+	BOOST_CHECK_LT(nrActive, 1000);
+	BOOST_CHECK_GT(nrActivation, 0);
+}
+
+
 BOOST_AUTO_TEST_CASE(QPStaticEnvCollTest)
 {
 	using namespace Eigen;
@@ -1030,6 +1340,68 @@ BOOST_AUTO_TEST_CASE(QPStaticEnvCollTest)
 }
 
 
+// A static hull rotated around its bounding sphere center must not be skipped.
+BOOST_AUTO_TEST_CASE(QPMovedStaticHullTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+	qp::QPSolver solver;
+
+	int bodyI = mb.bodyIndexById(3);
+	qp::PositionTask posTask(mbs, 0, 3, mbcInit.bodyPosW[bodyI].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 50., 1.);
+
+	// b3 is at (0, 1, 0), the box is 0.5 from it along x
+	// and 0.05 from it once rotated along z
+	sch::S_Sphere b3(0.25);
+	sch::S_Box box(1., 0.1, 0.1);
+	Vector3d boxCenter(0., 1., 0.8);
+	box.setTransformation(qp::tosch(PTransformd(boxCenter)));
+
+	PTransformd I = PTransformd::Identity();
+	qp::CollisionConstr seCollConstr(mbs, 0.001);
+	seCollConstr.addCollision(mbs, 10,
+		0, 3, &b3, I,
+		1, 0, &box, I,
+		0.1, 0.01, 1.);
+	seCollConstr.addToSolver(solver);
+	solver.addTask(&posTaskSp);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	for(int i = 0; i < 10; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_CHECK_EQUAL(seCollConstr.nrInEq(), 0);
+	}
+
+	// the box bounding sphere is the same after the rotation
+	box.setTransformation(qp::tosch(
+		PTransformd(RotY(cst::pi<double>()/2.), boxCenter)));
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+	BOOST_CHECK_EQUAL(seCollConstr.nrInEq(), 1);
+}
+
+
 BOOST_AUTO_TEST_CASE(QPBilatContactTest)
 {
 	using namespace Eigen;
@@ -1133,45 +1505,12 @@ BOOST_AUTO_TEST_CASE(QPBilatContactTest)
 }
 
 
-Eigen::Vector6d compute6dError(const sva::PTransformd& b1, const sva::PTransformd& b2)
-{
-	Eigen::Vector6d error;
-	error.head<3>() = sva::rotationError(b1.rotation(), b2.rotation(), 1e-7);
-	error.tail<3>() = b1.translation() - b2.translation();
-	return error;
-}
-
-
-Eigen::Vector6d compute6dErrorInB1(const sva::PTransformd& b1, const sva::PTransformd& b2)
-{
-	sva::MotionVecd error;
-	error.angular() = sva::rotationError(b1.rotation(), b2.rotation(), 1e-7);
-	error.linear() = b1.translation() - b2.translation();
-	return (sva::PTransformd(b1.rotation())*error).vector();
-}
-
-
-double computeDofError(const sva::PTransformd& b1, const sva::PTransformd& b2,
-										const Eigen::MatrixXd& dof)
-{
-	return (dof*compute6dError(b1, b2)).norm();
-}
-
-
-double computeDofErrorInB1(const sva::PTransformd& b1, const sva::PTransformd& b2,
-										const Eigen::MatrixXd& dof)
-{
-	return (dof*compute6dErrorInB1(b1, b2)).norm();
-}
-
-
-BOOST_AUTO_TEST_CASE(QPDofContactsTest)
+BOOST_AUTO_TEST_CASE(QPWrenchContactTest)
 {
 	using namespace Eigen;
 	using namespace sva;
 	using namespace rbd;
 	using namespace tasks;
-	namespace cst = boost::math::constants;
 
 	MultiBody mb, mbEnv;
 	MultiBodyConfig mbcInit, mbcEnv;
@@ -1179,9 +1518,6 @@ BOOST_AUTO_TEST_CASE(QPDofContactsTest)
 	std::tie(mb, mbcInit) = makeZXZArm(false);
 	std::tie(mbEnv, mbcEnv) = makeEnv();
 
-	Vector4d quat(Vector4d::Random().normalized());
-	mbcInit.q[0] = {quat.w(), quat.x(), quat.y(), quat.z(), 0., 0., 0.};
-
 	forwardKinematics(mb, mbcInit);
 	forwardVelocity(mb, mbcInit);
 	forwardKinematics(mbEnv, mbcEnv);
@@ -1190,13 +1526,197 @@ BOOST_AUTO_TEST_CASE(QPDofContactsTest)
 	std::vector<MultiBody> mbs = {mb, mbEnv};
 	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
 
+	// same stance is solved with generators and wrench contact model
+	qp::QPSolver genSolver, wrenchSolver;
 
-	qp::QPSolver solver;
+	double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.},{Inf},{Inf},{Inf}};
+	qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstr;
+	qp::WrenchConeConstr wcCstr;
+	qp::ContactAccConstr contCstrAcc;
+	// the posture task weight hide the different lambda regularization
+	// of the two models
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 1000.);
 
-	sva::PTransformd X_b1_cf(Quaterniond(Vector4d::Random().normalized()),
-		Vector3d::Random());
+	std::vector<Eigen::Vector3d> points =
+		{
+			Vector3d(0.1, 0., 0.1),
+			Vector3d(-0.1, 0., 0.1),
+			Vector3d(-0.1, 0., -0.1),
+			Vector3d(0.1, 0., -0.1)
+		};
 
-	qp::ContactPosConstr contCstrSpeed(0.005);
+	// the contact normal is the Y axis (gravity come from the Y axis)
+	Matrix3d frame;
+	frame << 0., 0., 1.,
+					 1., 0., 0.,
+					 0., 1., 0.;
+
+	qp::UnilateralContact genCont(0, 1, 0, 0, points, frame,
+		sva::PTransformd::Identity(), 4, 0.7);
+	qp::UnilateralContact wrenchCont(genCont);
+	wrenchCont.model = qp::ContactModel::Wrench;
+
+	BOOST_CHECK_EQUAL(genCont.nrLambda(), 4*4);
+	BOOST_CHECK_EQUAL(wrenchCont.nrLambda(), 6);
+
+	for(qp::QPSolver* solver: {&genSolver, &wrenchSolver})
+	{
+		motionCstr.addToSolver(*solver);
+		plCstr.addToSolver(*solver);
+		wcCstr.addToSolver(*solver);
+		contCstrAcc.addToSolver(*solver);
+		solver->addTask(&postureTask);
+	}
+
+	genSolver.nrVars(mbs, {genCont}, {});
+	genSolver.updateConstrSize();
+	BOOST_CHECK_EQUAL(genSolver.nrVars(), 9 + 4*4);
+	BOOST_CHECK_EQUAL(wcCstr.maxInEq(), 0);
+
+	wrenchSolver.nrVars(mbs, {wrenchCont}, {});
+	wrenchSolver.updateConstrSize();
+	BOOST_CHECK_EQUAL(wrenchSolver.nrVars(), 9 + 6);
+	BOOST_CHECK_EQUAL(wcCstr.maxInEq(), 16);
+
+	const MatrixXd& faces = wrenchCont.r1WrenchCone.faces;
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 100; ++i)
+	{
+		BOOST_REQUIRE(genSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(wrenchSolver.solve(mbs, mbcs));
+		BOOST_REQUIRE_SMALL((genSolver.alphaDVec() - wrenchSolver.alphaDVec()).norm(), 1e-3);
+
+		// both models apply the same wrench on the body
+		VectorXd genLambda(genSolver.lambdaVec(0));
+		VectorXd wrenchLambda(wrenchSolver.lambdaVec(0));
+		sva::ForceVecd genWrench = genCont.force(genLambda, genCont.r1Points,
+			genCont.r1Cone);
+		sva::ForceVecd wrench = wrenchCont.wrench(wrenchLambda,
+			wrenchCont.r1WrenchCone);
+		BOOST_REQUIRE_SMALL((genWrench - wrench).vector().norm(), 1e-3);
+		BOOST_REQUIRE_GT((faces*wrenchLambda).minCoeff(), -1e-6);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+
+	// with a Z normal the stance is impossible and the wrench cone
+	// must make the solver fail
+	qp::UnilateralContact zCont(0, 1, 0, 0, points, Matrix3d::Identity(),
+		sva::PTransformd::Identity(), 4, 0.7);
+	zCont.model = qp::ContactModel::Wrench;
+	wrenchSolver.nrVars(mbs, {zCont}, {});
+	wrenchSolver.updateConstrSize();
+
+	mbcs[0] = mbcInit;
+	BOOST_REQUIRE(!wrenchSolver.solve(mbs, mbcs));
+
+	// gripper torque only support the generators model
+	qp::BilateralContact wrenchBiCont(wrenchCont);
+	qp::GripperTorqueConstr gripperCstr;
+	gripperCstr.addGripper(wrenchBiCont.contactId, 1., Vector3d::Zero(),
+		Vector3d::UnitZ());
+	gripperCstr.addToSolver(wrenchSolver);
+	wrenchSolver.nrVars(mbs, {}, {wrenchBiCont});
+	wrenchSolver.updateConstrSize();
+	BOOST_CHECK(gripperCstr.AInEq().isZero());
+	BOOST_CHECK(gripperCstr.AInEqBlocks().empty());
+	gripperCstr.removeFromSolver(wrenchSolver);
+
+	// a bilateral contact build the wrench cone of its first frame
+	std::vector<Matrix3d> biFrames(points.size(), frame);
+	qp::BilateralContact biCont(0, 1, 0, 0,
+		points, biFrames, sva::PTransformd::Identity(), 4, 0.7);
+	biCont.model = qp::ContactModel::Wrench;
+	BOOST_CHECK_SMALL((biCont.r1WrenchCone.faces -
+		wrenchCont.r1WrenchCone.faces).norm(), 1e-8);
+	BOOST_CHECK_SMALL((biCont.r1WrenchCone.wrenches -
+		wrenchCont.r1WrenchCone.wrenches).norm(), 1e-8);
+	BOOST_CHECK_SMALL((biCont.r2WrenchCone.wrenches -
+		wrenchCont.r2WrenchCone.wrenches).norm(), 1e-8);
+	BOOST_CHECK_NO_THROW(wrenchSolver.nrVars(mbs, {}, {biCont}));
+	BOOST_CHECK_EQUAL(wrenchSolver.nrVars(), 9 + 6);
+
+	// a default contact has no wrench cone to use the wrench model
+	qp::BilateralContact noConeCont;
+	noConeCont.model = qp::ContactModel::Wrench;
+	BOOST_CHECK_THROW(wrenchSolver.nrVars(mbs, {}, {noConeCont}),
+		std::domain_error);
+	wrenchSolver.nrVars(mbs, {}, {});
+	BOOST_CHECK_THROW(wrenchSolver.addContact(mbs, noConeCont),
+		std::domain_error);
+}
+
+
+Eigen::Vector6d compute6dError(const sva::PTransformd& b1, const sva::PTransformd& b2)
+{
+	Eigen::Vector6d error;
+	error.head<3>() = sva::rotationError(b1.rotation(), b2.rotation(), 1e-7);
+	error.tail<3>() = b1.translation() - b2.translation();
+	return error;
+}
+
+
+Eigen::Vector6d compute6dErrorInB1(const sva::PTransformd& b1, const sva::PTransformd& b2)
+{
+	sva::MotionVecd error;
+	error.angular() = sva::rotationError(b1.rotation(), b2.rotation(), 1e-7);
+	error.linear() = b1.translation() - b2.translation();
+	return (sva::PTransformd(b1.rotation())*error).vector();
+}
+
+
+double computeDofError(const sva::PTransformd& b1, const sva::PTransformd& b2,
+										const Eigen::MatrixXd& dof)
+{
+	return (dof*compute6dError(b1, b2)).norm();
+}
+
+
+double computeDofErrorInB1(const sva::PTransformd& b1, const sva::PTransformd& b2,
+										const Eigen::MatrixXd& dof)
+{
+	return (dof*compute6dErrorInB1(b1, b2)).norm();
+}
+
+
+BOOST_AUTO_TEST_CASE(QPDofContactsTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm(false);
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	Vector4d quat(Vector4d::Random().normalized());
+	mbcInit.q[0] = {quat.w(), quat.x(), quat.y(), quat.z(), 0., 0., 0.};
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+
+	qp::QPSolver solver;
+
+	sva::PTransformd X_b1_cf(Quaterniond(Vector4d::Random().normalized()),
+		Vector3d::Random());
+
+	qp::ContactPosConstr contCstrSpeed(0.005);
 	// target in cf coordinate is transform into world frame
 	qp::PositionTask posTask(mbs, 0, 0,
 		(X_b1_cf*mbcInit.bodyPosW[0]).rotation().transpose()*Vector3d(1., 1., -1.));
@@ -1737,3 +2257,807 @@ BOOST_AUTO_TEST_CASE(QPTransformTaskTest)
 	solver.removeTask(&postureTask);
 	BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
 }
+
+
+BOOST_AUTO_TEST_CASE(GIQPSolverTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	// same problem is solved by QLD and GI
+	qp::QPSolver qldSolver, giSolver;
+	qldSolver.solver("QLD");
+	giSolver.solver("GI");
+
+	ZXZArmProblem arm(mbs, mbcInit);
+	for(qp::QPSolver* solver: {&qldSolver, &giSolver})
+	{
+		arm.addToSolver(mbs, *solver);
+	}
+
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 1000; ++i)
+	{
+		BOOST_REQUIRE(qldSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(giSolver.solve(mbs, mbcs));
+		BOOST_REQUIRE_SMALL((qldSolver.result() - giSolver.result()).norm(), 1e-5);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		BOOST_REQUIRE_GT(mbcs[0].q[1][0], -cst::pi<double>()/4. - 0.01);
+	}
+
+	// QLD keep the setting but is never warm started
+	BOOST_CHECK(qldSolver.warmStart());
+	BOOST_CHECK(!qldSolver.nextSolveWarm());
+
+	// GI keep working without warm start
+	giSolver.warmStart(false);
+	BOOST_CHECK(!giSolver.warmStart());
+	BOOST_REQUIRE(qldSolver.solveNoMbcUpdate(mbs, mbcs));
+	BOOST_REQUIRE(giSolver.solveNoMbcUpdate(mbs, mbcs));
+	BOOST_CHECK_SMALL((qldSolver.result() - giSolver.result()).norm(), 1e-5);
+
+	// the warm start setting is kept when the solver change
+	giSolver.solver("GI");
+	BOOST_CHECK(!giSolver.warmStart());
+	BOOST_REQUIRE(giSolver.solveNoMbcUpdate(mbs, mbcs));
+	BOOST_CHECK(!giSolver.warmStart());
+	BOOST_CHECK(!giSolver.nextSolveWarm());
+
+	// the getter return the setting even before any warm solve
+	giSolver.warmStart(true);
+	BOOST_CHECK(giSolver.warmStart());
+	BOOST_CHECK(!giSolver.nextSolveWarm());
+	BOOST_REQUIRE(giSolver.solveNoMbcUpdate(mbs, mbcs));
+	BOOST_CHECK(giSolver.warmStart());
+	giSolver.solver("GI");
+	BOOST_CHECK(giSolver.warmStart());
+	BOOST_CHECK(!giSolver.nextSolveWarm());
+}
+
+
+// With only constant tasks Q is not filled again at each solve,
+// solvers that overwrite their objective matrix must not see it.
+BOOST_AUTO_TEST_CASE(QPConstantQTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	// Q is 10*I, its Cholesky factor would give another solution
+	qp::PostureTask postureTask(mbs, 0, {{}, {0.5}, {-0.5}, {0.5}}, 1., 10.);
+
+	qp::QPSolver refSolver;
+	refSolver.solver("GI");
+	refSolver.addTask(&postureTask);
+	refSolver.nrVars(mbs, {}, {});
+	refSolver.updateConstrSize();
+	BOOST_REQUIRE(refSolver.solveNoMbcUpdate(mbs, mbcs));
+
+	for(const std::string& name: qp::qpSolverNames())
+	{
+		qp::QPSolver solver;
+		solver.solver(name);
+		solver.addTask(&postureTask);
+		solver.nrVars(mbs, {}, {});
+		solver.updateConstrSize();
+
+		for(int i = 0; i < 3; ++i)
+		{
+			BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+			// ADMM is only solved to 1e-3
+			BOOST_CHECK_SMALL((solver.alphaDVec() - refSolver.alphaDVec()).norm(),
+				name == "ADMM" ? 1e-3 : 1e-5);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(GIReducedQPSolverTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm(false);
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+	// same problem is solved by GI with and without equalities elimination
+	qp::QPSolver giSolver, reducedSolver;
+	giSolver.solver("GI");
+	reducedSolver.solver("GIReduced");
+
+	double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.},{Inf},{Inf},{Inf}};
+	qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstr;
+	qp::ContactAccConstr contCstrAcc;
+
+	std::vector<Eigen::Vector3d> points =
+		{
+			Vector3d(0.1, 0.1, 0.),
+			Vector3d(-0.1, 0.1, 0.),
+			Vector3d(-0.1, -0.1, 0.),
+			Vector3d(0.1, -0.1, 0.)
+		};
+
+	std::vector<Eigen::Matrix3d> biFrames =
+		{
+			sva::RotY((0.*cst::pi<double>())/2.),
+			sva::RotY((1.*cst::pi<double>())/2.),
+			sva::RotY((2.*cst::pi<double>())/2.),
+			sva::RotY((3.*cst::pi<double>())/2.),
+		};
+
+	std::vector<qp::BilateralContact> bi =
+		{qp::BilateralContact(0, 1, 0, 0,
+			points, biFrames, sva::PTransformd::Identity(),
+			3., 0.7)};
+
+	qp::PostureTask postureTask(mbs, 0, {{}, {0.}, {0.}, {0.}}, 1., 0.01);
+
+	for(qp::QPSolver* solver: {&giSolver, &reducedSolver})
+	{
+		motionCstr.addToSolver(*solver);
+		contCstrAcc.addToSolver(*solver);
+		plCstr.addToSolver(*solver);
+		solver->addTask(&postureTask);
+
+		solver->nrVars(mbs, {}, bi);
+		solver->updateConstrSize();
+	}
+
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 100; ++i)
+	{
+		BOOST_REQUIRE(giSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(reducedSolver.solve(mbs, mbcs));
+		BOOST_REQUIRE_SMALL((giSolver.result() - reducedSolver.result()).norm(), 1e-5);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+
+	// the contact is still respected
+	BOOST_CHECK_SMALL((mbcs[0].bodyPosW[0].translation() -
+		mbcInit.bodyPosW[0].translation()).norm(), 1e-5);
+}
+
+
+BOOST_AUTO_TEST_CASE(ADMMQPSolverTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	// same problem is solved by QLD and ADMM
+	qp::QPSolver qldSolver, admmSolver;
+	qldSolver.solver("QLD");
+	admmSolver.solver("ADMM");
+
+	ZXZArmProblem arm(mbs, mbcInit);
+	for(qp::QPSolver* solver: {&qldSolver, &admmSolver})
+	{
+		arm.addToSolver(mbs, *solver);
+	}
+
+	// the dense tasks are added during the motion, their Q blocks
+	// add new non zeros to the ADMM KKT matrix of the posture task
+	for(qp::QPSolver* solver: {&qldSolver, &admmSolver})
+	{
+		solver->removeTask(&arm.posTaskSp);
+		solver->removeTask(&arm.oriTaskSp);
+	}
+
+	// ADMM is less accurate than active set methods
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 1000; ++i)
+	{
+		if(i == 10)
+		{
+			for(qp::QPSolver* solver: {&qldSolver, &admmSolver})
+			{
+				solver->addTask(mbs, &arm.posTaskSp);
+				solver->addTask(mbs, &arm.oriTaskSp);
+			}
+		}
+
+		BOOST_REQUIRE(qldSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(admmSolver.solve(mbs, mbcs));
+		BOOST_REQUIRE_SMALL((qldSolver.result() - admmSolver.result()).norm(), 1e-3);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		BOOST_REQUIRE_GT(mbcs[0].q[1][0], -cst::pi<double>()/4. - 0.01);
+	}
+}
+
+
+// The body jacobians of removed tasks are not computed anymore
+// and the registered jacobians keep their index.
+BOOST_AUTO_TEST_CASE(QPBodyJacobianRegistryTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::PositionTask posTask(mbs, 0, 3, mbcInit.bodyPosW[3].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+	qp::OrientationTask oriTask(mbs, 0, 2, mbcInit.bodyPosW[2].rotation());
+	qp::SetPointTask oriTaskSp(mbs, 0, &oriTask, 10., 1.);
+
+	qp::QPSolver solver;
+	solver.addTask(&posTaskSp);
+	solver.addTask(&oriTaskSp);
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	int index3 = solver.data().bodyJacobianIndex(mbs, 0, 3);
+	BOOST_CHECK_NO_THROW(solver.data().bodyJacobianIndex(mbs, 0, 2));
+
+	// the registrations are rebuilt by the next solve
+	solver.removeTask(&oriTaskSp);
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+	BOOST_CHECK_THROW(solver.data().bodyJacobianIndex(mbs, 0, 2),
+		std::domain_error);
+	BOOST_CHECK_EQUAL(solver.data().bodyJacobianIndex(mbs, 0, 3), index3);
+
+	solver.addTask(mbs, &oriTaskSp);
+	BOOST_CHECK_NO_THROW(solver.data().bodyJacobianIndex(mbs, 0, 2));
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+
+	// updateTasksNrVars also rebuild the registrations
+	solver.removeTask(&posTaskSp);
+	solver.updateTasksNrVars(mbs);
+	BOOST_CHECK_THROW(solver.data().bodyJacobianIndex(mbs, 0, 3),
+		std::domain_error);
+	BOOST_CHECK_NO_THROW(solver.data().bodyJacobianIndex(mbs, 0, 2));
+	BOOST_REQUIRE(solver.solve(mbs, mbcs));
+}
+
+
+BOOST_AUTO_TEST_CASE(QPThreadsTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	// same problem is updated sequentially and in parallel
+	qp::QPSolver seqSolver, parSolver;
+	parSolver.nrThreads(3);
+	BOOST_CHECK_EQUAL(seqSolver.nrThreads(), 1);
+	BOOST_CHECK_EQUAL(parSolver.nrThreads(), 3);
+
+	// each solver has its own tasks and constraints so the sequential
+	// and parallel updates don't share any state
+	ZXZArmProblem seqArm(mbs, mbcInit), parArm(mbs, mbcInit);
+	seqArm.addToSolver(mbs, seqSolver);
+	parArm.addToSolver(mbs, parSolver);
+
+	for(int i = 0; i < 100; ++i)
+	{
+		BOOST_REQUIRE(seqSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(parSolver.solve(mbs, mbcs));
+		// the update order don't change the result
+		BOOST_REQUIRE_EQUAL((seqSolver.result() - parSolver.result()).norm(), 0.);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+
+	parSolver.nrThreads(1);
+	BOOST_CHECK_EQUAL(parSolver.nrThreads(), 1);
+	BOOST_CHECK(parSolver.solveNoMbcUpdate(mbs, mbcs));
+}
+
+
+BOOST_AUTO_TEST_CASE(QPSharedHighLevelTaskThreadsTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	// high level tasks shared by several tasks, directly or through
+	// a JointsSelector
+	struct SharedTasks
+	{
+		SharedTasks(const std::vector<rbd::MultiBody>& mbs):
+			posTask(mbs, 0, 3, Vector3d(0.707106, 0.707106, 0.)),
+			oriTask(mbs, 0, 3, RotZ(0.5)),
+			posJs(qp::JointsSelector::ActiveJoints(mbs, 0, &posTask, {1, 2})),
+			posTaskSp(mbs, 0, &posTask, 10., 1.),
+			posTaskTo(mbs, 0, &posTask, 0.001, 1., Vector3d::Zero(), 1.),
+			posJsSp(mbs, 0, &posJs, 5., 1.),
+			oriTaskSp(mbs, 0, &oriTask, 10., 1.),
+			oriTaskSp2(mbs, 0, &oriTask, 1., 0.5)
+		{}
+
+		void addToSolver(qp::QPSolver& solver)
+		{
+			for(qp::Task* t: std::vector<qp::Task*>{&posTaskSp, &oriTaskSp,
+					&posTaskTo, &posJsSp, &oriTaskSp2})
+			{
+				solver.addTask(t);
+			}
+		}
+
+		qp::PositionTask posTask;
+		qp::OrientationTask oriTask;
+		qp::JointsSelector posJs;
+		qp::SetPointTask posTaskSp;
+		qp::TargetObjectiveTask posTaskTo;
+		qp::SetPointTask posJsSp, oriTaskSp, oriTaskSp2;
+	};
+
+	// same problem is updated sequentially and in parallel, the tasks
+	// that share a high level task must be updated by the same thread
+	qp::QPSolver seqSolver, parSolver;
+	parSolver.nrThreads(4);
+	SharedTasks seqTasks(mbs), parTasks(mbs);
+	BOOST_CHECK_EQUAL(parTasks.posTaskSp.highLevelTask(), &parTasks.posTask);
+	BOOST_CHECK_EQUAL(parTasks.posTaskTo.highLevelTask(), &parTasks.posTask);
+	BOOST_CHECK_EQUAL(parTasks.posJsSp.highLevelTask(), &parTasks.posJs);
+	BOOST_CHECK_EQUAL(parTasks.posJs.highLevelTask(), &parTasks.posTask);
+	BOOST_CHECK(parTasks.posTask.highLevelTask() == nullptr);
+
+	for(auto config: {std::make_pair(&seqSolver, &seqTasks),
+			std::make_pair(&parSolver, &parTasks)})
+	{
+		config.second->addToSolver(*config.first);
+		config.first->nrVars(mbs, {}, {});
+		config.first->updateConstrSize();
+	}
+
+	for(int i = 0; i < 100; ++i)
+	{
+		// remove and add a task again to change the task groups
+		if(i == 50)
+		{
+			parSolver.removeTask(&parTasks.posTaskSp);
+			parSolver.addTask(mbs, &parTasks.posTaskSp);
+			seqSolver.removeTask(&seqTasks.posTaskSp);
+			seqSolver.addTask(mbs, &seqTasks.posTaskSp);
+		}
+
+		BOOST_REQUIRE(seqSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(parSolver.solve(mbs, mbcs));
+		BOOST_REQUIRE_EQUAL((seqSolver.result() - parSolver.result()).norm(), 0.);
+		BOOST_REQUIRE_EQUAL(seqTasks.posTaskTo.iter(), parTasks.posTaskTo.iter());
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(QPCollThreadsTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	// b3 is shared by two pairs
+	sch::S_Sphere b0(0.1), b1(0.1), b3(0.1);
+	PTransformd I = PTransformd::Identity();
+
+	// same pairs are computed sequentially and in parallel
+	qp::CollisionConstr seqCollConstr(mbs, 0.001), parCollConstr(mbs, 0.001);
+	parCollConstr.nrThreads(3);
+	BOOST_CHECK_EQUAL(seqCollConstr.nrThreads(), 1);
+	BOOST_CHECK_EQUAL(parCollConstr.nrThreads(), 3);
+
+	int bodyI = mb.bodyIndexById(3);
+	qp::PositionTask posTask(mbs, 0, 3, mbcInit.bodyPosW[bodyI].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 50., 1.);
+
+	qp::QPSolver seqSolver, parSolver;
+	std::vector<std::pair<qp::QPSolver*, qp::CollisionConstr*>> configs =
+		{{&seqSolver, &seqCollConstr}, {&parSolver, &parCollConstr}};
+	for(auto& config: configs)
+	{
+		config.second->addCollision(mbs, 1, 0, 0, &b0, I, 0, 3, &b3, I, 1., 0.05, 1.);
+		config.second->addCollision(mbs, 2, 0, 1, &b1, I, 0, 3, &b3, I, 1., 0.05, 0.);
+		config.second->addCollision(mbs, 3, 0, 0, &b0, I, 0, 1, &b1, I, 0.01, 0.005, 1.);
+		config.second->addToSolver(*config.first);
+		config.first->addTask(&posTaskSp);
+
+		config.first->nrVars(mbs, {}, {});
+		config.first->updateConstrSize();
+	}
+
+	for(int i = 0; i < 100; ++i)
+	{
+		posTask.position(RotX(0.01)*posTask.position());
+		BOOST_REQUIRE(seqSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(parSolver.solve(mbs, mbcs));
+		// activated pairs are stored in the same order
+		BOOST_REQUIRE_EQUAL(seqCollConstr.nrInEq(), parCollConstr.nrInEq());
+		BOOST_REQUIRE_EQUAL((seqCollConstr.AInEq() - parCollConstr.AInEq()).norm(), 0.);
+		BOOST_REQUIRE_EQUAL((seqCollConstr.bInEq() - parCollConstr.bInEq()).norm(), 0.);
+		BOOST_REQUIRE_EQUAL((seqSolver.result() - parSolver.result()).norm(), 0.);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+
+	parCollConstr.nrThreads(1);
+	BOOST_CHECK_EQUAL(parCollConstr.nrThreads(), 1);
+}
+
+
+BOOST_AUTO_TEST_CASE(QPTargetBufferTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	typedef std::vector<std::vector<double>> Posture;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	auto makePosture = [](double q) -> Posture
+	{
+		return {{}, {q}, {q}, {q}};
+	};
+
+	qp::PostureTask postureTask(mbs, 0, makePosture(0.), 1., 0.01);
+	TargetBuffer<Posture> postureBuffer(postureTask.posture());
+
+	qp::QPSolver solver;
+	solver.addTask(&postureTask);
+	solver.addTargetBuffer(&postureBuffer);
+	solver.addTargetBuffer(&postureBuffer);
+	BOOST_CHECK_EQUAL(solver.nrTargetBuffers(), 1);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	// only the last published value is applied
+	postureBuffer.write(makePosture(0.1));
+	postureBuffer.write(makePosture(0.2));
+	BOOST_CHECK_EQUAL(postureTask.posture()[1][0], 0.);
+	BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+	BOOST_CHECK_EQUAL(postureTask.posture()[1][0], 0.2);
+
+	// nothing is applied without a new value
+	BOOST_CHECK(!postureBuffer.swap());
+
+	postureBuffer.back() = makePosture(0.3);
+	postureBuffer.publish();
+	BOOST_CHECK(postureBuffer.swap());
+	BOOST_CHECK_EQUAL(postureTask.posture()[1][0], 0.3);
+
+	// targets published by another thread are never torn and
+	// are applied in the publication order
+	const int nrTargets = 10000;
+	std::thread producer([&postureBuffer, &makePosture]()
+	{
+		for(int i = 1; i <= nrTargets; ++i)
+		{
+			postureBuffer.write(makePosture(double(i)));
+		}
+	});
+
+	double last = 0.;
+	while(last < double(nrTargets))
+	{
+		BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+		Posture q = postureTask.posture();
+		BOOST_REQUIRE_EQUAL(q[1][0], q[2][0]);
+		BOOST_REQUIRE_EQUAL(q[1][0], q[3][0]);
+		BOOST_REQUIRE(q[1][0] >= last);
+		last = q[1][0];
+	}
+	producer.join();
+
+	solver.removeTargetBuffer(&postureBuffer);
+	BOOST_CHECK_EQUAL(solver.nrTargetBuffers(), 0);
+}
+
+
+namespace
+{
+
+/// Task with a given Q structure used to check the Q assembly.
+class StructuredTask : public tasks::qp::Task
+{
+public:
+	StructuredTask(tasks::qp::QStructure structure, const Eigen::MatrixXd& Q,
+		int size, int begin, std::vector<tasks::qp::ColBlock> blocks):
+		Task(2.),
+		structure_(structure),
+		Q_(Q),
+		C_(Eigen::VectorXd::Zero(size)),
+		begin_(begin),
+		blocks_(std::move(blocks))
+	{}
+
+	virtual std::pair<int, int> begin() const
+	{
+		return std::make_pair(begin_, begin_);
+	}
+
+	virtual void updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
+		const tasks::qp::SolverData& /* data */)
+	{}
+	virtual void update(const std::vector<rbd::MultiBody>& /* mbs */,
+		const std::vector<rbd::MultiBodyConfig>& /* mbcs */,
+		const tasks::qp::SolverData& /* data */)
+	{}
+
+	virtual const Eigen::MatrixXd& Q() const
+	{
+		return Q_;
+	}
+	virtual const Eigen::VectorXd& C() const
+	{
+		return C_;
+	}
+	virtual tasks::qp::QStructure structureQ() const
+	{
+		return structure_;
+	}
+	virtual const std::vector<tasks::qp::ColBlock>& QBlocks() const
+	{
+		return blocks_;
+	}
+
+private:
+	tasks::qp::QStructure structure_;
+	Eigen::MatrixXd Q_;
+	Eigen::VectorXd C_;
+	int begin_;
+	std::vector<tasks::qp::ColBlock> blocks_;
+};
+
+} // anonymous namespace
+
+
+BOOST_AUTO_TEST_CASE(QStructureTest)
+{
+	using namespace Eigen;
+	using namespace tasks;
+
+	const int nrVars = 10;
+	const int size = 5;
+	std::vector<std::vector<qp::ColBlock>> blocksList =
+		{{}, {{0, 2}, {4, 3}}};
+
+	for(const std::vector<qp::ColBlock>& blocks: blocksList)
+	{
+		VectorXd diag(VectorXd::Random(size));
+		MatrixXd F(MatrixXd::Random(3, size));
+		double scale = 0.7;
+
+		// structured tasks and the dense tasks they represent
+		std::vector<std::pair<qp::QStructure, MatrixXd>> structs =
+			{{qp::QStructure::Diagonal, diag},
+			 {qp::QStructure::ScaledIdentity, MatrixXd::Constant(1, 1, scale)},
+			 {qp::QStructure::Factor, F}};
+		std::vector<MatrixXd> denses =
+			{MatrixXd(diag.asDiagonal()),
+			 scale*MatrixXd::Identity(size, size),
+			 F.transpose()*F};
+
+		for(std::size_t i = 0; i < structs.size(); ++i)
+		{
+			StructuredTask structTask(structs[i].first, structs[i].second,
+				size, 2, blocks);
+			StructuredTask denseTask(qp::QStructure::Dense, denses[i],
+				size, 2, blocks);
+
+			MatrixXd QStruct(MatrixXd::Zero(nrVars, nrVars));
+			MatrixXd QDense(MatrixXd::Zero(nrVars, nrVars));
+			qp::addTaskQ(&structTask, structTask.weight(), QStruct);
+			qp::addTaskQ(&denseTask, denseTask.weight(), QDense);
+
+			// only the lower part is filled
+			BOOST_CHECK_SMALL((QStruct.triangularView<Lower>().toDenseMatrix() -
+				QDense.triangularView<Lower>().toDenseMatrix()).norm(), 1e-10);
+			BOOST_CHECK_EQUAL(
+				QStruct.triangularView<StrictlyUpper>().toDenseMatrix().norm(), 0.);
+
+			BOOST_CHECK_SMALL((structTask.denseQ() - denses[i]).norm(), 1e-10);
+			BOOST_CHECK_SMALL((denseTask.denseQ() - denses[i]).norm(), 1e-10);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(QPTimingTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	// ring buffer statistics
+	TimeRecord record(4);
+	BOOST_CHECK_EQUAL(record.size(), 0);
+	BOOST_CHECK_EQUAL(record.max(), 0.);
+	for(double t: {5., 1., 2., 3., 4.})
+	{
+		record.add(t);
+	}
+	// 5 has been overwritten
+	BOOST_CHECK_EQUAL(record.size(), 4);
+	BOOST_CHECK_EQUAL(record.last(), 4.);
+	BOOST_CHECK_EQUAL(record.min(), 1.);
+	BOOST_CHECK_EQUAL(record.max(), 4.);
+	BOOST_CHECK_EQUAL(record.mean(), 2.5);
+	BOOST_CHECK_EQUAL(record.percentile(50.), 2.);
+	BOOST_CHECK_EQUAL(record.percentile(100.), 4.);
+	std::vector<double> times = record.times();
+	BOOST_CHECK(times == std::vector<double>({1., 2., 3., 4.}));
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::QPSolver solver;
+
+	ZXZArmProblem arm(mbs, mbcInit);
+	arm.addToSolver(mbs, solver);
+
+	// nothing is recorded by default
+	BOOST_CHECK(!solver.timing());
+	BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+	BOOST_CHECK_EQUAL(solver.totalTime().size(), 0);
+
+	solver.timing(true, 10);
+	for(int i = 0; i < 20; ++i)
+	{
+		BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+	}
+
+	for(const TimeRecord* tr: {&solver.taskTime(&arm.posTaskSp),
+		&solver.taskTime(&arm.postureTask), &solver.constraintTime(&arm.motionCstr),
+		&solver.dataTime(), &solver.matrixTime(), &solver.qpTime(),
+		&solver.totalTime()})
+	{
+		BOOST_CHECK_EQUAL(tr->size(), 10);
+		BOOST_CHECK_GE(tr->min(), 0.);
+		BOOST_CHECK_LE(tr->max(), solver.totalTime().max());
+	}
+
+	// removing a task keep the record of the other ones
+	solver.removeTask(&arm.posTaskSp);
+	BOOST_CHECK_EQUAL(solver.taskTime(&arm.postureTask).size(), 10);
+	BOOST_CHECK_THROW(solver.taskTime(&arm.posTaskSp), std::domain_error);
+
+	solver.addTask(&arm.posTaskSp);
+	BOOST_CHECK_EQUAL(solver.taskTime(&arm.posTaskSp).size(), 0);
+}
@@ -150,6 +150,28 @@ struct NormalAccUpdater : public TanAccel<Task>
 };
 
 
+/// run the task update(mb, mbc, bodyNormalAcc, bodyJac) method
+/// (like the QP tasks that use SolverData body jacobians)
+template<typename Task>
+struct BodyJacUpdater : public TanAccel<Task>
+{
+	BodyJacUpdater(const rbd::MultiBody& mb, int bodyId):
+		normalAccB(mb.nrBodies()),
+		jac(mb, bodyId)
+	{}
+
+	void operator()(Task& task, const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs)
+	{
+		computeNormalAccB(mbs[0], mbcs[0], normalAccB);
+		task.update(mbs[0], mbcs[0], normalAccB, jac.bodyJacobian(mbs[0], mbcs[0]));
+	}
+
+	std::vector<sva::MotionVecd> normalAccB;
+	rbd::Jacobian jac;
+};
+
+
 /// run the task update(mbs, mbcs, bodyNormalAccs) method
 template<typename Task>
 struct MRNormalAccUpdater : public MRTanAccel<Task>
@@ -386,6 +408,8 @@ BOOST_AUTO_TEST_CASE(PositionTaskTest)
 		PosTester());
 	testTaskNumDiff(mb, mbc, pt, NormalAccUpdater<tasks::PositionTask>(mb),
 		PosTester());
+	testTaskNumDiff(mb, mbc, pt, BodyJacUpdater<tasks::PositionTask>(mb, 3),
+		PosTester());
 }
 
 
@@ -405,6 +429,8 @@ BOOST_AUTO_TEST_CASE(OrientationTaskTest)
 		OriTaskTester());
 	testTaskNumDiff(mb, mbc, ot, NormalAccUpdater<tasks::OrientationTask>(mb),
 		OriTaskTester());
+	testTaskNumDiff(mb, mbc, ot, BodyJacUpdater<tasks::OrientationTask>(mb, 3),
+		OriTaskTester());
 }
 
 
@@ -428,6 +454,8 @@ BOOST_AUTO_TEST_CASE(TransformTaskTest)
 
 	testTaskNumDiff(mb, mbc, tt,
 		NormalAccUpdater<tasks::TransformTask>(mb), PosTTTester(), 100);
+	testTaskNumDiff(mb, mbc, tt,
+		BodyJacUpdater<tasks::TransformTask>(mb, 3), PosTTTester(), 100);
 }
 
 
@@ -450,6 +478,8 @@ BOOST_AUTO_TEST_CASE(SurfaceTransformTaskTest)
 
 	testTaskNumDiff(mb, mbc, tt,
 		NormalAccUpdater<tasks::SurfaceTransformTask>(mb), PosMRTTTester(), 100);
+	testTaskNumDiff(mb, mbc, tt,
+		BodyJacUpdater<tasks::SurfaceTransformTask>(mb, 3), PosMRTTTester(), 100);
 }
 
 
@@ -497,6 +527,8 @@ BOOST_AUTO_TEST_CASE(SurfaceOrientationTaskTest)
 		OriTaskTester());
 	testTaskNumDiff(mb, mbc, sot, NormalAccUpdater<tasks::SurfaceOrientationTask>(mb),
 		OriTaskTester());
+	testTaskNumDiff(mb, mbc, sot, BodyJacUpdater<tasks::SurfaceOrientationTask>(mb, 3),
+		OriTaskTester());
 }
 
 
@@ -17,7 +17,12 @@
 
 // includes
 // std
+#include <limits>
 #include <tuple>
+#include <vector>
+
+// boost
+#include <boost/math/constants/constants.hpp>
 
 // RBDyn
 #include <RBDyn/Body.h>
@@ -26,6 +31,13 @@
 #include <RBDyn/MultiBodyConfig.h>
 #include <RBDyn/MultiBodyGraph.h>
 
+// Tasks
+#include "Bounds.h"
+#include "QPConstr.h"
+#include "QPMotionConstr.h"
+#include "QPSolver.h"
+#include "QPTasks.h"
+
 /// @return An simple ZXZ arm with Y as up axis.
 std::tuple<rbd::MultiBody, rbd::MultiBodyConfig>
 makeZXZArm(bool isFixed=true,
@@ -83,6 +95,72 @@ makeZXZArm(bool isFixed=true,
 }
 
 
+/// @return A robot with two ZX branches with Y as up axis.
+std::tuple<rbd::MultiBody, rbd::MultiBodyConfig>
+makeBranchedArm(bool isFixed=true,
+	const sva::PTransformd X_base=sva::PTransformd::Identity())
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+
+	MultiBodyGraph mbg;
+
+	double mass = 1.;
+	Matrix3d I = Matrix3d::Identity();
+	Vector3d h = Vector3d::Zero();
+
+	RBInertiad rbi(mass, h, I);
+
+	Body b0(rbi, 0, "b0");
+	Body b1(rbi, 1, "b1");
+	Body b2(rbi, 2, "b2");
+	Body b3(rbi, 3, "b3");
+	Body b4(rbi, 4, "b4");
+
+	mbg.addBody(b0);
+	mbg.addBody(b1);
+	mbg.addBody(b2);
+	mbg.addBody(b3);
+	mbg.addBody(b4);
+
+	Joint j0(Joint::RevZ, true, 0, "j0");
+	Joint j1(Joint::RevX, true, 1, "j1");
+	Joint j2(Joint::RevZ, true, 2, "j2");
+	Joint j3(Joint::RevX, true, 3, "j3");
+
+	mbg.addJoint(j0);
+	mbg.addJoint(j1);
+	mbg.addJoint(j2);
+	mbg.addJoint(j3);
+
+	//           j0       j1
+	//        /---- b1 ---- b2
+	//  Root b0     Z       X
+	//        \---- b3 ---- b4
+	//           j2       j3
+	//           Z        X
+
+
+	PTransformd up(Vector3d(0., 0.5, 0.));
+	PTransformd down(Vector3d(0., -0.5, 0.));
+	PTransformd from(Vector3d(0., 0., 0.));
+
+
+	mbg.linkBodies(0, up, 1, from, 0);
+	mbg.linkBodies(1, up, 2, from, 1);
+	mbg.linkBodies(0, down, 3, from, 2);
+	mbg.linkBodies(3, down, 4, from, 3);
+
+	MultiBody mb = mbg.makeMultiBody(0, isFixed, X_base);
+
+	MultiBodyConfig mbc(mb);
+	mbc.zero(mb);
+
+	return std::make_tuple(mb, mbc);
+}
+
+
 /// @return A one body robot for the environnment.
 std::tuple<rbd::MultiBody, rbd::MultiBodyConfig> makeEnv()
 {
@@ -109,3 +187,69 @@ std::tuple<rbd::MultiBody, rbd::MultiBodyConfig> makeEnv()
 
 	return std::make_tuple(mb, mbc);
 }
+
+
+/**
+	* Problem solved on the fixed base ZXZ arm by the solver tests:
+	* move the body 3 toward a target with a posture regularization
+	* under joint and torque limits.
+	*/
+struct ZXZArmProblem
+{
+	/**
+		* @param mbs Robots with the ZXZ arm as first robot.
+		* @param mbcInit ZXZ arm initial configuration with forward kinematics
+		* computed.
+		*/
+	ZXZArmProblem(const std::vector<rbd::MultiBody>& mbs,
+		const rbd::MultiBodyConfig& mbcInit):
+		posTask(mbs, 0, 3, sva::RotZ(boost::math::constants::pi<double>()/2.)*
+			mbcInit.bodyPosW[mbs[0].bodyIndexById(3)].translation()),
+		posTaskSp(mbs, 0, &posTask, 10., 1.),
+		oriTask(mbs, 0, 3, Eigen::Quaterniond(sva::RotZ(0.2))),
+		oriTaskSp(mbs, 0, &oriTask, 10., 0.1),
+		postureTask(mbs, 0, {{}, {0.}, {0.}, {0.}}, 1., 0.01),
+		jointConstr(mbs, 0, tasks::QBound(lBound(), uBound()), 0.001),
+		motionCstr(mbs, 0, tasks::TorqueBound({{}, {-30.}, {-30.}, {-30.}},
+			{{}, {30.}, {30.}, {30.}}))
+	{}
+
+	// the tasks keep a pointer on the high level tasks
+	ZXZArmProblem(const ZXZArmProblem&) = delete;
+	ZXZArmProblem& operator=(const ZXZArmProblem&) = delete;
+
+	/// Add all the tasks and constraints to solver and size it.
+	void addToSolver(const std::vector<rbd::MultiBody>& mbs,
+		tasks::qp::QPSolver& solver)
+	{
+		jointConstr.addToSolver(solver);
+		motionCstr.addToSolver(solver);
+		solver.addTask(&posTaskSp);
+		solver.addTask(&oriTaskSp);
+		solver.addTask(&postureTask);
+
+		solver.nrVars(mbs, {}, {});
+		solver.updateConstrSize();
+	}
+
+	/// First joint lower limit, the others are free.
+	static std::vector<std::vector<double>> lBound()
+	{
+		double inf = std::numeric_limits<double>::infinity();
+		return {{}, {-boost::math::constants::pi<double>()/4.}, {-inf}, {-inf}};
+	}
+
+	static std::vector<std::vector<double>> uBound()
+	{
+		double inf = std::numeric_limits<double>::infinity();
+		return {{}, {boost::math::constants::pi<double>()/4.}, {inf}, {inf}};
+	}
+
+	tasks::qp::PositionTask posTask;
+	tasks::qp::SetPointTask posTaskSp;
+	tasks::qp::OrientationTask oriTask;
+	tasks::qp::SetPointTask oriTaskSp;
+	tasks::qp::PostureTask postureTask;
+	tasks::qp::JointLimitsConstr jointConstr;
+	tasks::qp::MotionConstr motionCstr;
+};